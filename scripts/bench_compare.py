@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Compare two runs of dash_bench --json (src/dash_bench.c).
+
+Results are matched by board and benchmark. A benchmark regresses when
+its ns/op, or its cycles/op where both runs have them, grows by more than
+--threshold percent, or when it allocates more per operation. The exit
+status is 1 on a regression, e.g. against a baseline kept per board:
+
+    build/bin/dash_bench --json > new.jsonl
+    scripts/bench_compare.py baseline/pi5.jsonl new.jsonl
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith("{"):
+                r = json.loads(line)
+                results[(r["board"], r["bench"])] = r
+    return results
+
+
+def change(old, new):
+    return (new - old) * 100.0 / old if old else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    regressions = 0
+    for key in sorted(cur):
+        board, bench = key
+        new = cur[key]
+        old = base.get(key)
+        if old is None:
+            print(f"{board:16} {bench:18} {new['ns_per_op']:10.2f} ns/op  new")
+            continue
+
+        problems = []
+        ns = change(old["ns_per_op"], new["ns_per_op"])
+        if ns > args.threshold:
+            problems.append(f"ns/op +{ns:.1f}%")
+        if old["cycles_per_op"] is not None and new["cycles_per_op"] is not None:
+            cycles = change(old["cycles_per_op"], new["cycles_per_op"])
+            if cycles > args.threshold:
+                problems.append(f"cycles/op +{cycles:.1f}%")
+        if new["allocs_per_op"] > old["allocs_per_op"] + 1e-3:
+            problems.append(f"allocs/op {old['allocs_per_op']:.3f} -> {new['allocs_per_op']:.3f}")
+
+        print(f"{board:16} {bench:18} {new['ns_per_op']:10.2f} ns/op {ns:+6.1f}%  "
+              f"{'; '.join(problems) or 'ok'}")
+        regressions += bool(problems)
+
+    for key in sorted(set(base) - set(cur)):
+        print(f"{key[0]:16} {key[1]:18} missing")
+
+    if regressions:
+        print(f"{regressions} benchmarks regressed")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Binary size, memory and start time of two dashboard builds, e.g. with the
+full and with the subsetted Roboto fonts (DASH_FONT_SUBSET, src/dash_fonts.h):
+
+    cmake -B build-full -DDASH_FONT_SUBSET=OFF && cmake --build build-full
+    cmake -B build && cmake --build build
+    scripts/font_footprint.py build-full/bin/lvglsim build/bin/lvglsim
+
+For each binary it reports:
+- the file size, and the text, data and bss sizes of size(1)
+- the size of the font symbols, from nm(1)
+- the peak RSS (VmHWM) of a headless run once the dash is ready
+- the "dash ready" boot mark of that run (src/boot_splash.h), in ms since
+  the process start
+
+The runs use the real clock and a cold page cache is not forced, so run it
+on the target and compare medians of several --runs.
+"""
+
+import argparse
+import os
+import re
+import selectors
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+READY_RE = re.compile(r"dash ready=(\d+)ms")
+
+
+def sizes(binary):
+    out = subprocess.run(["size", binary], stdout=subprocess.PIPE, text=True, check=True).stdout
+    text, data, bss = (int(x) for x in out.splitlines()[1].split()[:3])
+    fonts = 0
+    out = subprocess.run(["nm", "--print-size", binary], stdout=subprocess.PIPE, text=True, check=True).stdout
+    for line in out.splitlines():
+        parts = line.split()
+        # Glyph bitmaps, descriptors and kerning tables all carry the font name
+        if len(parts) == 4 and "font_" in parts[3]:
+            fonts += int(parts[1], 16)
+    return {"file": os.path.getsize(binary), "text": text, "data": data, "bss": bss, "fonts": fonts}
+
+
+def run_once(binary, timeout):
+    """Start a headless dash, return its dash ready time in ms and peak RSS in KiB"""
+    tmp = tempfile.mkdtemp(prefix="font-footprint-")
+    env = dict(os.environ, DASH_HEADLESS="1", DASH_WATCHDOG_DEV="", DASH_LOG_DIR=os.path.join(tmp, "log"),
+               SLOGAN_JOURNAL=os.path.join(tmp, "slogans"), RUNTIME_DIRECTORY=tmp)
+    for name in ("DASH_CLOCK", "DASH_FRAME_CHECK", "DASH_REPLAY", "DASH_UDP", "DASH_VCU_UART", "DASH_SYNTH"):
+        env.pop(name, None)
+
+    proc = subprocess.Popen([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    sel = selectors.DefaultSelector()
+    sel.register(proc.stdout, selectors.EVENT_READ)
+    deadline = time.monotonic() + timeout
+    ready_ms = None
+    try:
+        while ready_ms is None:
+            left = deadline - time.monotonic()
+            if left <= 0 or not sel.select(left):
+                raise SystemExit(f"{binary}: no boot report within {timeout}s")
+            line = proc.stdout.readline()
+            if not line:
+                raise SystemExit(f"{binary} exited with {proc.wait()} before the dash was ready")
+            m = READY_RE.search(line)
+            if line.startswith("boot:") and m:
+                ready_ms = int(m.group(1))
+        with open(f"/proc/{proc.pid}/status") as f:
+            rss_kb = next(int(l.split()[1]) for l in f if l.startswith("VmHWM:"))
+    finally:
+        proc.kill()
+        proc.wait()
+        shutil.rmtree(tmp, ignore_errors=True)
+    return ready_ms, rss_kb
+
+
+def measure(binary, runs, timeout):
+    result = sizes(binary)
+    ready, rss = zip(*(run_once(binary, timeout) for _ in range(runs)))
+    result["rss_kb"] = statistics.median(rss)
+    result["ready_ms"] = statistics.median(ready)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("before", help="lvglsim built with -DDASH_FONT_SUBSET=OFF")
+    parser.add_argument("after", help="lvglsim built with the subsetted fonts")
+    parser.add_argument("--runs", type=int, default=5, help="headless starts per binary")
+    parser.add_argument("--timeout", type=float, default=30, help="seconds to wait for the dash")
+    args = parser.parse_args()
+
+    before = measure(args.before, args.runs, args.timeout)
+    after = measure(args.after, args.runs, args.timeout)
+
+    print(f"{'':14} {'before':>12} {'after':>12} {'change':>8}")
+    for key, label in (("file", "file bytes"), ("text", "text bytes"), ("data", "data bytes"),
+                       ("bss", "bss bytes"), ("fonts", "font bytes"), ("rss_kb", "peak RSS KiB"),
+                       ("ready_ms", "dash ready ms")):
+        b, a = before[key], after[key]
+        pct = f"{(a - b) * 100.0 / b:+.1f}%" if b else "-"
+        print(f"{label:14} {b:12.0f} {a:12.0f} {pct:>8}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Generate subsetted Roboto fonts for the dashboard with lv_font_conv.
+
+The fonts and their extra characters are listed in src/fonts.txt. The
+characters of each font are collected from the C sources: the string
+literals of every statement that mentions the font, or that sets the text
+of a label or a scroll_text box whose font it is.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+STRING_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+FONT_RE = re.compile(r"&(dash_font_\w+)")
+ARRAY_RE = re.compile(r"(\w+)\s*\[[^\]]*\]\s*=\s*\{(.*?)\}", re.S)
+ASSIGN_RE = re.compile(r"^\s*([A-Za-z_]\w*(?:\[\w+\])?)\s*=")
+SET_FONT_RE = re.compile(r"lv_obj_set_style_text_font\s*\(\s*([^,\s]+)")
+SET_TEXT_RE = re.compile(r"(?:lv_label_set_text(?:_static)?|scroll_text_set_text)\s*\(\s*([^,\s]+)\s*,\s*(.*)\)\s*$", re.S)
+IDENT_RE = re.compile(r"[A-Za-z_]\w*")
+RANGE_RE = re.compile(r"U\+([0-9A-Fa-f]+)-U\+([0-9A-Fa-f]+)$")
+
+
+def read_manifest(path):
+    fonts = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split(None, 2)
+            extra = parts[2].split() if len(parts) > 2 else []
+            fonts.append((parts[0], int(parts[1]), extra))
+    return fonts
+
+
+def unescape(s):
+    return bytes(s, "utf-8").decode("unicode_escape").encode("latin-1").decode("utf-8")
+
+
+def statements(path):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    text = re.sub(r"/\*.*?\*/", " ", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", " ", text)
+    return text, [s for s in text.split(";") if s.strip()]
+
+
+def collect(sources, fonts):
+    names = {name for name, _, _ in fonts}
+    chars = {name: set() for name in names}
+    arrays = {}
+    all_stmts = []
+
+    for path in sources:
+        text, stmts = statements(path)
+        for name, body in ARRAY_RE.findall(text):
+            lits = [unescape(s) for s in STRING_RE.findall(body)]
+            if lits:
+                arrays[name] = lits
+        all_stmts += stmts
+
+    def literals(stmt):
+        found = [unescape(s) for s in STRING_RE.findall(stmt)]
+        for ident in IDENT_RE.findall(STRING_RE.sub("", stmt)):
+            found += arrays.get(ident, [])
+        return found
+
+    # Labels whose font is known, by variable name
+    label_fonts = {}
+    for stmt in all_stmts:
+        used = [f for f in FONT_RE.findall(stmt) if f in names]
+        if not used:
+            continue
+        m = SET_FONT_RE.search(stmt) or ASSIGN_RE.search(stmt)
+        if m:
+            label_fonts.setdefault(m.group(1), set()).update(used)
+        for f in used:
+            for lit in literals(stmt):
+                chars[f].update(lit)
+
+    for stmt in all_stmts:
+        m = SET_TEXT_RE.search(stmt.strip())
+        if not m or m.group(1) not in label_fonts:
+            continue
+        for f in label_fonts[m.group(1)]:
+            for lit in literals(m.group(2)):
+                chars[f].update(lit)
+
+    for name, _, extra in fonts:
+        for item in extra:
+            if item.startswith("@"):
+                if item[1:] not in arrays:
+                    raise ValueError(f"{name}: array {item[1:]} not found in the sources")
+                for lit in arrays[item[1:]]:
+                    chars[name].update(lit)
+            elif RANGE_RE.match(item):
+                lo, hi = (int(x, 16) for x in RANGE_RE.match(item).groups())
+                chars[name].update(chr(c) for c in range(lo, hi + 1))
+            else:
+                chars[name].update(item)
+        # Line breaks are not glyphs
+        chars[name] -= set("\n\r\t")
+    return chars
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--manifest", required=True, help="src/fonts.txt")
+    parser.add_argument("--ttf", help="Roboto TTF the glyphs are taken from")
+    parser.add_argument("--lv-font-conv", default="lv_font_conv", help="lv_font_conv executable")
+    parser.add_argument("--bpp", default="4")
+    parser.add_argument("--output-dir", help="where <font>.c files are written")
+    parser.add_argument("--list", action="store_true", help="only print the characters of each font")
+    parser.add_argument("sources", nargs="+", help="C sources to scan")
+    args = parser.parse_args()
+
+    try:
+        fonts = read_manifest(args.manifest)
+        chars = collect(args.sources, fonts)
+    except (OSError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    for name, size, _ in fonts:
+        symbols = "".join(sorted(chars[name]))
+        print(f"{name}: {len(symbols)} glyphs: {symbols}")
+        if args.list:
+            continue
+        if not args.ttf or not args.output_dir:
+            print("--ttf and --output-dir are required to generate", file=sys.stderr)
+            return 1
+        os.makedirs(args.output_dir, exist_ok=True)
+        cmd = [args.lv_font_conv, "--font", args.ttf, "--size", str(size), "--bpp", args.bpp,
+               "--format", "lvgl", "--lv-include", "lvgl/lvgl.h", "--lv-font-name", name,
+               "--symbols", symbols, "-o", os.path.join(args.output_dir, name + ".c")]
+        if subprocess.call(cmd) != 0:
+            print(f"{name}: lv_font_conv failed", file=sys.stderr)
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
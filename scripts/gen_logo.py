@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Convert the OEM logo to the display's native color format.
+
+The ARGB8888 map of src/oem_logo.c is blended over the logo screen's black
+background, converted to RGB565 or XRGB8888 and RLE compressed in the
+format of LVGL's lv_rle.c, so the image is opaque, needs no blending and
+is decoded once by the bin decoder.
+"""
+
+import argparse
+import re
+import sys
+
+# lv_image_compress_t
+COMPRESS_RLE = 1
+# Shorter runs are stored as literals, same threshold as LVGLImage.py
+RLE_THRESHOLD = 16
+RLE_MAX = 127
+
+
+def parse_map(path: str):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    body = re.search(r"oem_logo_map\[\]\s*=\s*\{(.*?)\};", text, re.S)
+    w = re.search(r"\.header\.w\s*=\s*(\d+)", text)
+    h = re.search(r"\.header\.h\s*=\s*(\d+)", text)
+    if not body or not w or not h:
+        raise ValueError(f"{path}: oem_logo_map or its size not found")
+    data = bytes(int(x, 16) for x in re.findall(r"0x([0-9a-fA-F]{2})", body.group(1)))
+    w, h = int(w.group(1)), int(h.group(1))
+    if len(data) != w * h * 4:
+        raise ValueError(f"{path}: {len(data)} bytes, expected {w * h * 4} for ARGB8888")
+    return w, h, data
+
+
+def to_native(argb: bytes, cf: str) -> bytes:
+    out = bytearray()
+    for i in range(0, len(argb), 4):
+        b, g, r, a = argb[i], argb[i + 1], argb[i + 2], argb[i + 3]
+        # Over black: the color scaled by its alpha
+        r, g, b = r * a // 255, g * a // 255, b * a // 255
+        if cf == "RGB565":
+            px = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+            out += px.to_bytes(2, "little")
+        else:
+            out += bytes((b, g, r, 0xFF))
+    return bytes(out)
+
+
+def rle_compress(data: bytes, blk: int) -> bytes:
+    out = bytearray()
+    n = len(data) // blk
+    px = [data[i * blk:(i + 1) * blk] for i in range(n)]
+    i = 0
+    while i < n:
+        run = 1
+        while i + run < n and run < RLE_MAX and px[i + run] == px[i]:
+            run += 1
+        if run >= RLE_THRESHOLD or (i + run == n and run > 1):
+            out.append(run)
+            out += px[i]
+            i += run
+            continue
+        # Literals until the next long run
+        start = i
+        while i < n and i - start < RLE_MAX:
+            run = 1
+            while i + run < n and run < RLE_THRESHOLD and px[i + run] == px[i]:
+                run += 1
+            if run >= RLE_THRESHOLD:
+                break
+            i += 1
+        out.append(0x80 | (i - start))
+        out += b"".join(px[start:i])
+    return bytes(out)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--input", required=True, help="src/oem_logo.c")
+    parser.add_argument("--cf", required=True, choices=("RGB565", "XRGB8888"))
+    parser.add_argument("--output", required=True, help="generated C file")
+    args = parser.parse_args()
+
+    try:
+        w, h, argb = parse_map(args.input)
+    except (OSError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    blk = 2 if args.cf == "RGB565" else 4
+    native = to_native(argb, args.cf)
+    rle = rle_compress(native, blk)
+
+    # lv_image_compressed_t header: method, compressed size, decompressed size
+    blob = (COMPRESS_RLE.to_bytes(4, "little") + len(rle).to_bytes(4, "little") +
+            len(native).to_bytes(4, "little") + rle)
+
+    lines = []
+    for i in range(0, len(blob), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in blob[i:i + 16]) + ",")
+
+    body = "\n".join(lines)
+    source = f"""/**
+ * @file oem_logo_native.c
+ *
+ * Generated by scripts/gen_logo.py from src/oem_logo.c, do not edit.
+ * {args.cf} over black, RLE: {len(argb)} bytes ARGB8888 -> {len(blob)} bytes
+ */
+
+#include "lvgl/lvgl.h"
+
+#ifndef LV_ATTRIBUTE_MEM_ALIGN
+#define LV_ATTRIBUTE_MEM_ALIGN
+#endif
+
+static const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST uint8_t oem_logo_map[] = {{
+{body}
+}};
+
+const lv_image_dsc_t oem_logo = {{
+    .header.magic = LV_IMAGE_HEADER_MAGIC,
+    .header.cf = LV_COLOR_FORMAT_{args.cf},
+    .header.flags = LV_IMAGE_FLAGS_COMPRESSED,
+    .header.w = {w},
+    .header.h = {h},
+    .header.stride = {w * blk},
+    .data_size = sizeof(oem_logo_map),
+    .data = oem_logo_map,
+}};
+"""
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(source)
+
+    print(f"oem_logo: {w}x{h} {args.cf}, {len(argb)} -> {len(blob)} bytes "
+          f"({100 * len(blob) // len(argb)}% of ARGB8888)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
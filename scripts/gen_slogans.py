@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Generate the constant slogan table of the logo screen from slogans.txt.
+
+Every slogan is wrapped at build time the way the dashboard used to do it
+at boot: slogans longer than 45 bytes are broken after their first comma,
+otherwise at the space closest to the middle.
+"""
+
+import argparse
+import os
+import sys
+
+MAX_SLOGANS = 128
+WRAP_LEN = 45
+
+
+def wrap(s: bytes) -> bytes:
+    if len(s) <= WRAP_LEN:
+        return s
+    comma = s.find(b",")
+    if comma != -1:
+        return s[:comma + 1] + b"\n" + s[comma + 1:]
+    mid = len(s) // 2
+    best = -1
+    best_dist = 9999
+    for i, c in enumerate(s):
+        if c == ord(" ") and abs(i - mid) < best_dist:
+            best, best_dist = i, abs(i - mid)
+    if best != -1:
+        s = s[:best] + b"\n" + s[best + 1:]
+    return s
+
+
+def c_string(s: bytes) -> str:
+    out = ""
+    for c in s:
+        if c == ord("\n"):
+            out += "\\n"
+        elif c in (ord("\\"), ord('"')):
+            out += "\\" + chr(c)
+        elif 0x20 <= c < 0x7f:
+            out += chr(c)
+        else:
+            # Octal escapes keep UTF-8 sequences intact and never absorb the next char
+            out += "\\%03o" % c
+    return '"' + out + '"'
+
+
+def fnv1a(data: bytes) -> int:
+    h = 0x811C9DC5
+    for c in data:
+        h = ((h ^ c) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def write_if_changed(path: str, text: str) -> None:
+    try:
+        with open(path, encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--input", required=True, help="slogans.txt, one slogan per line")
+    parser.add_argument("--output-dir", required=True, help="where slogans_table.c/.h are written")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        slogans = [line.rstrip(b"\r\n") for line in f]
+    slogans = [s for s in slogans if s]
+
+    if not slogans:
+        print(f"{args.input}: no slogans", file=sys.stderr)
+        return 1
+    if len(slogans) > MAX_SLOGANS:
+        print(f"{args.input}: {len(slogans)} slogans, at most {MAX_SLOGANS} fit the rotation record",
+              file=sys.stderr)
+        return 1
+
+    wrapped = [wrap(s) for s in slogans]
+    table_hash = fnv1a(b"\0".join(wrapped))
+
+    os.makedirs(args.output_dir, exist_ok=True)
+
+    header = f"""/**
+ * @file slogans_table.h
+ *
+ * Generated by scripts/gen_slogans.py from src/slogans.txt, do not edit
+ */
+
+#ifndef SLOGANS_TABLE_H
+#define SLOGANS_TABLE_H
+
+#include <stdint.h>
+
+#define SLOGAN_COUNT {len(wrapped)}
+
+/* Changes whenever the table changes, invalidates the saved rotation */
+#define SLOGAN_TABLE_HASH 0x{table_hash:08X}u
+
+extern const char * const slogan_table[SLOGAN_COUNT];
+
+#endif /*SLOGANS_TABLE_H*/
+"""
+
+    source = """/**
+ * @file slogans_table.c
+ *
+ * Generated by scripts/gen_slogans.py from src/slogans.txt, do not edit
+ */
+
+#include "slogans_table.h"
+
+const char * const slogan_table[SLOGAN_COUNT] = {
+"""
+    source += "".join(f"    {c_string(s)},\n" for s in wrapped)
+    source += "};\n"
+
+    write_if_changed(os.path.join(args.output_dir, "slogans_table.h"), header)
+    write_if_changed(os.path.join(args.output_dir, "slogans_table.c"), source)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
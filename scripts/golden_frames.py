@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""
+Golden frame and render time check of the dashboard.
+
+Runs a headless dashboard on the virtual clock with DASH_FRAME_CHECK
+(src/frame_check.h). It captures the frame and the full screen render
+time of each check state of src/main.c: the logo, the dash with fixed
+values, every mode card and the error screen. Then:
+
+- every frame is compared with <golden>/<state>.ppm. A pixel differs when
+  a channel is off by more than --tolerance. A state fails when more than
+  --max-diff-pct of its pixels differ. The differing pixels are marked in
+  red on <out>/<state>.diff.ppm.
+- every render time is compared with the budget of the state in
+  <golden>/render_budget.txt. The budget is in microseconds and is
+  recorded on the target, since render times depend on the machine.
+
+The exit status is 1 if a state fails, or if a state of the budgets was
+not captured. It is 77, which ctest reports as skipped, while nothing has
+been recorded yet: no budgets or no golden frame in <golden>. ctest runs
+it as the golden_frames test, or by hand:
+
+    cmake --build build && scripts/golden_frames.py --binary build/bin/lvglsim
+
+--update records the frames as the new golden ones. It also sets each
+budget to the measured time times --headroom. Run it after an intended
+UI change and commit the result.
+"""
+
+import argparse
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+BUDGET_FILE = "render_budget.txt"
+
+# Exit status while nothing is recorded, SKIP_RETURN_CODE of the ctest test
+SKIP_CODE = 77
+
+
+def read_ppm(path):
+    """Return width, height and the RGB bytes of a binary PPM"""
+    with open(path, "rb") as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b"P6" or fields[3] != b"255":
+        raise ValueError(f"{path} is not an 8 bit binary PPM")
+    w, h = int(fields[1]), int(fields[2])
+    return w, h, data[pos + 1:pos + 1 + w * h * 3]
+
+
+def write_ppm(path, w, h, rgb):
+    with open(path, "wb") as f:
+        f.write(b"P6\n%d %d\n255\n" % (w, h))
+        f.write(rgb)
+
+
+def read_times(path):
+    times = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            for line in f:
+                parts = line.split()
+                if len(parts) == 2 and not line.startswith("#"):
+                    times[parts[0]] = int(parts[1])
+    return times
+
+
+def compare(golden, frame, w, tolerance):
+    """Return the number of differing pixels and the diff image"""
+    diff = bytearray(len(frame))
+    bad = 0
+    # Whole rows first, most of a frame is identical
+    row = w * 3
+    for start in range(0, len(frame), row):
+        if golden[start:start + row] == frame[start:start + row]:
+            for i in range(start, start + row):
+                diff[i] = frame[i] // 4
+            continue
+        for i in range(start, start + row, 3):
+            if max(abs(golden[i] - frame[i]), abs(golden[i + 1] - frame[i + 1]),
+                   abs(golden[i + 2] - frame[i + 2])) > tolerance:
+                bad += 1
+                diff[i:i + 3] = b"\xff\x00\x00"
+            else:
+                diff[i:i + 3] = bytes(c // 4 for c in frame[i:i + 3])
+    return bad, bytes(diff)
+
+
+def run_dash(binary, out, timeout):
+    env = dict(os.environ, DASH_HEADLESS="1", DASH_CLOCK="virtual", DASH_FRAME_CHECK=out,
+               DASH_WATCHDOG_DEV="", DASH_LOG_DIR=os.path.join(out, "log"),
+               SLOGAN_JOURNAL=os.path.join(out, "slogans"), RUNTIME_DIRECTORY=out)
+    for name in ("DASH_REPLAY", "DASH_UDP", "DASH_VCU_UART", "DASH_SYNTH", "DASH_CLOCK_END_S"):
+        env.pop(name, None)
+    proc = subprocess.run([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          text=True, timeout=timeout)
+    if proc.returncode != 0:
+        sys.stdout.write(proc.stdout)
+        raise SystemExit(f"{binary} exited with {proc.returncode}")
+
+
+def recorded(golden):
+    """Tell whether --update has written golden frames and budgets"""
+    if not os.path.exists(os.path.join(golden, BUDGET_FILE)):
+        return False
+    return any(name.endswith(".ppm") for name in os.listdir(golden))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--binary", default="build/bin/lvglsim")
+    parser.add_argument("--golden", default=os.path.join(os.path.dirname(__file__), "golden"),
+                        help="directory of the golden frames and budgets")
+    parser.add_argument("--out", help="keep the frames and diffs here instead of a temporary directory")
+    parser.add_argument("--tolerance", type=int, default=8, help="largest channel difference of equal pixels")
+    parser.add_argument("--max-diff-pct", type=float, default=0.1, help="differing pixels allowed per frame")
+    parser.add_argument("--headroom", type=float, default=1.5, help="budget per measured time with --update")
+    parser.add_argument("--timeout", type=float, default=120)
+    parser.add_argument("--update", action="store_true", help="record the frames and budgets as golden")
+    args = parser.parse_args()
+
+    if not args.update and not recorded(args.golden):
+        print(f"no golden frames and budgets in {args.golden}, record them with --update on the target")
+        return SKIP_CODE
+
+    out = args.out or tempfile.mkdtemp(prefix="golden-frames-")
+    os.makedirs(out, exist_ok=True)
+    run_dash(args.binary, out, args.timeout)
+    times = read_times(os.path.join(out, "render.txt"))
+    if not times:
+        raise SystemExit("no state was captured")
+
+    if args.update:
+        os.makedirs(args.golden, exist_ok=True)
+        with open(os.path.join(args.golden, BUDGET_FILE), "w") as f:
+            f.write("# state render budget in us, measured times %.1f\n" % args.headroom)
+            for name, us in times.items():
+                shutil.copy(os.path.join(out, name + ".ppm"), os.path.join(args.golden, name + ".ppm"))
+                f.write(f"{name} {math.ceil(us * args.headroom)}\n")
+        print(f"{len(times)} golden frames and budgets written to {args.golden}")
+        return 0
+
+    budgets = read_times(os.path.join(args.golden, BUDGET_FILE))
+    failed = 0
+    for name, us in times.items():
+        problems = []
+        golden_path = os.path.join(args.golden, name + ".ppm")
+        if not os.path.exists(golden_path):
+            problems.append("no golden frame")
+        else:
+            gw, gh, golden = read_ppm(golden_path)
+            w, h, frame = read_ppm(os.path.join(out, name + ".ppm"))
+            if (gw, gh) != (w, h):
+                problems.append(f"{w}x{h}, golden is {gw}x{gh}")
+            else:
+                bad, diff = compare(golden, frame, w, args.tolerance)
+                if bad * 100.0 / (w * h) > args.max_diff_pct:
+                    problems.append(f"{bad} pixels differ")
+                    write_ppm(os.path.join(out, name + ".diff.ppm"), w, h, diff)
+        budget = budgets.get(name)
+        if budget is None:
+            problems.append("no render budget")
+        elif us > budget:
+            problems.append(f"render over budget of {budget}us")
+
+        print(f"{name:12} {us:7}us  {'; '.join(problems) or 'ok'}")
+        failed += bool(problems)
+
+    missing = [name for name in budgets if name not in times]
+    for name in missing:
+        print(f"{name:12} {'-':>7}    not captured")
+        failed += 1
+
+    if failed:
+        print(f"{failed} of {len(times) + len(missing)} states failed, frames and diffs in {out}")
+        return 1
+    print(f"all {len(times)} states match")
+    if not args.out:
+        shutil.rmtree(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+Convert a logged session to the replay format of src/replay.h.
+
+The input is CSV with the columns t_ms,channel,value. The channel is a
+name of telem_channel_t without the TELEM_ prefix (speed, tire_fl, ...)
+or "fault", whose value is the fault word. Rows are sorted by time.
+Without an input file a synthetic stint of --minutes is written, e.g.
+to time a headless replay:
+
+    DASH_HEADLESS=1 DASH_REPLAY=stint.rec DASH_REPLAY_SPEED=0 build/bin/lvglsim
+"""
+
+import argparse
+import csv
+import math
+import struct
+import sys
+
+# Order of telem_channel_t in src/telemetry.h
+CHANNELS = ("speed", "throttle", "brake", "tire_fl", "tire_fr", "tire_rl", "tire_rr",
+            "batt_soc", "batt_temp", "pack_volt", "lv_ok", "hv_on", "rtd")
+CH_FAULT = 0xFFFF
+
+HEADER = struct.Struct("=8sII")
+RECORD = struct.Struct("=IHHf")
+RECORD_FAULT = struct.Struct("=IHHI")
+
+
+def read_csv(path):
+    rows = []
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            if not row or row[0].startswith("#") or row[0] == "t_ms":
+                continue
+            t_ms, name, value = int(row[0]), row[1].strip().lower(), row[2]
+            if name == "fault":
+                rows.append((t_ms, CH_FAULT, int(value, 0)))
+            else:
+                rows.append((t_ms, CHANNELS.index(name), float(value)))
+    return rows
+
+
+def synthetic(minutes, rate_hz):
+    rows = []
+    period_ms = 1000 // rate_hz
+    for t_ms in range(0, minutes * 60000, period_ms):
+        lap = (t_ms % 75000) / 75000.0
+        speed = 60 + 50 * math.sin(lap * 2 * math.pi * 3)
+        rows.append((t_ms, CHANNELS.index("speed"), speed))
+        rows.append((t_ms, CHANNELS.index("throttle"), max(0.0, min(100.0, speed - 20))))
+        rows.append((t_ms, CHANNELS.index("brake"), max(0.0, min(100.0, 40 - speed / 2))))
+        if t_ms % 1000 == 0:
+            soc = 100.0 - 80.0 * t_ms / (minutes * 60000)
+            for i, tire in enumerate(("tire_fl", "tire_fr", "tire_rl", "tire_rr")):
+                rows.append((t_ms, CHANNELS.index(tire), 60 + 30 * (1 - math.exp(-t_ms / 300000)) + i))
+            rows.append((t_ms, CHANNELS.index("batt_soc"), soc))
+            rows.append((t_ms, CHANNELS.index("batt_temp"), 80 + (100 - soc) * 0.4))
+            rows.append((t_ms, CHANNELS.index("pack_volt"), 380 + soc * 0.9))
+            for flag in ("lv_ok", "hv_on", "rtd"):
+                rows.append((t_ms, CHANNELS.index(flag), 1.0))
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="CSV t_ms,channel,value")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--minutes", type=int, default=25, help="length of the synthetic stint")
+    parser.add_argument("--rate-hz", type=int, default=50, help="rate of the fast synthetic channels")
+    args = parser.parse_args()
+
+    rows = read_csv(args.input) if args.input else synthetic(args.minutes, args.rate_hz)
+    rows.sort(key=lambda r: r[0])
+
+    with open(args.output, "wb") as f:
+        f.write(HEADER.pack(b"DASHREC1", 1, RECORD.size))
+        for t_ms, ch, value in rows:
+            if ch == CH_FAULT:
+                f.write(RECORD_FAULT.pack(t_ms, ch, 0, value))
+            else:
+                f.write(RECORD.pack(t_ms, ch, 0, value))
+
+    print(f"{len(rows)} records over {rows[-1][0] / 1000:.0f}s" if rows else "no records")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
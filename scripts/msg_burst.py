@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""
+Send a burst of long driver messages to the dashboard's message socket.
+
+The dashboard logs the worst loop iteration of the burst once its queue
+drains ("driver_msg: burst of N messages, worst frame ..."). Run it with
+DRIVER_MSG_MIN_SHOW_MS=0 so every message is drawn as soon as it arrives,
+and with DASH_SCROLL_TEXT=label to compare with the label breaking the
+lines on the UI thread.
+"""
+
+import argparse
+import random
+import socket
+import sys
+import time
+
+WORDS = ("BOX", "PUSH", "TIRES", "FRONT", "WING", "DAMAGE", "GAP", "AHEAD", "BEHIND",
+         "SECTOR", "PURPLE", "LIFT", "COAST", "BRAKE", "BIAS", "FORWARD", "SAFETY", "CAR",
+         "DEPLOYED", "YELLOW", "FLAG", "TURN", "STAY", "OUT", "THIS", "LAP", "COPY")
+
+
+def message(rng, length):
+    words = []
+    while sum(len(w) + 1 for w in words) < length:
+        words.append(rng.choice(WORDS))
+    return " ".join(words)[:length]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--socket", default="/run/oem-dashboard/driver-msg.sock")
+    parser.add_argument("--count", type=int, default=50, help="messages in the burst")
+    parser.add_argument("--length", type=int, default=400, help="characters per message")
+    parser.add_argument("--interval-ms", type=float, default=0, help="pause between messages")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+    try:
+        for _ in range(args.count):
+            prio = rng.randrange(3)
+            sock.sendto(f"{prio} {message(rng, args.length)}".encode(), args.socket)
+            if args.interval_ms:
+                time.sleep(args.interval_ms / 1000)
+    except OSError as e:
+        print(f"{args.socket}: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Measure the wakeup latency of the dashboard's UI loop under load.
+
+Runs stress-ng on every CPU, starts the dashboard once with the default
+threading model and once with everything on one unpinned thread, and
+compares the latency histograms the dashboard logs
+("rt_threads: ui wakeup latency ..."), like cyclictest does for a bare
+periodic thread. Run it on the target as root so SCHED_FIFO and mlockall
+are permitted.
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+LINE_RE = re.compile(r"rt_threads: ui wakeup latency over (\d+) wakeups "
+                     r"min (\d+)us avg (\d+)us max (\d+)us, (.*)")
+
+CONFIGS = {
+    "split": {},
+    "single": {"DASH_THREADS": "single", "DASH_UI_CPU": "-1", "DASH_INPUT_CPU": "-1",
+               "DASH_TELEM_CPU": "-1", "DASH_INPUT_PRIO": "0", "DASH_TELEM_PRIO": "0",
+               "DASH_MLOCK": "0"},
+}
+
+
+def run(binary, env_extra, seconds):
+    env = dict(os.environ, **env_extra)
+    proc = subprocess.Popen([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            text=True, bufsize=1)
+    last = None
+    deadline = time.monotonic() + seconds
+    try:
+        for line in proc.stdout:
+            m = LINE_RE.search(line)
+            if m:
+                last = m
+            if time.monotonic() > deadline:
+                break
+    finally:
+        proc.terminate()
+        proc.wait()
+    return last
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--binary", default="build/bin/lvglsim")
+    parser.add_argument("--seconds", type=int, default=60, help="duration of each run")
+    parser.add_argument("--stress", default="--cpu 0 --io 2 --vm 1 --vm-bytes 64M",
+                        help="stress-ng load arguments")
+    args = parser.parse_args()
+
+    if shutil.which("stress-ng") is None:
+        print("stress-ng not found", file=sys.stderr)
+        return 1
+
+    stress = subprocess.Popen(["stress-ng", *args.stress.split()], stdout=subprocess.DEVNULL)
+    try:
+        results = {name: run(args.binary, env, args.seconds) for name, env in CONFIGS.items()}
+    finally:
+        stress.terminate()
+        stress.wait()
+
+    print(f"{'config':8} {'wakeups':>8} {'min':>6} {'avg':>6} {'max':>6}  histogram (us)")
+    for name, m in results.items():
+        if m is None:
+            print(f"{name:8} no latency report, run longer than the report period")
+            continue
+        print(f"{name:8} {m[1]:>8} {m[2]:>6} {m[3]:>6} {m[4]:>6}  {m[5]}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Decode the session log segments written by src/session_log.c.
+
+Prints the samples as CSV t_ms,channel,value, sorted by time, or with
+--summary the blocks, samples and compression of each segment. Decoding
+stops at the first block that is incomplete or fails its CRC, like the
+recovery at startup does.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+# Order of telem_channel_t in src/telemetry.h
+CHANNELS = ("speed", "throttle", "brake", "tire_fl", "tire_fr", "tire_rl", "tire_rr",
+            "batt_soc", "batt_temp", "pack_volt", "lv_ok", "hv_on", "rtd")
+
+SEG_HEADER = struct.Struct("=8sIIQII")
+BLOCK_HEADER = struct.Struct("=IHHIIIIII")
+BLOCK_MAGIC = 0x4B4C4244
+FLAG_LZ4 = 0x0001
+
+
+def lz4_block_decompress(src, size):
+    """LZ4 block format, no frame"""
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += src[i:i + lit]
+        i += lit
+        if i >= len(src):
+            break
+        offset = src[i] | src[i + 1] << 8
+        i += 2
+        match = (token & 15) + 4
+        if match == 19:
+            while True:
+                b = src[i]
+                i += 1
+                match += b
+                if b != 255:
+                    break
+        for _ in range(match):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError("LZ4 block decoded to %d bytes, expected %d" % (len(out), size))
+    return bytes(out)
+
+
+def varints(data):
+    v = shift = 0
+    for b in data:
+        v |= (b & 0x7F) << shift
+        if b & 0x80:
+            shift += 7
+        else:
+            yield v
+            v = shift = 0
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def read_segment(path):
+    """Yield (block header dict, [(t_ms, ch, value)]) of the intact blocks"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < SEG_HEADER.size:
+        return
+    magic, version, channel_cnt, start_unix_ms, start_mono_ms, crc = SEG_HEADER.unpack_from(data)
+    if magic != b"DASHSEG1" or crc != zlib.crc32(data[:SEG_HEADER.size - 4]):
+        return
+
+    off = SEG_HEADER.size
+    while off + BLOCK_HEADER.size <= len(data):
+        (magic, flags, channel_cnt, sample_cnt, raw_size, stored_size, t0_ms, data_crc,
+         header_crc) = BLOCK_HEADER.unpack_from(data, off)
+        stored = data[off + BLOCK_HEADER.size:off + BLOCK_HEADER.size + stored_size]
+        if (magic != BLOCK_MAGIC or header_crc != zlib.crc32(data[off:off + BLOCK_HEADER.size - 4])
+                or len(stored) != stored_size or data_crc != zlib.crc32(stored)):
+            return
+        raw = lz4_block_decompress(stored, raw_size) if flags & FLAG_LZ4 else stored
+
+        samples = []
+        it = varints(raw)
+        for ch in range(channel_cnt):
+            t, bits = t0_ms, 0
+            for _ in range(next(it)):
+                t = (t + unzigzag(next(it))) & 0xFFFFFFFF
+                bits = (bits + unzigzag(next(it))) & 0xFFFFFFFF
+                samples.append((t, ch, struct.unpack("=f", struct.pack("=I", bits))[0]))
+        if len(samples) != sample_cnt:
+            raise ValueError("%s: block at %d holds %d samples, expected %d" % (path, off, len(samples), sample_cnt))
+
+        header = dict(flags=flags, samples=sample_cnt, raw_size=raw_size, stored_size=stored_size,
+                      start_unix_ms=start_unix_ms, start_mono_ms=start_mono_ms)
+        yield header, samples
+        off += BLOCK_HEADER.size + stored_size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("segments", nargs="+")
+    parser.add_argument("--summary", action="store_true")
+    args = parser.parse_args()
+
+    if not args.summary:
+        print("t_ms,channel,value")
+    for path in args.segments:
+        blocks = samples = stored = 0
+        rows = []
+        for header, block in read_segment(path):
+            blocks += 1
+            samples += header["samples"]
+            stored += header["stored_size"] + BLOCK_HEADER.size
+            if not args.summary:
+                rows += block
+        if args.summary:
+            ratio = stored / samples if samples else 0
+            print(f"{path}: {blocks} blocks, {samples} samples, {ratio:.2f} bytes/sample")
+        else:
+            rows.sort(key=lambda r: r[0])
+            for t, ch, value in rows:
+                print(f"{t},{CHANNELS[ch] if ch < len(CHANNELS) else ch},{value:g}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Throughput benchmark and crash recovery test of the session logger.
+
+bench: replays a synthetic session of --rate samples/s into a headless
+dashboard with DASH_LOG_DIR set, then decodes the segments and checks
+that every sample the logger counted is in them. The logger has to keep
+up without dropping samples, on the target (Cortex-A55) at 50k/s.
+
+crash: runs the dashboard --runs times, kills it with SIGKILL at a random
+moment, tears the tail of the newest segment the way a power loss would
+(cut at a random offset, or garbage over the last bytes), restarts it and
+checks that it reports and cuts the partial block and that every segment
+decodes up to its end afterwards.
+"""
+
+import argparse
+import glob
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import session_dump  # noqa: E402
+from make_session import HEADER, RECORD, CHANNELS  # noqa: E402
+
+
+def write_session(path, rate, seconds):
+    per_ms = max(1, rate // 1000)
+    with open(path, "wb") as f:
+        f.write(HEADER.pack(b"DASHREC1", 1, RECORD.size))
+        for t_ms in range(seconds * 1000):
+            f.write(b"".join(RECORD.pack(t_ms, i % len(CHANNELS), 0, 50.0 + (t_ms + i) % 400 * 0.25)
+                             for i in range(per_ms)))
+    return per_ms * 1000
+
+
+def start(binary, log_dir, session, extra_env=None):
+    env = dict(os.environ, DASH_HEADLESS="1", DASH_LOG_DIR=log_dir, DASH_REPLAY=session,
+               DASH_REPLAY_SPEED="1", DASH_REPLAY_LOOP="1", DASH_WATCHDOG_DEV="")
+    env.update(extra_env or {})
+    return subprocess.Popen([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+
+def decode_segment(path):
+    if os.path.getsize(path) == 0:
+        return 0    # killed before the first write
+    blocks = list(session_dump.read_segment(path))
+    end = session_dump.SEG_HEADER.size + sum(session_dump.BLOCK_HEADER.size + h["stored_size"] for h, _ in blocks)
+    if end != os.path.getsize(path):
+        raise AssertionError(f"{path}: {os.path.getsize(path) - end} bytes after the last intact block")
+    return sum(h["samples"] for h, _ in blocks)
+
+
+def decode_all(log_dir):
+    return sum(decode_segment(path) for path in sorted(glob.glob(os.path.join(log_dir, "seg-*.dlog"))))
+
+
+def bench(args):
+    with tempfile.TemporaryDirectory() as tmp:
+        session = os.path.join(tmp, "bench.rec")
+        rate = write_session(session, args.rate, 10)
+        log_dir = os.path.join(tmp, "log")
+        proc = start(args.binary, log_dir, session, {"DASH_LOG_SYNC_S": "1"})
+        time.sleep(args.seconds)
+        proc.kill()
+        output = proc.communicate()[0]
+
+        reports = re.findall(r"session_log: (\d+) samples, (\d+) dropped, (\d+)\.(\d+) bytes/sample, "
+                             r"worst write (\d+)ms", output)
+        if not reports:
+            print("FAIL no session_log report, run for more than 10 s")
+            return 1
+        logged, dropped, whole, frac, worst = (int(x) for x in reports[-1])
+        decoded = decode_all(log_dir)
+        print(f"offered {rate} samples/s, logged {logged}, dropped {dropped}, decoded {decoded}, "
+              f"{whole}.{frac:02d} bytes/sample, worst write {worst}ms")
+        ok = dropped == 0 and decoded >= logged
+        print("ok" if ok else "FAIL")
+        return 0 if ok else 1
+
+
+def tear(path, rng):
+    size = os.path.getsize(path)
+    if size <= session_dump.SEG_HEADER.size:
+        return "too short"
+    with open(path, "r+b") as f:
+        if rng.random() < 0.5:
+            cut = rng.randrange(session_dump.SEG_HEADER.size, size)
+            f.truncate(cut)
+            return f"cut at {cut} of {size}"
+        n = rng.randrange(1, min(4096, size - session_dump.SEG_HEADER.size))
+        f.seek(size - n)
+        f.write(bytes(rng.randrange(256) for _ in range(n)))
+        return f"garbage over the last {n} bytes"
+
+
+def crash(args):
+    rng = random.Random(args.seed)
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        session = os.path.join(tmp, "crash.rec")
+        write_session(session, args.rate, 10)
+        log_dir = os.path.join(tmp, "log")
+        for run in range(args.runs):
+            proc = start(args.binary, log_dir, session, {"DASH_LOG_SYNC_S": "1"})
+            time.sleep(rng.uniform(1.5, 4.0))
+            proc.kill()
+            proc.communicate()
+
+            newest = sorted(glob.glob(os.path.join(log_dir, "seg-*.dlog")))[-1]
+            how = tear(newest, rng)
+            try:
+                decode_segment(newest)
+                torn = False    # cut right between two blocks
+            except AssertionError:
+                torn = True
+
+            proc = start(args.binary, log_dir, session)
+            time.sleep(1.0)
+            proc.kill()
+            output = proc.communicate()[0]
+
+            reported = re.search(r"session_log: .* cut (\d+) bytes", output)
+            try:
+                decode_all(log_dir)
+                decoded = True
+            except AssertionError as e:
+                print(e)
+                decoded = False
+            ok = decoded and (reported is not None or not torn)
+            failures += not ok
+            print(f"{'ok  ' if ok else 'FAIL'} run {run}: {how}, "
+                  f"{'cut ' + reported.group(1) + ' bytes' if reported else 'nothing cut'}")
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--binary", default="build/bin/lvglsim")
+    parser.add_argument("--rate", type=int, default=50000, help="samples/s of the replayed session")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("bench")
+    p.add_argument("--seconds", type=int, default=15)
+    p = sub.add_parser("crash")
+    p.add_argument("--runs", type=int, default=10)
+    p.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    return bench(args) if args.cmd == "bench" else crash(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Load generator and benchmark of the UDP telemetry receiver (src/udp_telem.c).
+
+send: sends telemetry packets to the dashboard at --rate packets/s per
+sender, one sender process per port. --drop and --reorder skip or swap
+a fraction of the packets to check the loss and reorder counters.
+
+bench: starts a headless dashboard listening on --ports, raises the rate
+step by step and reports the highest rate at which the dashboard neither
+lost packets nor had the kernel drop any. Each step lasts longer than the
+receiver's 10 s report period.
+"""
+
+import argparse
+import multiprocessing
+import os
+import random
+import re
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+MAGIC = 0xDA5B
+VERSION = 1
+CHANNEL_COUNT = 13
+HEADER = struct.Struct("=HBBII")
+
+
+def packet(seq, mask, t):
+    values = [50.0 + 40.0 * ((t + ch) % 10) / 10 for ch in range(CHANNEL_COUNT) if mask >> ch & 1]
+    return HEADER.pack(MAGIC, VERSION, 0, seq & 0xFFFFFFFF, mask) + struct.pack(f"={len(values)}f", *values)
+
+
+def sender(host, port, rate, seconds, drop, reorder, seed, counts):
+    rng = random.Random(seed)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 4 << 20)
+    masks = [(1 << CHANNEL_COUNT) - 1, 0b111, 0b1111000]
+    start = time.monotonic()
+    sent = seq = 0
+    held = None
+    while True:
+        elapsed = time.monotonic() - start
+        if elapsed >= seconds:
+            break
+        due = int(elapsed * rate) + 1
+        while sent < due:
+            data = packet(seq, masks[seq % len(masks)], seq)
+            seq += 1
+            sent += 1
+            if drop and rng.random() < drop:
+                continue
+            if reorder and held is None and rng.random() < reorder:
+                held = data
+                continue
+            try:
+                sock.sendto(data, (host, port))
+                if held is not None:
+                    sock.sendto(held, (host, port))
+                    held = None
+            except BlockingIOError:
+                pass
+        time.sleep(0.0002)
+    counts[port] = sent
+
+
+def send_all(host, ports, rate, seconds, drop=0.0, reorder=0.0, seed=1):
+    manager = multiprocessing.Manager()
+    counts = manager.dict()
+    procs = [multiprocessing.Process(target=sender, args=(host, port, rate, seconds, drop, reorder, seed + i, counts))
+             for i, port in enumerate(ports)]
+    for p in procs:
+        p.start()
+    for p in procs:
+        p.join()
+    return dict(counts)
+
+
+def bench(args):
+    env = dict(os.environ, DASH_HEADLESS="1", DASH_WATCHDOG_DEV="",
+               DASH_UDP=",".join(f"{args.host}:{p}" for p in args.ports))
+    proc = subprocess.Popen([args.binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    lines = []
+
+    def reader():
+        for line in proc.stdout:
+            lines.append(line)
+
+    threading.Thread(target=reader, daemon=True).start()
+    time.sleep(2)
+
+    pattern = re.compile(r"udp_telem: port (\d+): (\d+) packets/s, (\d+) lost, (\d+) reordered, (\d+) kernel drops")
+    best = 0
+    prev = {}
+    rate = args.start
+    try:
+        while rate <= args.max:
+            counts = send_all(args.host, args.ports, rate, args.step_s)
+            time.sleep(11)
+            latest = {}
+            for line in lines:
+                m = pattern.search(line)
+                if m:
+                    latest[int(m.group(1))] = (int(m.group(3)), int(m.group(5)))
+            losses = sum(lost + drops - sum(prev.get(port, (0, 0))) for port, (lost, drops) in latest.items())
+            prev = latest
+            total = int(sum(counts.values()) / args.step_s)
+            print(f"{total} packets/s: {'ok' if losses == 0 else f'{losses} lost'}")
+            if total < rate * len(args.ports) * 0.9:
+                print("the senders cannot go faster, add ports to add sender processes")
+                best = max(best, total) if not losses else best
+                break
+            if losses:
+                break
+            best = total
+            rate = int(rate * args.factor)
+    finally:
+        proc.kill()
+    print(f"max sustained rate {best} packets/s over {len(args.ports)} socket(s)")
+    return 0 if best else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--ports", type=lambda s: [int(p) for p in s.split(",")], default=[5005],
+                        help="comma separated, one sender process per port")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("send")
+    p.add_argument("--rate", type=int, default=1000, help="packets/s per port")
+    p.add_argument("--seconds", type=float, default=10)
+    p.add_argument("--drop", type=float, default=0.0, help="fraction of packets skipped")
+    p.add_argument("--reorder", type=float, default=0.0, help="fraction of packets sent late")
+    p = sub.add_parser("bench")
+    p.add_argument("--binary", default="build/bin/lvglsim")
+    p.add_argument("--start", type=int, default=5000, help="packets/s per port of the first step")
+    p.add_argument("--max", type=int, default=2000000)
+    p.add_argument("--factor", type=float, default=1.5)
+    p.add_argument("--step-s", type=float, default=12)
+    args = parser.parse_args()
+
+    if args.cmd == "bench":
+        return bench(args)
+    counts = send_all(args.host, args.ports, args.rate, args.seconds, args.drop, args.reorder)
+    for port, sent in sorted(counts.items()):
+        print(f"port {port}: {sent} packets")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+Load generator and benchmark of the VCU UART link (src/vcu_uart.c).
+
+send: writes COBS framed sample frames to a tty, e.g. a USB serial
+adapter looped to the dash, paced to the line rate of --baud (10 bits
+per byte). --corrupt flips a byte in a fraction of the frames to check
+the CRC and framing counters.
+
+bench: creates a pty pair, starts a headless dashboard on the pty and
+feeds it at each of --bauds in turn, then unthrottled. A pty has no line
+rate, pacing emulates it. Each step lasts longer than the link's 10 s
+report period and prints the frame rate the dashboard decoded next to
+the one offered.
+"""
+
+import argparse
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+SAMPLES = 1
+CHANNEL_COUNT = 13
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+        crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out.append(len(block) + 1)
+            out += block
+            block = bytearray()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out.append(255)
+                out += block
+                block = bytearray()
+    out.append(len(block) + 1)
+    out += block
+    return bytes(out)
+
+
+def frame(seq, t):
+    body = b"".join(struct.pack("<Bf", ch, 50.0 + (t + ch) % 100 * 0.5) for ch in range(CHANNEL_COUNT))
+    payload = bytes([SAMPLES, seq & 0xFF]) + body
+    return cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\0"
+
+
+def feed(fd, baud, seconds, corrupt=0.0, seed=1):
+    """Write frames for seconds, paced to baud if not None, return frames and bytes written"""
+    rng = random.Random(seed)
+    # Frames differ only in values, encode a set once so Python is not the bottleneck
+    frames = [frame(i, i) for i in range(256)]
+    start = time.monotonic()
+    sent = written = 0
+    while True:
+        elapsed = time.monotonic() - start
+        if elapsed >= seconds:
+            break
+        due = elapsed * baud / 10 if baud else written + 65536
+        chunk = bytearray()
+        while written + len(chunk) < due:
+            f = frames[sent & 0xFF]
+            if corrupt and rng.random() < corrupt:
+                f = bytearray(f)
+                f[rng.randrange(len(f) - 1)] ^= 0x10
+                f = bytes(f)
+            chunk += f
+            sent += 1
+        view = memoryview(chunk)
+        while view:
+            try:
+                view = view[os.write(fd, view):]
+            except BlockingIOError:
+                time.sleep(0.0005)
+        written += len(chunk)
+        time.sleep(0.001)
+    return sent, written
+
+
+def bench(args):
+    master, slave = os.openpty()
+    tty.setraw(master)
+    env = dict(os.environ, DASH_HEADLESS="1", DASH_WATCHDOG_DEV="", DASH_VCU_UART=os.ttyname(slave),
+               DASH_VCU_BAUD=str(args.bauds[0]))
+    proc = subprocess.Popen([args.binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    lines = []
+
+    def reader():
+        for line in proc.stdout:
+            lines.append(line)
+
+    threading.Thread(target=reader, daemon=True).start()
+    time.sleep(2)
+
+    pattern = re.compile(r"vcu_uart: (\d+) frames/s, (\d+) CRC errors, (\d+) framing errors, (\d+) lost")
+    try:
+        for baud in args.bauds + [None]:
+            seen = len(lines)
+            sent, written = feed(master, baud, args.step_s)
+            reports = [m for m in (pattern.search(line) for line in lines[seen:]) if m]
+            decoded = int(reports[-1].group(1)) if reports else 0
+            errors = sum(int(x) for x in reports[-1].groups()[1:]) if reports else 0
+            name = f"{baud} baud" if baud else "unthrottled"
+            print(f"{name}: offered {sent / args.step_s:.0f} frames/s ({written / args.step_s / 1024:.0f} KiB/s), "
+                  f"decoded {decoded} frames/s, {errors} errors so far")
+    finally:
+        proc.kill()
+        os.close(master)
+        os.close(slave)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("send")
+    p.add_argument("--tty", required=True)
+    p.add_argument("--baud", type=int, default=921600, help="pace to this line rate, 0 for unthrottled")
+    p.add_argument("--seconds", type=float, default=10)
+    p.add_argument("--corrupt", type=float, default=0.0, help="fraction of frames with a flipped byte")
+    p = sub.add_parser("bench")
+    p.add_argument("--binary", default="build/bin/lvglsim")
+    p.add_argument("--bauds", type=lambda s: [int(b) for b in s.split(",")], default=[921600, 2000000, 4000000])
+    p.add_argument("--step-s", type=float, default=12)
+    args = parser.parse_args()
+
+    if args.cmd == "bench":
+        return bench(args)
+
+    fd = os.open(args.tty, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    sent, written = feed(fd, args.baud or None, args.seconds, args.corrupt)
+    os.close(fd)
+    print(f"{sent} frames, {written} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
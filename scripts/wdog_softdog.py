@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Check the UI watchdog against the softdog module.
+
+Loads softdog with soft_noboot=1, so it only logs instead of rebooting,
+starts the dashboard with DASH_WDOG_TEST_STALL_S to freeze its UI loop,
+and checks that the stall is reported with a backtrace and that softdog
+fires once the dashboard stops petting it. Run it on the target as root.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def kernel_log():
+    return subprocess.run(["dmesg"], capture_output=True, text=True).stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--binary", default="build/bin/lvglsim")
+    parser.add_argument("--stall-after", type=int, default=10, help="seconds before the UI loop freezes")
+    parser.add_argument("--margin", type=int, default=5, help="softdog timeout, seconds")
+    args = parser.parse_args()
+
+    subprocess.run(["modprobe", "softdog", "soft_noboot=1", f"soft_margin={args.margin}"], check=True)
+    log_before = kernel_log()
+
+    env = dict(os.environ, DASH_WATCHDOG_DEV="/dev/watchdog",
+               DASH_WATCHDOG_TIMEOUT_S=str(args.margin),
+               DASH_WDOG_TEST_STALL_S=str(args.stall_after))
+    proc = subprocess.Popen([args.binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            text=True)
+    try:
+        time.sleep(args.stall_after + args.margin * 2)
+    finally:
+        proc.kill()
+        output = proc.communicate()[0]
+
+    new_log = kernel_log()[len(log_before):]
+    checks = {
+        "stall reported": "ui_watchdog: UI loop stalled" in output,
+        "backtrace printed": "backtrace of the UI thread" in output,
+        "softdog fired": "softdog" in new_log and ("Triggered" in new_log or "expired" in new_log),
+    }
+    for name, ok in checks.items():
+        print(f"{'ok  ' if ok else 'FAIL'} {name}")
+    return 0 if all(checks.values()) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
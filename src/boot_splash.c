@@ -0,0 +1,272 @@
+/**
+ * @file boot_splash.c
+ *
+ * Framebuffer boot splash and boot time milestones
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+
+#include "boot_splash.h"
+#include "logo_asset.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* lv_image_compressed_t header in front of the RLE stream */
+#define LOGO_RLE_HDR 12
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static uint64_t now_ns(void);
+static uint64_t process_start_ns(void);
+static bool logo_supported(void);
+static void blit_logo(uint8_t * fbp, const struct fb_var_screeninfo * vinfo, uint32_t line_length);
+static void put_pixel(uint8_t * dst, const uint8_t * src, uint32_t blk, const struct fb_var_screeninfo * vinfo);
+static uint32_t read_u32(const uint8_t * p);
+static void display_event_cb(lv_event_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const char * const mark_names[BOOT_MARK_COUNT] = {
+    [BOOT_MARK_MAIN]        = "main",
+    [BOOT_MARK_FIRST_PIXEL] = "first pixel",
+    [BOOT_MARK_FIRST_FRAME] = "first frame",
+    [BOOT_MARK_UI_BUILT]    = "ui built",
+    [BOOT_MARK_DASH_READY]  = "dash ready",
+};
+
+static uint64_t start_ns;
+static uint64_t marks_ns[BOOT_MARK_COUNT];
+static uint32_t longest_frame_ms;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int boot_splash_show(const char * fb_path)
+{
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+    size_t size;
+    uint8_t * fbp;
+    int fd;
+
+    boot_splash_mark(BOOT_MARK_MAIN);
+
+    if(!logo_supported()) return -1;
+
+    fd = open(fb_path, O_RDWR | O_CLOEXEC);
+    if(fd < 0) return -1;
+
+    if(ioctl(fd, FBIOGET_FSCREENINFO, &finfo) < 0 || ioctl(fd, FBIOGET_VSCREENINFO, &vinfo) < 0 ||
+       (vinfo.bits_per_pixel != 32 && vinfo.bits_per_pixel != 16) ||
+       vinfo.xres < oem_logo.header.w || vinfo.yres < oem_logo.header.h) {
+        close(fd);
+        return -1;
+    }
+
+    size = (size_t)finfo.line_length * vinfo.yres_virtual;
+    fbp = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(fbp == MAP_FAILED) return -1;
+
+    blit_logo(fbp, &vinfo, finfo.line_length);
+    munmap(fbp, size);
+
+    boot_splash_mark(BOOT_MARK_FIRST_PIXEL);
+    return 0;
+}
+
+void boot_splash_mark(boot_mark_t mark)
+{
+    if(mark >= BOOT_MARK_COUNT || marks_ns[mark] != 0) return;
+
+    if(start_ns == 0) start_ns = process_start_ns();
+    marks_ns[mark] = now_ns();
+}
+
+void boot_splash_handover(lv_display_t * disp)
+{
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, NULL);
+}
+
+void boot_splash_note_frame(uint32_t ms)
+{
+    if(marks_ns[BOOT_MARK_DASH_READY] != 0) return;
+    if(ms > longest_frame_ms) longest_frame_ms = ms;
+}
+
+int32_t boot_splash_get_ms(boot_mark_t mark)
+{
+    if(mark >= BOOT_MARK_COUNT || marks_ns[mark] == 0) return -1;
+    if(marks_ns[mark] < start_ns) return 0;
+    return (int32_t)((marks_ns[mark] - start_ns) / 1000000);
+}
+
+void boot_splash_report(FILE * f)
+{
+    int i;
+
+    fprintf(f, "boot:");
+    for(i = 0; i < BOOT_MARK_COUNT; i++) {
+        int32_t ms = boot_splash_get_ms((boot_mark_t)i);
+        if(ms < 0) fprintf(f, " %s=-", mark_names[i]);
+        else fprintf(f, " %s=%dms", mark_names[i], (int)ms);
+    }
+    fprintf(f, " (since process start), longest warm-up frame=%ums\n", (unsigned)longest_frame_ms);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * The splash only knows the output of scripts/gen_logo.py
+ */
+static bool logo_supported(void)
+{
+    return (oem_logo.header.flags & LV_IMAGE_FLAGS_COMPRESSED) &&
+           (oem_logo.header.cf == LV_COLOR_FORMAT_RGB565 || oem_logo.header.cf == LV_COLOR_FORMAT_XRGB8888) &&
+           oem_logo.data_size > LOGO_RLE_HDR && read_u32(oem_logo.data) == LV_IMAGE_COMPRESS_RLE;
+}
+
+/**
+ * Clear the visible screen and draw the logo, decoding its RLE stream
+ * straight into the framebuffer
+ */
+static void blit_logo(uint8_t * fbp, const struct fb_var_screeninfo * vinfo, uint32_t line_length)
+{
+    uint32_t bpp = vinfo->bits_per_pixel / 8;
+    uint32_t blk = oem_logo.header.cf == LV_COLOR_FORMAT_RGB565 ? 2 : 4;
+    uint32_t w = oem_logo.header.w;
+    uint32_t total = w * oem_logo.header.h;
+    uint8_t * screen = fbp + (size_t)vinfo->yoffset * line_length + (size_t)vinfo->xoffset * bpp;
+    int32_t x0 = ((int32_t)vinfo->xres - (int32_t)w) / 2;
+    int32_t y0 = ((int32_t)vinfo->yres - (int32_t)oem_logo.header.h) / 2 + BOOT_SPLASH_LOGO_OFS_Y;
+    const uint8_t * p = oem_logo.data + LOGO_RLE_HDR;
+    const uint8_t * end = p + read_u32(oem_logo.data + 4);
+    uint32_t i = 0;
+    uint32_t y;
+
+    if(y0 < 0) y0 = 0;
+
+    for(y = 0; y < vinfo->yres; y++) {
+        memset(screen + (size_t)y * line_length, 0, (size_t)vinfo->xres * bpp);
+    }
+
+    while(p < end && i < total) {
+        bool literal = (*p & 0x80) != 0;
+        uint32_t n = *p++ & 0x7f;
+
+        for(; n > 0 && i < total; n--, i++) {
+            uint32_t row = (uint32_t)y0 + i / w;
+            if(row < vinfo->yres) {
+                put_pixel(screen + (size_t)row * line_length + (size_t)(x0 + (int32_t)(i % w)) * bpp, p, blk, vinfo);
+            }
+            if(literal) p += blk;
+        }
+        if(!literal) p += blk;
+    }
+}
+
+/**
+ * Write one native logo pixel in the framebuffer's format
+ */
+static void put_pixel(uint8_t * dst, const uint8_t * src, uint32_t blk, const struct fb_var_screeninfo * vinfo)
+{
+    uint32_t r, g, b;
+
+    if(blk == 2) {
+        uint32_t c = (uint32_t)src[0] | ((uint32_t)src[1] << 8);
+        if(vinfo->bits_per_pixel == 16) {
+            memcpy(dst, src, 2);
+            return;
+        }
+        r = ((c >> 11) & 0x1f) << 3;
+        g = ((c >> 5) & 0x3f) << 2;
+        b = (c & 0x1f) << 3;
+    }
+    else {
+        b = src[0];
+        g = src[1];
+        r = src[2];
+    }
+
+    if(vinfo->bits_per_pixel == 32) {
+        uint32_t px = (r << vinfo->red.offset) | (g << vinfo->green.offset) | (b << vinfo->blue.offset);
+        memcpy(dst, &px, 4);
+    }
+    else {
+        uint16_t px = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        memcpy(dst, &px, 2);
+    }
+}
+
+static uint32_t read_u32(const uint8_t * p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void display_event_cb(lv_event_t * e)
+{
+    (void)e;
+    if(marks_ns[BOOT_MARK_FIRST_FRAME] == 0) boot_splash_mark(BOOT_MARK_FIRST_FRAME);
+    if(marks_ns[BOOT_MARK_UI_BUILT] == 0 || marks_ns[BOOT_MARK_DASH_READY] != 0) return;
+
+    boot_splash_mark(BOOT_MARK_DASH_READY);
+    boot_splash_report(stdout);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Get the start time of the process on the CLOCK_BOOTTIME time line
+ * @return nanoseconds, or the current time if /proc is not readable
+ */
+static uint64_t process_start_ns(void)
+{
+    char buf[512];
+    unsigned long long start_ticks;
+    const char * p;
+    ssize_t len;
+    long hz = sysconf(_SC_CLK_TCK);
+    int fd;
+    int field;
+
+    fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return now_ns();
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(len <= 0 || hz <= 0) return now_ns();
+    buf[len] = '\0';
+
+    /* The command name may contain spaces, fields are counted from its closing parenthesis */
+    p = strrchr(buf, ')');
+    if(p == NULL) return now_ns();
+
+    /* starttime is field 22, p points at the end of field 2 */
+    for(field = 2; field < 22 && p != NULL; field++) p = strchr(p + 1, ' ');
+    if(p == NULL || sscanf(p + 1, "%llu", &start_ticks) != 1) return now_ns();
+
+    return start_ticks * (1000000000ULL / (uint64_t)hz);
+}
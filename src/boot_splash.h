@@ -0,0 +1,103 @@
+/**
+ * @file boot_splash.h
+ *
+ * Boot splash written straight into the framebuffer.
+ *
+ * boot_splash_show() runs first thing in main(), before lv_init(), and
+ * draws the OEM logo where the logo screen puts it, so the driver sees it
+ * while LVGL, the GPIOs and the widgets are set up. The LVGL fbdev driver
+ * does not clear the framebuffer, so its first frame, which draws the same
+ * logo at the same place, replaces the splash without a visible change.
+ *
+ * Boot milestones are timestamped against the process start time taken from
+ * /proc/self/stat (clock tick resolution, usually 10 ms).
+ */
+
+#ifndef BOOT_SPLASH_H
+#define BOOT_SPLASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Offset of the logo from the screen center, same as on the logo screen */
+#define BOOT_SPLASH_LOGO_OFS_Y (-40)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    BOOT_MARK_MAIN,        /* main() entered */
+    BOOT_MARK_FIRST_PIXEL, /* splash written to the framebuffer */
+    BOOT_MARK_FIRST_FRAME, /* first LVGL frame flushed, LVGL owns the screen */
+    BOOT_MARK_UI_BUILT,    /* every screen constructed */
+    BOOT_MARK_DASH_READY,  /* first frame flushed after the UI was built */
+    BOOT_MARK_COUNT
+} boot_mark_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Draw the logo into the framebuffer, before lv_init()
+ * @param fb_path the framebuffer device, e.g. "/dev/fb0"
+ * @return 0 on success, -1 if the framebuffer can't be used (no splash)
+ */
+int boot_splash_show(const char * fb_path);
+
+/**
+ * Timestamp a boot milestone, only the first call per mark counts
+ * @param mark the milestone
+ */
+void boot_splash_mark(boot_mark_t mark);
+
+/**
+ * Mark BOOT_MARK_FIRST_FRAME and BOOT_MARK_DASH_READY from the flushes of a
+ * display, the milestones are printed when the dash is ready
+ * @param disp the display that replaces the splash
+ */
+void boot_splash_handover(lv_display_t * disp);
+
+/**
+ * Account one main loop iteration, the longest one before the dash is
+ * ready is reported as the longest warm-up frame
+ * @param ms duration of the iteration
+ */
+void boot_splash_note_frame(uint32_t ms);
+
+/**
+ * Get the time from process start to a milestone
+ * @param mark the milestone
+ * @return milliseconds, or -1 if the milestone was not reached
+ */
+int32_t boot_splash_get_ms(boot_mark_t mark);
+
+/**
+ * Print the boot milestones
+ * @param f the output stream
+ */
+void boot_splash_report(FILE * f);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*BOOT_SPLASH_H*/
@@ -0,0 +1,726 @@
+/**
+ * @file dash_alloc.c
+ *
+ * Counting TLSF memory manager backing LV_STDLIB_CUSTOM
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "dash_alloc.h"
+#include "simulator_util.h"
+
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define DEFAULT_HEAP_MB 32
+#define MAX_POOLS       4
+
+/* Payloads are 16 byte aligned and at least 16 bytes to hold the free list links */
+#define ALIGN_LOG2  4
+#define ALIGN_SIZE  (1u << ALIGN_LOG2)
+#define HDR_SIZE    ALIGN_SIZE
+#define MIN_PAYLOAD ALIGN_SIZE
+#define MAX_REQUEST (1u << 30)
+
+/* 16 second level lists per power of two, one linear first level below 256 bytes */
+#define SL_LOG2    4
+#define SL_COUNT   (1u << SL_LOG2)
+#define FL_SHIFT   (SL_LOG2 + ALIGN_LOG2)
+#define FL_COUNT   (32 - FL_SHIFT + 1)
+#define SMALL_SIZE (1u << FL_SHIFT)
+
+#define BLOCK_FREE 1u
+#define SIZE_MASK  (~(ALIGN_SIZE - 1))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct block_s {
+    struct block_s * prev_phys; /* NULL for the first block of a pool */
+    uint32_t size_flags;        /* payload size | BLOCK_FREE */
+    uint16_t site;              /* site that allocated the block */
+    uint16_t reserved;
+} block_t;
+
+/* Stored in the payload of free blocks */
+typedef struct {
+    block_t * next;
+    block_t * prev;
+} links_t;
+
+typedef struct {
+    void * mem;
+    size_t bytes;
+    bool mapped;
+    uint8_t * high;             /* end of the highest block handed out */
+} pool_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static uint32_t fls32(uint32_t x);
+static uint32_t ffs32(uint32_t x);
+static void mapping(uint32_t size, uint32_t * fl, uint32_t * sl);
+static block_t * find_free(uint32_t size);
+static void insert_free(block_t * b);
+static void remove_free(block_t * b);
+static void release(block_t * b);
+static void trim(block_t * b, uint32_t size);
+static void * alloc_locked(size_t size);
+static void count_alloc(block_t * b);
+static void count_free(block_t * b);
+static void count_resize(block_t * b, uint32_t old_size);
+static void note_high(block_t * b);
+static size_t prefault_pools(void);
+static void display_event_cb(lv_event_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t fl_bitmap;
+static uint32_t sl_bitmap[FL_COUNT];
+static block_t * heads[FL_COUNT][SL_COUNT];
+
+static pool_t pools[MAX_POOLS];
+static size_t total_bytes;
+static size_t used_bytes;
+static size_t max_used_bytes;
+
+static dash_alloc_site_stats_t sites[DASH_ALLOC_MAX_SITES] = {
+    [DASH_ALLOC_SITE_OTHER]  = {.name = "other"},
+    [DASH_ALLOC_SITE_RENDER] = {.name = "render"},
+};
+static uint32_t site_cnt = 2;
+static __thread uint32_t current_site;
+static uint32_t render_prev_site;
+static bool sealed;
+static bool strict;
+
+/**********************
+ *      MACROS
+ **********************/
+
+#define BLOCK_SIZE(b)  ((b)->size_flags & SIZE_MASK)
+#define IS_FREE(b)     ((b)->size_flags & BLOCK_FREE)
+#define PAYLOAD(b)     ((void *)((uint8_t *)(b) + HDR_SIZE))
+#define FROM_PAYLOAD(p) ((block_t *)((uint8_t *)(p) - HDR_SIZE))
+#define NEXT_PHYS(b)   ((block_t *)((uint8_t *)(b) + HDR_SIZE + BLOCK_SIZE(b)))
+#define LINKS(b)       ((links_t *)PAYLOAD(b))
+#define ALIGN_UP(x)    (((x) + ALIGN_SIZE - 1) & ~((size_t)ALIGN_SIZE - 1))
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void lv_mem_init(void)
+{
+    size_t bytes = (size_t)atoi(getenv_default("DASH_HEAP_MB", "0")) * 1024 * 1024;
+    void * mem;
+
+    if(bytes == 0) bytes = (size_t)DEFAULT_HEAP_MB * 1024 * 1024;
+    strict = atoi(getenv_default("DASH_ALLOC_STRICT", "0")) != 0;
+
+    mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED) die("Failed to map a %zu byte LVGL heap\n", bytes);
+
+    if(lv_mem_add_pool(mem, bytes) == NULL) die("Failed to set up the LVGL heap\n");
+    pools[0].mapped = true;
+}
+
+void lv_mem_deinit(void)
+{
+    int i;
+
+    for(i = 0; i < MAX_POOLS; i++) {
+        if(pools[i].mapped) munmap(pools[i].mem, pools[i].bytes);
+    }
+
+    memset(pools, 0, sizeof(pools));
+    memset(heads, 0, sizeof(heads));
+    memset(sl_bitmap, 0, sizeof(sl_bitmap));
+    fl_bitmap = 0;
+    total_bytes = 0;
+    used_bytes = 0;
+}
+
+lv_mem_pool_t lv_mem_add_pool(void * mem, size_t bytes)
+{
+    uint8_t * start = (uint8_t *)ALIGN_UP((uintptr_t)mem);
+    size_t usable = (bytes - (size_t)(start - (uint8_t *)mem)) & ~((size_t)ALIGN_SIZE - 1);
+    block_t * first;
+    block_t * sentinel;
+    int i;
+
+    /* One block header plus the end sentinel */
+    if(bytes < 2 * HDR_SIZE + MIN_PAYLOAD + ALIGN_SIZE) return NULL;
+    if(usable - 2 * HDR_SIZE > MAX_REQUEST) usable = MAX_REQUEST + 2 * HDR_SIZE;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < MAX_POOLS && pools[i].mem != NULL; i++);
+    if(i == MAX_POOLS) {
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+    pools[i].mem = mem;
+    pools[i].bytes = bytes;
+    pools[i].mapped = false;
+    pools[i].high = start;
+
+    first = (block_t *)start;
+    first->prev_phys = NULL;
+    first->size_flags = (uint32_t)(usable - 2 * HDR_SIZE);
+
+    sentinel = NEXT_PHYS(first);
+    sentinel->prev_phys = first;
+    sentinel->size_flags = 0;
+
+    total_bytes += BLOCK_SIZE(first);
+    insert_free(first);
+    pthread_mutex_unlock(&lock);
+
+    return mem;
+}
+
+void lv_mem_remove_pool(lv_mem_pool_t pool)
+{
+    /* Blocks of a pool may still be in the free lists, pools are never removed */
+    LV_UNUSED(pool);
+    LV_LOG_WARN("Removing a memory pool is not supported");
+}
+
+void * lv_malloc_core(size_t size)
+{
+    void * p;
+
+    pthread_mutex_lock(&lock);
+    p = alloc_locked(size);
+    pthread_mutex_unlock(&lock);
+
+    return p;
+}
+
+void * lv_realloc_core(void * p, size_t new_size)
+{
+    block_t * b;
+    block_t * next;
+    uint32_t size;
+    uint32_t old_size;
+    void * np;
+
+    if(p == NULL) return lv_malloc_core(new_size);
+    if(new_size == 0) {
+        lv_free_core(p);
+        return NULL;
+    }
+    if(new_size > MAX_REQUEST) return NULL;
+
+    size = (uint32_t)LV_MAX(ALIGN_UP(new_size), MIN_PAYLOAD);
+    b = FROM_PAYLOAD(p);
+    old_size = BLOCK_SIZE(b);
+
+    pthread_mutex_lock(&lock);
+
+    /* Shrinking or same size class: stays in place and is not an allocation */
+    if(old_size >= size) {
+        trim(b, size);
+        count_resize(b, old_size);
+        pthread_mutex_unlock(&lock);
+        return p;
+    }
+
+    /* Grow into the following free block if it is large enough, not an allocation either */
+    next = NEXT_PHYS(b);
+    if(IS_FREE(next) && old_size + HDR_SIZE + BLOCK_SIZE(next) >= size) {
+        remove_free(next);
+        b->size_flags = (uint32_t)(old_size + HDR_SIZE + BLOCK_SIZE(next));
+        NEXT_PHYS(b)->prev_phys = b;
+        trim(b, size);
+        count_resize(b, old_size);
+        pthread_mutex_unlock(&lock);
+        return p;
+    }
+
+    np = alloc_locked(new_size);
+    if(np != NULL) {
+        memcpy(np, p, BLOCK_SIZE(b));
+        count_free(b);
+        release(b);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return np;
+}
+
+void lv_free_core(void * p)
+{
+    block_t * b;
+
+    if(p == NULL) return;
+    b = FROM_PAYLOAD(p);
+
+    pthread_mutex_lock(&lock);
+    LV_ASSERT_MSG(!IS_FREE(b), "double free");
+    count_free(b);
+    release(b);
+    pthread_mutex_unlock(&lock);
+}
+
+void lv_mem_monitor_core(lv_mem_monitor_t * mon_p)
+{
+    block_t * b;
+    int i;
+
+    lv_memzero(mon_p, sizeof(*mon_p));
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < MAX_POOLS && pools[i].mem != NULL; i++) {
+        b = (block_t *)ALIGN_UP((uintptr_t)pools[i].mem);
+        for(; BLOCK_SIZE(b) != 0; b = NEXT_PHYS(b)) {
+            if(IS_FREE(b)) {
+                mon_p->free_cnt++;
+                mon_p->free_size += BLOCK_SIZE(b);
+                if(BLOCK_SIZE(b) > mon_p->free_biggest_size) mon_p->free_biggest_size = BLOCK_SIZE(b);
+            }
+            else {
+                mon_p->used_cnt++;
+            }
+        }
+    }
+    mon_p->total_size = total_bytes;
+    mon_p->max_used = max_used_bytes;
+    pthread_mutex_unlock(&lock);
+
+    if(mon_p->total_size) {
+        mon_p->used_pct = (uint8_t)(100 - mon_p->free_size * 100 / mon_p->total_size);
+    }
+    if(mon_p->free_size) {
+        mon_p->frag_pct = (uint8_t)(100 - mon_p->free_biggest_size * 100 / mon_p->free_size);
+    }
+}
+
+lv_result_t lv_mem_test_core(void)
+{
+    lv_result_t res = LV_RESULT_OK;
+    block_t * b;
+    block_t * prev;
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < MAX_POOLS && pools[i].mem != NULL; i++) {
+        prev = NULL;
+        b = (block_t *)ALIGN_UP((uintptr_t)pools[i].mem);
+        for(; BLOCK_SIZE(b) != 0; b = NEXT_PHYS(b)) {
+            /* Free neighbours are always merged */
+            if(b->prev_phys != prev || (prev && IS_FREE(prev) && IS_FREE(b))) {
+                res = LV_RESULT_INVALID;
+                break;
+            }
+            prev = b;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return res;
+}
+
+uint32_t dash_alloc_site(const char * name)
+{
+    uint32_t i;
+    uint32_t id = DASH_ALLOC_SITE_OTHER;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < site_cnt; i++) {
+        if(sites[i].name == name || strcmp(sites[i].name, name) == 0) {
+            id = i;
+            break;
+        }
+    }
+    if(i == site_cnt && site_cnt < DASH_ALLOC_MAX_SITES) {
+        sites[site_cnt].name = name;
+        id = site_cnt++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return id;
+}
+
+uint32_t dash_alloc_enter(uint32_t site)
+{
+    uint32_t prev = current_site;
+    current_site = site < DASH_ALLOC_MAX_SITES ? site : DASH_ALLOC_SITE_OTHER;
+    return prev;
+}
+
+void dash_alloc_leave(uint32_t prev)
+{
+    current_site = prev;
+}
+
+void dash_alloc_track_display(lv_display_t * disp)
+{
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, NULL);
+}
+
+void dash_alloc_seal(void)
+{
+    size_t prefaulted;
+
+    pthread_mutex_lock(&lock);
+    sealed = true;
+    prefaulted = prefault_pools();
+    pthread_mutex_unlock(&lock);
+
+    LV_LOG_USER("alloc: sealed with %zu bytes in use, %zu prefaulted%s", used_bytes, prefaulted,
+                strict ? ", strict" : "");
+}
+
+int dash_alloc_get_site_stats(uint32_t site, dash_alloc_site_stats_t * stats)
+{
+    if(site >= site_cnt) return -1;
+
+    pthread_mutex_lock(&lock);
+    *stats = sites[site];
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+void dash_alloc_report(FILE * f)
+{
+    dash_alloc_site_stats_t copy[DASH_ALLOC_MAX_SITES];
+    lv_mem_monitor_t mon;
+    uint32_t cnt;
+    uint32_t i;
+
+    pthread_mutex_lock(&lock);
+    cnt = site_cnt;
+    memcpy(copy, sites, sizeof(copy));
+    pthread_mutex_unlock(&lock);
+
+    lv_mem_monitor_core(&mon);
+    fprintf(f, "alloc: heap %zu/%zu bytes used, max %zu, frag %u%%\n",
+            mon.total_size - mon.free_size, mon.total_size, mon.max_used, (unsigned)mon.frag_pct);
+
+    for(i = 0; i < cnt; i++) {
+        fprintf(f, "alloc: %-12s allocs=%u frees=%u live=%zu after_seal=%u\n", copy[i].name,
+                (unsigned)copy[i].allocs, (unsigned)copy[i].frees, copy[i].live_bytes,
+                (unsigned)copy[i].sealed_allocs);
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static uint32_t fls32(uint32_t x)
+{
+    return 31 - (uint32_t)__builtin_clz(x);
+}
+
+static uint32_t ffs32(uint32_t x)
+{
+    return (uint32_t)__builtin_ctz(x);
+}
+
+/**
+ * Find the list of a block size
+ */
+static void mapping(uint32_t size, uint32_t * fl, uint32_t * sl)
+{
+    uint32_t f;
+
+    if(size < SMALL_SIZE) {
+        *fl = 0;
+        *sl = size >> ALIGN_LOG2;
+        return;
+    }
+
+    f = fls32(size);
+    *sl = (size >> (f - SL_LOG2)) ^ SL_COUNT;
+    *fl = f - FL_SHIFT + 1;
+}
+
+/**
+ * Find a free block of at least `size` bytes in O(1)
+ */
+static block_t * find_free(uint32_t size)
+{
+    uint32_t fl;
+    uint32_t sl;
+    uint32_t sl_map;
+    uint32_t fl_map;
+
+    /* Round up to the next list so any block of that list fits */
+    if(size >= SMALL_SIZE) size += (1u << (fls32(size) - SL_LOG2)) - 1;
+    mapping(size, &fl, &sl);
+    if(fl >= FL_COUNT) return NULL;
+
+    sl_map = sl_bitmap[fl] & (~0u << sl);
+    if(sl_map == 0) {
+        fl_map = fl + 1 < 32 ? fl_bitmap & (~0u << (fl + 1)) : 0;
+        if(fl_map == 0) return NULL;
+        fl = ffs32(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = ffs32(sl_map);
+
+    return heads[fl][sl];
+}
+
+static void insert_free(block_t * b)
+{
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(BLOCK_SIZE(b), &fl, &sl);
+    b->size_flags |= BLOCK_FREE;
+    LINKS(b)->prev = NULL;
+    LINKS(b)->next = heads[fl][sl];
+    if(heads[fl][sl]) LINKS(heads[fl][sl])->prev = b;
+    heads[fl][sl] = b;
+
+    fl_bitmap |= 1u << fl;
+    sl_bitmap[fl] |= 1u << sl;
+}
+
+static void remove_free(block_t * b)
+{
+    uint32_t fl;
+    uint32_t sl;
+    links_t * l = LINKS(b);
+
+    mapping(BLOCK_SIZE(b), &fl, &sl);
+    if(l->prev) LINKS(l->prev)->next = l->next;
+    else heads[fl][sl] = l->next;
+    if(l->next) LINKS(l->next)->prev = l->prev;
+
+    if(heads[fl][sl] == NULL) {
+        sl_bitmap[fl] &= ~(1u << sl);
+        if(sl_bitmap[fl] == 0) fl_bitmap &= ~(1u << fl);
+    }
+    b->size_flags &= ~BLOCK_FREE;
+}
+
+/**
+ * Merge a block with its free neighbours and put it in the free lists
+ */
+static void release(block_t * b)
+{
+    block_t * next = NEXT_PHYS(b);
+    block_t * prev = b->prev_phys;
+
+    if(IS_FREE(next)) {
+        remove_free(next);
+        b->size_flags = (uint32_t)(BLOCK_SIZE(b) + HDR_SIZE + BLOCK_SIZE(next));
+    }
+    if(prev && IS_FREE(prev)) {
+        remove_free(prev);
+        prev->size_flags = (uint32_t)(BLOCK_SIZE(prev) + HDR_SIZE + BLOCK_SIZE(b));
+        b = prev;
+    }
+    NEXT_PHYS(b)->prev_phys = b;
+    insert_free(b);
+}
+
+/**
+ * Give the tail of a used block back to the free lists if it is worth a block
+ */
+static void trim(block_t * b, uint32_t size)
+{
+    block_t * rest;
+    uint32_t bsize = BLOCK_SIZE(b);
+
+    if(bsize < size + HDR_SIZE + MIN_PAYLOAD) return;
+
+    b->size_flags = size | (b->size_flags & BLOCK_FREE);
+    rest = NEXT_PHYS(b);
+    rest->prev_phys = b;
+    rest->size_flags = bsize - size - HDR_SIZE;
+    NEXT_PHYS(rest)->prev_phys = rest;
+    release(rest);
+}
+
+static void * alloc_locked(size_t request)
+{
+    block_t * b;
+    uint32_t size;
+
+    if(request > MAX_REQUEST) return NULL;
+    size = (uint32_t)LV_MAX(ALIGN_UP(request), MIN_PAYLOAD);
+
+    b = find_free(size);
+    if(b == NULL) {
+        LV_LOG_ERROR("LVGL heap exhausted, %zu bytes requested, %zu in use", request, used_bytes);
+        return NULL;
+    }
+
+    remove_free(b);
+    trim(b, size);
+    count_alloc(b);
+
+    return PAYLOAD(b);
+}
+
+static void count_alloc(block_t * b)
+{
+    dash_alloc_site_stats_t * s = &sites[current_site];
+
+    b->site = (uint16_t)current_site;
+    s->allocs++;
+    s->live_bytes += BLOCK_SIZE(b);
+
+    used_bytes += BLOCK_SIZE(b);
+    if(used_bytes > max_used_bytes) max_used_bytes = used_bytes;
+    note_high(b);
+
+    if(sealed && current_site != DASH_ALLOC_SITE_RENDER) {
+        if(s->sealed_allocs++ == 0) {
+            LV_LOG_WARN("alloc: %u bytes allocated by %s after boot", (unsigned)BLOCK_SIZE(b), s->name);
+        }
+        LV_ASSERT_MSG(!strict, "allocation after boot");
+    }
+}
+
+static void count_free(block_t * b)
+{
+    dash_alloc_site_stats_t * s = &sites[b->site];
+
+    s->frees++;
+    s->live_bytes -= BLOCK_SIZE(b);
+    used_bytes -= BLOCK_SIZE(b);
+}
+
+/**
+ * Move the bytes of a block resized in place, it stays with the site that allocated it
+ */
+static void count_resize(block_t * b, uint32_t old_size)
+{
+    dash_alloc_site_stats_t * s = &sites[b->site];
+
+    s->live_bytes = s->live_bytes - old_size + BLOCK_SIZE(b);
+    used_bytes = used_bytes - old_size + BLOCK_SIZE(b);
+    if(used_bytes > max_used_bytes) max_used_bytes = used_bytes;
+    note_high(b);
+}
+
+/**
+ * Move the high-water mark of the block's pool past the block
+ */
+static void note_high(block_t * b)
+{
+    uint8_t * end = (uint8_t *)NEXT_PHYS(b);
+    int i;
+
+    for(i = 0; i < MAX_POOLS && pools[i].mem != NULL; i++) {
+        if((uint8_t *)b < (uint8_t *)pools[i].mem || (uint8_t *)b >= (uint8_t *)pools[i].mem + pools[i].bytes) continue;
+        if(end > pools[i].high) pools[i].high = end;
+        return;
+    }
+}
+
+/**
+ * Fault in every page of the pools up to their high-water mark, so the
+ * blocks the render pass reuses after the seal are backed and, with
+ * mlockall(MCL_ONFAULT), locked. Pages are written without changing them.
+ * @return the bytes prefaulted
+ */
+static size_t prefault_pools(void)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t bytes = 0;
+    uint8_t * start;
+    uint8_t * end;
+    uint8_t * p;
+    int i;
+
+    for(i = 0; i < MAX_POOLS && pools[i].mem != NULL; i++) {
+        start = (uint8_t *)((uintptr_t)pools[i].mem & ~(uintptr_t)(page - 1));
+        end = pools[i].high;
+        if(end <= start) continue;
+
+#ifdef MADV_POPULATE_WRITE
+        if(madvise(start, (size_t)(end - start), MADV_POPULATE_WRITE) == 0) {
+            bytes += (size_t)(end - start);
+            continue;
+        }
+#endif
+        /* Older kernels: an atomic add of 0 writes a page without losing a concurrent store */
+        for(p = (uint8_t *)pools[i].mem; p < end; p += page) {
+            __atomic_fetch_add(p, 0, __ATOMIC_SEQ_CST);
+        }
+        bytes += (size_t)(end - start);
+    }
+
+    return bytes;
+}
+
+static void display_event_cb(lv_event_t * e)
+{
+    if(lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        render_prev_site = dash_alloc_enter(DASH_ALLOC_SITE_RENDER);
+    }
+    else {
+        dash_alloc_leave(render_prev_site);
+    }
+}
+
+#else /*LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM*/
+
+/* Another allocator is configured: nothing is counted */
+
+uint32_t dash_alloc_site(const char * name)
+{
+    LV_UNUSED(name);
+    return DASH_ALLOC_SITE_OTHER;
+}
+
+uint32_t dash_alloc_enter(uint32_t site)
+{
+    LV_UNUSED(site);
+    return DASH_ALLOC_SITE_OTHER;
+}
+
+void dash_alloc_leave(uint32_t prev)
+{
+    LV_UNUSED(prev);
+}
+
+void dash_alloc_track_display(lv_display_t * disp)
+{
+    LV_UNUSED(disp);
+}
+
+void dash_alloc_seal(void)
+{
+}
+
+int dash_alloc_get_site_stats(uint32_t site, dash_alloc_site_stats_t * stats)
+{
+    LV_UNUSED(site);
+    LV_UNUSED(stats);
+    return -1;
+}
+
+void dash_alloc_report(FILE * f)
+{
+    fprintf(f, "alloc: LV_USE_STDLIB_MALLOC is not LV_STDLIB_CUSTOM, nothing counted\n");
+}
+
+#endif /*LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM*/
@@ -0,0 +1,117 @@
+/**
+ * @file dash_alloc.h
+ *
+ * LVGL memory manager for LV_STDLIB_CUSTOM.
+ *
+ * All LVGL allocations are served from an arena that is mapped once at
+ * lv_init() and managed with a two-level segregated fit (TLSF) allocator,
+ * so allocation time is bounded and the heap does not fragment over an
+ * endurance run.
+ *
+ * Allocations are counted per site. A site is a named scope entered with
+ * dash_alloc_enter(), e.g. a scheduler widget, the fault path or the LVGL
+ * render pass. After dash_alloc_seal() any allocation outside the render
+ * pass is a violation: it is logged, and aborts when DASH_ALLOC_STRICT=1.
+ *
+ * Environment:
+ * - DASH_HEAP_MB      arena size in MiB (default 32)
+ * - DASH_ALLOC_STRICT abort on the first allocation after the seal
+ */
+
+#ifndef DASH_ALLOC_H
+#define DASH_ALLOC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define DASH_ALLOC_MAX_SITES 32
+
+/* Predefined sites, more are added with dash_alloc_site() */
+#define DASH_ALLOC_SITE_OTHER  0
+#define DASH_ALLOC_SITE_RENDER 1
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char * name;
+    uint32_t allocs;        /* malloc and moving realloc calls */
+    uint32_t frees;
+    uint32_t sealed_allocs; /* allocations after dash_alloc_seal() */
+    size_t live_bytes;
+} dash_alloc_site_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Get or create the id of a named site
+ * @param name a string that stays valid, compared by pointer then by content
+ * @return the site id, DASH_ALLOC_SITE_OTHER if the table is full
+ */
+uint32_t dash_alloc_site(const char * name);
+
+/**
+ * Attribute the following allocations of the calling thread to a site
+ * @param site the site id
+ * @return the previous site, to be passed to dash_alloc_leave()
+ */
+uint32_t dash_alloc_enter(uint32_t site);
+
+/**
+ * Restore the site that was active before dash_alloc_enter()
+ * @param prev the value returned by dash_alloc_enter()
+ */
+void dash_alloc_leave(uint32_t prev);
+
+/**
+ * Attribute everything allocated while the display refreshes to the render site
+ * @param disp the display
+ */
+void dash_alloc_track_display(lv_display_t * disp);
+
+/**
+ * End of boot: from now on only the render pass may allocate. The heap is
+ * prefaulted up to its high-water mark, so the blocks reused later do not
+ * fault in pages.
+ */
+void dash_alloc_seal(void);
+
+/**
+ * Get the counters of a site
+ * @param site the site id
+ * @param stats filled with the counters
+ * @return 0 on success, -1 if the site does not exist
+ */
+int dash_alloc_get_site_stats(uint32_t site, dash_alloc_site_stats_t * stats);
+
+/**
+ * Print the per-site counters and the arena usage
+ * @param f the output stream
+ */
+void dash_alloc_report(FILE * f);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DASH_ALLOC_H*/
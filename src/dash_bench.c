@@ -0,0 +1,405 @@
+/**
+ * @file dash_bench.c
+ *
+ * Microbenchmarks of the dashboard's hot functions, see dash_calc.h
+ *
+ * Each benchmark doubles its batch of operations until a batch lasts
+ * DASH_BENCH_BATCH_MS, then times BENCH_REPEATS batches of that size and
+ * reports the median:
+ * - ns/op in wall time
+ * - cycles/op from a perf_event_open() cycle counter, when the kernel grants
+ *   one (perf_event_paranoid, a PMU the kernel knows)
+ * - allocs/op on the LVGL heap, counted by dash_alloc.c
+ *
+ * The widgets are real LVGL objects on a display that never renders, so
+ * setting a style costs what it costs on the dash.
+ *
+ * Usage: dash_bench [--json] [name filter]
+ * --json prints one JSON object per benchmark and line, tagged with the
+ * board, to collect and compare per board.
+ *
+ * Environment:
+ * - DASH_BENCH_BATCH_MS  length of a timed batch (default 20)
+ * - DASH_BENCH_BOARD     board name of the output (default the device
+ *                        tree model, else the machine)
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+
+#include "lvgl/lvgl.h"
+#include "dash_calc.h"
+#include "dash_alloc.h"
+#include "simulator_util.h"
+#include "dash_clock.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define BENCH_REPEATS 5
+
+/* As on the dash, see main.c */
+#define BENCH_BATTERY_SECTIONS 24
+#define BENCH_SLOGANS          64
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char * name;
+    void (*run)(uint32_t ops);
+} bench_t;
+
+typedef struct {
+    double ns_per_op;
+    double cycles_per_op;   /* < 0 without a cycle counter */
+    double allocs_per_op;
+    uint64_t ops;
+} bench_result_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void setup_widgets(void);
+static void flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map);
+static void measure(const bench_t * bench, bench_result_t * result);
+static void run_batch(const bench_t * bench, uint32_t ops, uint64_t * ns, uint64_t * cycles);
+static int open_cycle_counter(void);
+static const char * board_name(void);
+static int cmp_u64(const void * a, const void * b);
+
+static void bench_tire_color(uint32_t ops);
+static void bench_battery_color(uint32_t ops);
+static void bench_battery_bar_step(uint32_t ops);
+static void bench_battery_bar_full(uint32_t ops);
+static void bench_lap_time(uint32_t ops);
+static void bench_lap_label(uint32_t ops);
+static void bench_pick_unused(uint32_t ops);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const bench_t benches[] = {
+    {"tire_color", bench_tire_color},
+    {"battery_color", bench_battery_color},
+    {"battery_bar_step", bench_battery_bar_step},
+    {"battery_bar_full", bench_battery_bar_full},
+    {"lap_time", bench_lap_time},
+    {"lap_label", bench_lap_label},
+    {"pick_unused", bench_pick_unused},
+};
+
+static volatile uint32_t sink;
+
+static lv_obj_t * battery_segments[BENCH_BATTERY_SECTIONS];
+static int battery_filled = -1;
+static lv_obj_t * lap_label;
+static char lap_buf[16];
+static uint8_t slogans_used[(BENCH_SLOGANS + 7) / 8];
+static uint32_t rand_state = 1;
+
+static int cycle_fd = -1;
+static uint32_t batch_ms;
+static uint32_t bench_site;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(int argc, char ** argv)
+{
+    const char * filter = NULL;
+    const char * board;
+    bench_result_t r;
+    bool json = false;
+    uint32_t i;
+    int a;
+
+    for(a = 1; a < argc; a++) {
+        if(strcmp(argv[a], "--json") == 0) json = true;
+        else if(argv[a][0] == '-') {
+            fprintf(stderr, "usage: %s [--json] [name filter]\n", argv[0]);
+            return 2;
+        }
+        else filter = argv[a];
+    }
+
+    batch_ms = (uint32_t)LV_MAX(atoi(getenv_default("DASH_BENCH_BATCH_MS", "20")), 1);
+    board = board_name();
+
+    lv_init();
+    bench_site = dash_alloc_site("bench");
+    setup_widgets();
+
+    cycle_fd = open_cycle_counter();
+    if(cycle_fd < 0 && !json) printf("no cycle counter, cycles/op not measured\n");
+
+    for(i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if(filter != NULL && strstr(benches[i].name, filter) == NULL) continue;
+
+        measure(&benches[i], &r);
+        if(json) {
+            printf("{\"board\": \"%s\", \"bench\": \"%s\", \"ns_per_op\": %.2f, \"cycles_per_op\": ", board,
+                   benches[i].name, r.ns_per_op);
+            if(r.cycles_per_op < 0) printf("null");
+            else printf("%.1f", r.cycles_per_op);
+            printf(", \"allocs_per_op\": %.3f, \"ops\": %llu}\n", r.allocs_per_op, (unsigned long long)r.ops);
+        }
+        else {
+            printf("%-18s %10.2f ns/op", benches[i].name, r.ns_per_op);
+            if(r.cycles_per_op >= 0) printf(" %10.1f cycles/op", r.cycles_per_op);
+            printf(" %8.3f allocs/op\n", r.allocs_per_op);
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Create the battery bar and the lap label on a display that never renders
+ */
+static void setup_widgets(void)
+{
+    lv_display_t * disp = lv_display_create(800, 480);
+    uint32_t prev = dash_alloc_enter(bench_site);
+    int i;
+
+    lv_display_set_flush_cb(disp, flush_cb);
+
+    for(i = 0; i < BENCH_BATTERY_SECTIONS; i++) {
+        battery_segments[i] = lv_obj_create(lv_screen_active());
+        lv_obj_set_size(battery_segments[i], 80, 480 / BENCH_BATTERY_SECTIONS);
+        lv_obj_set_style_bg_color(battery_segments[i], lv_color_black(), LV_PART_MAIN);
+    }
+    lap_label = lv_label_create(lv_screen_active());
+
+    dash_alloc_leave(prev);
+}
+
+static void flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map)
+{
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Size the batch of a benchmark and time it
+ * @param bench the benchmark
+ * @param result filled with the medians per operation
+ */
+static void measure(const bench_t * bench, bench_result_t * result)
+{
+    dash_alloc_site_stats_t before;
+    dash_alloc_site_stats_t after;
+    uint64_t ns[BENCH_REPEATS];
+    uint64_t cycles[BENCH_REPEATS];
+    uint32_t ops = 1;
+    int i;
+
+    /* Also warms up the caches and the branch predictors */
+    for(;;) {
+        run_batch(bench, ops, &ns[0], &cycles[0]);
+        if(ns[0] >= (uint64_t)batch_ms * 1000000u || ops >= UINT32_MAX / 2) break;
+        ops *= 2;
+    }
+
+    dash_alloc_get_site_stats(bench_site, &before);
+    for(i = 0; i < BENCH_REPEATS; i++) run_batch(bench, ops, &ns[i], &cycles[i]);
+    dash_alloc_get_site_stats(bench_site, &after);
+
+    qsort(ns, BENCH_REPEATS, sizeof(ns[0]), cmp_u64);
+    qsort(cycles, BENCH_REPEATS, sizeof(cycles[0]), cmp_u64);
+
+    result->ops = (uint64_t)ops * BENCH_REPEATS;
+    result->ns_per_op = (double)ns[BENCH_REPEATS / 2] / ops;
+    result->cycles_per_op = cycle_fd >= 0 ? (double)cycles[BENCH_REPEATS / 2] / ops : -1.0;
+    result->allocs_per_op = (double)(after.allocs - before.allocs) / (double)result->ops;
+}
+
+/**
+ * Time one batch
+ * @param bench the benchmark
+ * @param ops operations in the batch
+ * @param ns set to the wall time
+ * @param cycles set to the cycles, 0 without a counter
+ */
+static void run_batch(const bench_t * bench, uint32_t ops, uint64_t * ns, uint64_t * cycles)
+{
+    uint32_t prev = dash_alloc_enter(bench_site);
+    uint64_t start;
+
+    *cycles = 0;
+    if(cycle_fd >= 0) {
+        ioctl(cycle_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(cycle_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    start = dash_clock_mono_us() * 1000;
+
+    bench->run(ops);
+
+    *ns = dash_clock_mono_us() * 1000 - start;
+    if(cycle_fd >= 0) {
+        ioctl(cycle_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(cycle_fd, cycles, sizeof(*cycles)) != sizeof(*cycles)) *cycles = 0;
+    }
+
+    dash_alloc_leave(prev);
+}
+
+/**
+ * Open a user space cycle counter of this thread
+ * @return its fd, -1 if the kernel does not grant one
+ */
+static int open_cycle_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Get the name of the board the results are tagged with
+ * @return DASH_BENCH_BOARD, the device tree model or the machine
+ */
+static const char * board_name(void)
+{
+    static char name[64];
+    static struct utsname uts;
+    const char * env = getenv_default("DASH_BENCH_BOARD", "");
+    FILE * f;
+    size_t len = 0;
+    size_t i;
+
+    if(env[0] != '\0') return env;
+
+    f = fopen("/proc/device-tree/model", "r");
+    if(f != NULL) {
+        len = fread(name, 1, sizeof(name) - 1, f);
+        fclose(f);
+    }
+    name[len] = '\0';
+    /* Kept printable and JSON safe */
+    for(i = 0; i < len && name[i] != '\0'; i++) {
+        if(name[i] == '"' || name[i] == '\\' || name[i] < ' ') name[i] = '_';
+    }
+    if(name[0] != '\0') return name;
+
+    return uname(&uts) == 0 ? uts.machine : "unknown";
+}
+
+static int cmp_u64(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Every temperature of the clamped range and a few outside it */
+static void bench_tire_color(uint32_t ops)
+{
+    lv_color_t c;
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        c = dash_calc_tire_color((int)(i % 211) - 5);
+        sink += c.red ^ c.green ^ c.blue;
+    }
+}
+
+static void bench_battery_color(uint32_t ops)
+{
+    lv_color_t c;
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        c = dash_calc_battery_color((int)(i % BENCH_BATTERY_SECTIONS), BENCH_BATTERY_SECTIONS);
+        sink += c.red ^ c.green ^ c.blue;
+    }
+}
+
+/* A draining pack, 1 % at a time: most calls change nothing */
+static void bench_battery_bar_step(uint32_t ops)
+{
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        dash_calc_battery_bar(battery_segments, BENCH_BATTERY_SECTIONS, &battery_filled, 100 - (int)(i % 101));
+    }
+}
+
+/* Empty to full and back: every call recolors every segment */
+static void bench_battery_bar_full(uint32_t ops)
+{
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        dash_calc_battery_bar(battery_segments, BENCH_BATTERY_SECTIONS, &battery_filled, i & 1 ? 100 : 0);
+    }
+}
+
+/* The lap clock at panel rate */
+static void bench_lap_time(uint32_t ops)
+{
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        dash_calc_lap_time(lap_buf, sizeof(lap_buf), i * 17);
+        sink += (uint8_t)lap_buf[7];
+    }
+}
+
+/* What lap_timer_cb() of main.c does: the text and the label update */
+static void bench_lap_label(uint32_t ops)
+{
+    uint32_t i;
+
+    for(i = 0; i < ops; i++) {
+        dash_calc_lap_time(lap_buf, sizeof(lap_buf), i * 17);
+        lv_label_set_text_static(lap_label, lap_buf);
+    }
+}
+
+static void bench_pick_unused(uint32_t ops)
+{
+    uint32_t i;
+    int picked;
+
+    for(i = 0; i < ops; i++) {
+        /* xorshift32, rand() would dominate */
+        rand_state ^= rand_state << 13;
+        rand_state ^= rand_state >> 17;
+        rand_state ^= rand_state << 5;
+        picked = dash_calc_pick_unused(slogans_used, BENCH_SLOGANS, (int)(rand_state >> 1));
+        /* Start over like slogan_rotation_pick() */
+        if(picked < 0) memset(slogans_used, 0, sizeof(slogans_used));
+        sink += (uint32_t)picked;
+    }
+}
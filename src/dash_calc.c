@@ -0,0 +1,103 @@
+/**
+ * @file dash_calc.c
+ *
+ * Widget computations, see dash_calc.h
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "dash_calc.h"
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+lv_color_t dash_calc_tire_color(int temp)
+{
+    float t;
+
+    if(temp < 0) temp = 0;
+    if(temp > 200) temp = 200;
+    if(temp <= 40) return lv_color_hex(0xC8C8C8);
+    if(temp <= 70) {
+        t = (temp - 40) / 30.0f;
+        return lv_color_make((uint8_t)(200 * (1 - t)), (uint8_t)(200 + 55 * t), (uint8_t)(200 * (1 - t)));
+    }
+    if(temp <= 90) return lv_color_hex(0x00FF00);
+    if(temp <= 120) {
+        t = (temp - 90) / 30.0f;
+        return lv_color_make((uint8_t)(255 * t), (uint8_t)(255 * (1 - t)), 0);
+    }
+    return lv_color_hex(0xFF0000);
+}
+
+lv_color_t dash_calc_battery_color(int index, int total)
+{
+    float t = (float)index / (total - 1);
+    float lt;
+    uint8_t r;
+    uint8_t g;
+
+    if(t <= 0.25f) {
+        lt = t / 0.25f;
+        r = 255;
+        g = lt < 0.5f ? (uint8_t)(lt / 0.5f * 120) : (uint8_t)(120 + (lt - 0.5f) / 0.5f * (200 - 120));
+    }
+    else {
+        lt = (t - 0.25f) / 0.75f;
+        r = (uint8_t)((1 - lt) * 255);
+        g = (uint8_t)(200 + lt * (255 - 200));
+    }
+    return lv_color_make(r, g, 0);
+}
+
+void dash_calc_battery_bar(lv_obj_t * const * segments, int total, int * filled, int percentage)
+{
+    int now;
+    int lo;
+    int hi;
+    int i;
+
+    if(percentage < 0) percentage = 0;
+    if(percentage > 100) percentage = 100;
+    now = (percentage * total + 99) / 100;
+    if(now == *filled) return;
+
+    /* Only the segments between the old and the new level change color */
+    lo = *filled < 0 ? 0 : LV_MIN(now, *filled);
+    hi = *filled < 0 ? total : LV_MAX(now, *filled);
+    for(i = lo; i < hi; i++) {
+        lv_obj_set_style_bg_color(segments[i], i < now ? dash_calc_battery_color(i, total) : lv_color_black(),
+                                  LV_PART_MAIN);
+    }
+    *filled = now;
+}
+
+void dash_calc_lap_time(char * buf, size_t size, uint32_t elapsed_ms)
+{
+    lv_snprintf(buf, size, "%02lu:%02lu.%03lu", (unsigned long)(elapsed_ms / 60000),
+                (unsigned long)(elapsed_ms % 60000 / 1000), (unsigned long)(elapsed_ms % 1000));
+}
+
+int dash_calc_pick_unused(uint8_t * used, int count, int r)
+{
+    int unused = 0;
+    int target;
+    int i;
+
+    for(i = 0; i < count; i++) {
+        if(!(used[i / 8] & (1u << (i % 8)))) unused++;
+    }
+    if(unused == 0) return -1;
+
+    target = (int)((unsigned)r % (unsigned)unused);
+    for(i = 0; i < count; i++) {
+        if(used[i / 8] & (1u << (i % 8))) continue;
+        if(target-- == 0) break;
+    }
+    if(i == count) i = 0;
+
+    used[i / 8] |= (uint8_t)(1u << (i % 8));
+    return i;
+}
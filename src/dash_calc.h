@@ -0,0 +1,87 @@
+/**
+ * @file dash_calc.h
+ *
+ * The computations behind the dashboard widgets: tire and battery colors,
+ * the battery bar, the lap time text and the pick of an unused slogan.
+ *
+ * They are kept out of main.c so that dash_bench.c can time them on their
+ * own. Nothing here keeps state, the callers own it.
+ */
+
+#ifndef DASH_CALC_H
+#define DASH_CALC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* "mm:ss.mmm" and its terminator */
+#define DASH_CALC_LAP_TIME_LEN 10
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Get the color of a tire temperature: grey when cold, green in the
+ * window, red when overheating
+ * @param temp temperature in degC
+ * @return the color
+ */
+lv_color_t dash_calc_tire_color(int temp);
+
+/**
+ * Get the color of a battery bar segment, red at the bottom to green at the top
+ * @param index the segment, 0 at the bottom
+ * @param total number of segments
+ * @return the color
+ */
+lv_color_t dash_calc_battery_color(int index, int total);
+
+/**
+ * Color the battery bar for a state of charge, only the segments that change
+ * @param segments the segment objects, bottom first
+ * @param total number of segments
+ * @param filled segments lit so far, -1 before the first call, updated
+ * @param percentage the state of charge
+ */
+void dash_calc_battery_bar(lv_obj_t * const * segments, int total, int * filled, int percentage);
+
+/**
+ * Format a lap time
+ * @param buf filled with "mm:ss.mmm"
+ * @param size size of buf, DASH_CALC_LAP_TIME_LEN or more
+ * @param elapsed_ms the lap time
+ */
+void dash_calc_lap_time(char * buf, size_t size, uint32_t elapsed_ms);
+
+/**
+ * Pick an entry that was not picked yet and mark it
+ * @param used bitmap of the picked entries, count bits
+ * @param count number of entries
+ * @param r a random number
+ * @return the picked entry, -1 if count is 0 or every entry was picked
+ */
+int dash_calc_pick_unused(uint8_t * used, int count, int r);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DASH_CALC_H*/
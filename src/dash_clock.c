@@ -0,0 +1,98 @@
+/**
+ * @file dash_clock.c
+ *
+ * Monotonic or virtual time base of the dashboard
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl/lvgl.h"
+#include "dash_clock.h"
+#include "simulator_util.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static uint32_t tick_cb(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static bool virtual_mode;
+
+/* Written by the UI thread only, read by any */
+static uint64_t virtual_us = (uint64_t)DASH_CLOCK_VIRTUAL_START_MS * 1000;
+
+static uint64_t end_us;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void dash_clock_init(void)
+{
+    const char * mode = getenv_default("DASH_CLOCK", "monotonic");
+    double end_s = atof(getenv_default("DASH_CLOCK_END_S", "0"));
+
+    if(strcmp(mode, "virtual") == 0) {
+        virtual_mode = true;
+        if(end_s > 0) end_us = (uint64_t)DASH_CLOCK_VIRTUAL_START_MS * 1000 + (uint64_t)(end_s * 1e6);
+        LV_LOG_USER("clock: virtual%s", end_us ? ", ends after DASH_CLOCK_END_S" : "");
+    }
+    else if(strcmp(mode, "monotonic") != 0) {
+        fprintf(stderr, "clock: unknown DASH_CLOCK \"%s\", using the monotonic clock\n", mode);
+    }
+
+    lv_tick_set_cb(tick_cb);
+}
+
+bool dash_clock_is_virtual(void)
+{
+    return virtual_mode;
+}
+
+uint64_t dash_clock_now_us(void)
+{
+    if(virtual_mode) return __atomic_load_n(&virtual_us, __ATOMIC_ACQUIRE);
+    return dash_clock_mono_us();
+}
+
+uint32_t dash_clock_now_ms(void)
+{
+    return (uint32_t)(dash_clock_now_us() / 1000);
+}
+
+void dash_clock_advance(uint32_t ms)
+{
+    if(!virtual_mode) return;
+    __atomic_store_n(&virtual_us, virtual_us + (uint64_t)ms * 1000, __ATOMIC_RELEASE);
+}
+
+bool dash_clock_end_reached(void)
+{
+    return end_us != 0 && dash_clock_now_us() >= end_us;
+}
+
+uint64_t dash_clock_mono_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static uint32_t tick_cb(void)
+{
+    return dash_clock_now_ms();
+}
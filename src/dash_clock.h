@@ -0,0 +1,102 @@
+/**
+ * @file dash_clock.h
+ *
+ * The time base of the dashboard: LVGL's tick, the lap timer, the mode
+ * confirmation delay, telemetry timestamps and interpolation all read it.
+ *
+ * By default it is CLOCK_MONOTONIC. With DASH_CLOCK=virtual it is a
+ * counter that only moves when the UI loop advances it: instead of
+ * sleeping, refresh_governor_wait() polls the wake fds without blocking
+ * and advances the clock by the time it would have slept, at least 1 ms.
+ * A session then runs as fast as its frames can be drawn and the same
+ * inputs give the same frames, whatever the machine.
+ *
+ * In virtual mode a replay follows the clock from the UI loop (see
+ * replay.h) and the frame budget of update_sched.c is not applied, since
+ * it depends on how fast the machine renders. Threads fed by the outside
+ * world (UDP, UART, telem_synth.c) and the watchdog keep running on wall
+ * time. Durations of work, e.g. render times, are always wall time.
+ *
+ * Environment:
+ * - DASH_CLOCK        "monotonic" (default) or "virtual"
+ * - DASH_CLOCK_END_S  exit after this many seconds of virtual time, 0 to
+ *                     run forever (default)
+ */
+
+#ifndef DASH_CLOCK_H
+#define DASH_CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Virtual time at start, not 0 which telemetry reads as "no sample yet" */
+#define DASH_CLOCK_VIRTUAL_START_MS 1000
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Select the clock from DASH_CLOCK and make it LVGL's tick, call after lv_init()
+ */
+void dash_clock_init(void);
+
+/**
+ * Tell whether the clock is virtual
+ * @return true with DASH_CLOCK=virtual
+ */
+bool dash_clock_is_virtual(void);
+
+/**
+ * Get the current time, any thread
+ * @return microseconds since an arbitrary point
+ */
+uint64_t dash_clock_now_us(void);
+
+/**
+ * Get the current time, any thread
+ * @return milliseconds since an arbitrary point, wraps like lv_tick_get()
+ */
+uint32_t dash_clock_now_ms(void);
+
+/**
+ * Move the virtual clock forward, nothing on the monotonic clock
+ * @param ms milliseconds to advance
+ */
+void dash_clock_advance(uint32_t ms);
+
+/**
+ * Tell whether DASH_CLOCK_END_S of virtual time have passed
+ * @return true if the run should end
+ */
+bool dash_clock_end_reached(void);
+
+/**
+ * Get the monotonic wall time, also with DASH_CLOCK=virtual. For durations
+ * of work and the threads that run on wall time; computed in 64 bits, so
+ * it does not overflow with a 32-bit time_t. Truncating it to 32 bits
+ * gives microseconds that wrap like lv_tick_get().
+ * @return microseconds since an arbitrary point
+ */
+uint64_t dash_clock_mono_us(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DASH_CLOCK_H*/
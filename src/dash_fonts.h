@@ -0,0 +1,54 @@
+/**
+ * @file dash_fonts.h
+ *
+ * Roboto fonts of the dashboard.
+ *
+ * With DASH_FONT_SUBSET they are generated at build time with only the
+ * glyphs the dashboard shows, see src/fonts.txt, and the full fonts of the
+ * LVGL tree are not referenced. Without it the names stand for the full
+ * fonts.
+ */
+
+#ifndef DASH_FONTS_H
+#define DASH_FONTS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#if DASH_FONT_SUBSET
+LV_FONT_DECLARE(dash_font_roboto_24)
+LV_FONT_DECLARE(dash_font_roboto_32)
+LV_FONT_DECLARE(dash_font_roboto_40)
+LV_FONT_DECLARE(dash_font_roboto_48)
+LV_FONT_DECLARE(dash_font_roboto_64)
+LV_FONT_DECLARE(dash_font_roboto_184)
+#else
+#define dash_font_roboto_24  lv_font_roboto_24
+#define dash_font_roboto_32  lv_font_roboto_32
+#define dash_font_roboto_40  lv_font_roboto_40
+#define dash_font_roboto_48  lv_font_roboto_48
+#define dash_font_roboto_64  lv_font_roboto_64
+#define dash_font_roboto_184 lv_font_roboto_184
+LV_FONT_DECLARE(lv_font_roboto_24)
+LV_FONT_DECLARE(lv_font_roboto_32)
+LV_FONT_DECLARE(lv_font_roboto_40)
+LV_FONT_DECLARE(lv_font_roboto_48)
+LV_FONT_DECLARE(lv_font_roboto_64)
+LV_FONT_DECLARE(lv_font_roboto_184)
+#endif
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DASH_FONTS_H*/
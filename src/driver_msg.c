@@ -0,0 +1,490 @@
+/**
+ * @file driver_msg.c
+ *
+ * Driver message channel, layout worker and priority queue
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "driver_msg.h"
+#include "dash_clock.h"
+#include "rt_threads.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The metrics table covers printable ASCII, anything else is drawn as '?' */
+#define FIRST_CHAR 0x20
+#define LAST_CHAR  0x7E
+#define CHAR_CNT   (LAST_CHAR - FIRST_CHAR + 1)
+#define NO_NEXT    CHAR_CNT
+
+/* Queued messages, the one the worker lays out and the one on screen */
+#define POOL_SIZE (DRIVER_MSG_QUEUE_LEN + 2)
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * worker_main(void * arg);
+static bool layout(driver_msg_t * m, const char * in, size_t len);
+static bool add_line(driver_msg_t * m, uint32_t start, uint32_t end);
+static int32_t text_width(const char * s, uint32_t len);
+static driver_msg_t * enqueue(driver_msg_t * m);
+static int best_prio(void);
+static bool is_due(int prio);
+static int open_socket(const char * path);
+static const char * socket_path(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/* Advance of a glyph followed by another one, kerning included. Filled on
+ * the UI thread at init, only read by the worker afterwards */
+static uint8_t advance[CHAR_CNT][CHAR_CNT + 1];
+static int32_t max_width;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static driver_msg_t pool[POOL_SIZE];
+static driver_msg_t * free_msgs[POOL_SIZE];
+static uint32_t free_cnt;
+static driver_msg_t * queue[DRIVER_MSG_PRIO_COUNT][DRIVER_MSG_QUEUE_LEN];
+static uint32_t queue_head[DRIVER_MSG_PRIO_COUNT];
+static uint32_t queue_cnt[DRIVER_MSG_PRIO_COUNT];
+static uint32_t queued;
+static uint32_t next_seq;
+static uint64_t layout_total_us;
+static driver_msg_stats_t stats;
+
+/* UI thread side */
+static driver_msg_t * shown;
+static uint32_t shown_tick;
+static uint32_t min_show_ms = DRIVER_MSG_MIN_SHOW_MS;
+static uint32_t burst_cnt;
+static uint32_t burst_max_us;
+
+static int sock_fd = -1;
+static int wake_fd = -1;
+static char path_buf[108];
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int driver_msg_init(const lv_font_t * font, int32_t width)
+{
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    const char * path = socket_path();
+    const char * env;
+    uint32_t a, b;
+
+    LV_ASSERT_NULL(font);
+
+    for(a = 0; a < CHAR_CNT; a++) {
+        for(b = 0; b <= CHAR_CNT; b++) {
+            uint16_t w = lv_font_get_glyph_width(font, FIRST_CHAR + a, b == NO_NEXT ? 0 : FIRST_CHAR + b);
+            advance[a][b] = (uint8_t)LV_MIN(w, 255);
+        }
+    }
+    max_width = width;
+
+    env = getenv("DRIVER_MSG_MIN_SHOW_MS");
+    if(env != NULL && env[0] != '\0') min_show_ms = (uint32_t)strtoul(env, NULL, 10);
+
+    for(a = 0; a < POOL_SIZE; a++) free_msgs[a] = &pool[a];
+    free_cnt = POOL_SIZE;
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(wake_fd < 0) return -1;
+
+    sock_fd = open_socket(path);
+    if(sock_fd < 0) return -1;
+
+    /* Off the CPUs of the UI and input, see rt_threads.h */
+    if(rt_threads_create(RT_THREAD_BACKGROUND, "driver-msg", worker_main, NULL) != 0) {
+        fprintf(stderr, "driver_msg: could not start the layout worker\n");
+        return -1;
+    }
+
+    LV_LOG_USER("driver_msg: listening on %s, glyph metrics ready in %uus", path,
+                (unsigned)((uint32_t)dash_clock_mono_us() - start));
+    return 0;
+}
+
+int driver_msg_get_wake_fd(void)
+{
+    return wake_fd;
+}
+
+const driver_msg_t * driver_msg_take(void)
+{
+    driver_msg_t * m;
+    uint64_t cnt;
+    int prio;
+
+    if(wake_fd >= 0 && read(wake_fd, &cnt, sizeof(cnt)) < 0) {
+        /* Nothing laid out since the last call, EAGAIN */
+    }
+
+    pthread_mutex_lock(&lock);
+    prio = best_prio();
+    if(prio < 0 || !is_due(prio)) {
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    m = queue[prio][queue_head[prio]];
+    queue_head[prio] = (queue_head[prio] + 1) % DRIVER_MSG_QUEUE_LEN;
+    queue_cnt[prio]--;
+    queued--;
+
+    /* The previous message is no longer drawn from */
+    if(shown != NULL) free_msgs[free_cnt++] = shown;
+    shown = m;
+    stats.shown++;
+    pthread_mutex_unlock(&lock);
+
+    shown_tick = lv_tick_get();
+    burst_cnt++;
+    return m;
+}
+
+uint32_t driver_msg_next_ms(void)
+{
+    uint32_t elapsed;
+    int prio;
+    bool due;
+
+    pthread_mutex_lock(&lock);
+    prio = best_prio();
+    due = prio >= 0 && is_due(prio);
+    pthread_mutex_unlock(&lock);
+
+    if(prio < 0) return LV_NO_TIMER_READY;
+    if(due) return 0;
+
+    /* The tick moved since is_due(), the message may have become due in between */
+    elapsed = lv_tick_elaps(shown_tick);
+    return elapsed >= min_show_ms ? 0 : min_show_ms - elapsed;
+}
+
+void driver_msg_note_frame(uint32_t us)
+{
+    uint32_t left;
+
+    if(burst_cnt == 0) return;
+    if(us > burst_max_us) burst_max_us = us;
+
+    pthread_mutex_lock(&lock);
+    left = queued;
+    pthread_mutex_unlock(&lock);
+    if(left != 0) return;
+
+    /* The queue drained, the burst is over */
+    stats.burst_max_frame_us = burst_max_us;
+    LV_LOG_USER("driver_msg: burst of %u messages, worst frame %uus, layout avg %uus max %uus, %u dropped",
+                (unsigned)burst_cnt, (unsigned)burst_max_us, (unsigned)stats.layout_avg_us,
+                (unsigned)stats.layout_max_us, (unsigned)stats.dropped);
+    burst_cnt = 0;
+    burst_max_us = 0;
+}
+
+void driver_msg_get_stats(driver_msg_stats_t * out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * worker_main(void * arg)
+{
+    char buf[DRIVER_MSG_MAX_LEN + 2];
+    driver_msg_t * m;
+    driver_msg_t * dropped;
+    uint64_t one = 1;
+    uint32_t start;
+    uint32_t elapsed;
+    ssize_t n;
+    size_t len;
+    size_t skip;
+    bool truncated;
+
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+    m = free_msgs[--free_cnt];
+    pthread_mutex_unlock(&lock);
+
+    while(1) {
+        /* MSG_TRUNC returns the datagram's real length */
+        n = recv(sock_fd, buf, sizeof(buf), MSG_TRUNC);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            fprintf(stderr, "driver_msg: receive failed: %s\n", strerror(errno));
+            return NULL;
+        }
+
+        start = (uint32_t)dash_clock_mono_us();
+        len = LV_MIN((size_t)n, sizeof(buf));
+
+        m->prio = DRIVER_MSG_PRIO_NORMAL;
+        skip = 0;
+        if(len >= 2 && buf[0] >= '0' && buf[0] < '0' + DRIVER_MSG_PRIO_COUNT && buf[1] == ' ') {
+            m->prio = (driver_msg_prio_t)(buf[0] - '0');
+            skip = 2;
+        }
+
+        truncated = (size_t)n - skip > DRIVER_MSG_MAX_LEN;
+        len = LV_MIN(len - skip, (size_t)DRIVER_MSG_MAX_LEN);
+        if(!layout(m, buf + skip, len)) truncated = true;
+        elapsed = (uint32_t)dash_clock_mono_us() - start;
+        m->layout_us = elapsed;
+
+        pthread_mutex_lock(&lock);
+        m->seq = next_seq++;
+        stats.received++;
+        if(truncated) stats.truncated++;
+        layout_total_us += elapsed;
+        stats.layout_avg_us = (uint32_t)(layout_total_us / stats.received);
+        if(elapsed > stats.layout_max_us) stats.layout_max_us = elapsed;
+
+        dropped = enqueue(m);
+        if(dropped != NULL) {
+            stats.dropped++;
+            if(dropped != m) free_msgs[free_cnt++] = dropped;
+        }
+        if(dropped != m) m = free_msgs[--free_cnt];
+        pthread_mutex_unlock(&lock);
+
+        if(write(wake_fd, &one, sizeof(one)) < 0) {
+            /* Counter saturated, the UI is awake anyway */
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Break a text into centered lines of at most max_width pixels,
+ * at spaces where possible, inside words otherwise
+ * @param m receives the lines
+ * @param in the text, UTF-8, not NUL terminated
+ * @param len length of the text in bytes
+ * @return false if lines were cut
+ */
+static bool layout(driver_msg_t * m, const char * in, size_t len)
+{
+    uint32_t o = 0;         /* write position in m->text */
+    uint32_t line = 0;      /* start of the current line */
+    uint32_t brk = 0;       /* last space of the current line, 0 if none */
+    size_t i;
+    unsigned char u;
+    char c;
+
+    m->line_cnt = 0;
+
+    for(i = 0; i < len; i++) {
+        /* Room for this character, and a terminator or a break before it */
+        if(o + 2 >= sizeof(m->text)) break;
+
+        u = (unsigned char)in[i];
+        if(u >= 0x80) {
+            /* One replacement per code point */
+            while(i + 1 < len && ((unsigned char)in[i + 1] & 0xC0) == 0x80) i++;
+            c = '?';
+        }
+        else if(u == '\n') {
+            if(!add_line(m, line, o)) return false;
+            line = ++o;
+            brk = 0;
+            continue;
+        }
+        else if(u < FIRST_CHAR || u > LAST_CHAR) {
+            c = ' ';
+        }
+        else {
+            c = (char)u;
+        }
+
+        /* No spaces at the start of a line */
+        if(c == ' ' && o == line) continue;
+
+        m->text[o++] = c;
+        if(c == ' ') {
+            brk = o - 1;
+            continue;
+        }
+
+        while(text_width(m->text + line, o - line) > max_width) {
+            if(brk > line) {
+                /* Break at the last space */
+                if(!add_line(m, line, brk)) return false;
+                line = brk + 1;
+                brk = 0;
+            }
+            else if(o - line > 1) {
+                /* A word wider than the box, break before this character */
+                o--;
+                if(!add_line(m, line, o)) return false;
+                line = ++o;
+                m->text[o++] = c;
+                break;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    if(o > line || m->line_cnt == 0) {
+        if(!add_line(m, line, o)) return false;
+    }
+
+    return i >= len;
+}
+
+/**
+ * Terminate a line of m->text and add it, centered
+ * @param m the message
+ * @param start offset of the line
+ * @param end offset after its last character, the terminator goes there
+ * @return false if the message has DRIVER_MSG_MAX_LINES lines already
+ */
+static bool add_line(driver_msg_t * m, uint32_t start, uint32_t end)
+{
+    scroll_text_line_t * l;
+
+    if(m->line_cnt >= DRIVER_MSG_MAX_LINES) return false;
+
+    while(end > start && m->text[end - 1] == ' ') end--;
+    m->text[end] = '\0';
+
+    l = &m->lines[m->line_cnt++];
+    l->start = (uint16_t)start;
+    l->x = (int16_t)((max_width - text_width(m->text + start, end - start)) / 2);
+    return true;
+}
+
+static int32_t text_width(const char * s, uint32_t len)
+{
+    int32_t w = 0;
+    uint32_t i;
+
+    for(i = 0; i < len; i++) {
+        uint32_t next = i + 1 < len ? (uint32_t)(s[i + 1] - FIRST_CHAR) : NO_NEXT;
+        w += advance[s[i] - FIRST_CHAR][next];
+    }
+
+    return w;
+}
+
+/**
+ * Queue a laid out message, lock held
+ * @param m the message
+ * @return the message pushed out of a full queue, m itself if it is the least urgent, or NULL
+ */
+static driver_msg_t * enqueue(driver_msg_t * m)
+{
+    driver_msg_t * dropped = NULL;
+    int low;
+
+    if(queued >= DRIVER_MSG_QUEUE_LEN) {
+        /* The oldest of the least urgent messages makes room */
+        for(low = DRIVER_MSG_PRIO_COUNT - 1; queue_cnt[low] == 0; low--) {}
+        if(low < (int)m->prio) return m;
+
+        dropped = queue[low][queue_head[low]];
+        queue_head[low] = (queue_head[low] + 1) % DRIVER_MSG_QUEUE_LEN;
+        queue_cnt[low]--;
+        queued--;
+    }
+
+    queue[m->prio][(queue_head[m->prio] + queue_cnt[m->prio]) % DRIVER_MSG_QUEUE_LEN] = m;
+    queue_cnt[m->prio]++;
+    queued++;
+
+    return dropped;
+}
+
+static int best_prio(void)
+{
+    int prio;
+
+    for(prio = 0; prio < DRIVER_MSG_PRIO_COUNT; prio++) {
+        if(queue_cnt[prio]) return prio;
+    }
+
+    return -1;
+}
+
+/**
+ * Tell whether a queued message may replace the one on screen
+ * @param prio priority of the queued message
+ */
+static bool is_due(int prio)
+{
+    if(shown == NULL || prio < (int)shown->prio) return true;
+    return lv_tick_elaps(shown_tick) >= min_show_ms;
+}
+
+static int open_socket(const char * path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "driver_msg: socket path too long: %s\n", path);
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* A socket left by a previous run */
+    unlink(path);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "driver_msg: could not bind %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static const char * socket_path(void)
+{
+    const char * env = getenv("DRIVER_MSG_SOCKET");
+    const char * dir;
+    size_t len;
+
+    if(env != NULL && env[0] != '\0') return env;
+
+    /* RuntimeDirectory= may list several directories separated by colons */
+    dir = getenv("RUNTIME_DIRECTORY");
+    if(dir == NULL || dir[0] == '\0') return DRIVER_MSG_SOCKET_DEFAULT;
+
+    len = strcspn(dir, ":");
+    snprintf(path_buf, sizeof(path_buf), "%.*s/driver-msg.sock", (int)len, dir);
+    return path_buf;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file driver_msg.h
+ *
+ * Pit to driver messages.
+ *
+ * Messages arrive as datagrams on a Unix socket, the stand-in for the radio
+ * link. A datagram is the UTF-8 text, optionally prefixed with a priority
+ * digit and a space, e.g. "0 BOX BOX". A worker thread breaks the text into
+ * lines with a metrics table of the message font, so the UI thread only
+ * rasterizes the lines it receives. Characters the font does not have are
+ * shown as '?'.
+ *
+ * Laid out messages wait in a priority queue, most urgent first, in arrival
+ * order within a priority. A message stays on screen at least
+ * DRIVER_MSG_MIN_SHOW_MS unless a more urgent one arrives.
+ *
+ * The worst loop iteration while a burst of messages drains is logged at
+ * the end of the burst, scripts/msg_burst.py sends such a burst.
+ *
+ * Environment:
+ * - DRIVER_MSG_SOCKET      socket path, default $RUNTIME_DIRECTORY/driver-msg.sock
+ *                          or DRIVER_MSG_SOCKET_DEFAULT
+ * - DRIVER_MSG_MIN_SHOW_MS overrides DRIVER_MSG_MIN_SHOW_MS, 0 shows every message at once
+ */
+
+#ifndef DRIVER_MSG_H
+#define DRIVER_MSG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+#include "scroll_text.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define DRIVER_MSG_SOCKET_DEFAULT "/run/oem-dashboard/driver-msg.sock"
+
+/* Longer texts are cut */
+#define DRIVER_MSG_MAX_LEN   480
+#define DRIVER_MSG_MAX_LINES 24
+
+#define DRIVER_MSG_QUEUE_LEN 8
+#define DRIVER_MSG_MIN_SHOW_MS 3000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    DRIVER_MSG_PRIO_URGENT,
+    DRIVER_MSG_PRIO_NORMAL, /* datagrams without a priority digit */
+    DRIVER_MSG_PRIO_INFO,
+    DRIVER_MSG_PRIO_COUNT
+} driver_msg_prio_t;
+
+typedef struct {
+    driver_msg_prio_t prio;
+    uint32_t seq;               /* arrival order */
+    uint32_t layout_us;         /* time the worker spent on it */
+    uint32_t line_cnt;
+    scroll_text_line_t lines[DRIVER_MSG_MAX_LINES];
+    char text[DRIVER_MSG_MAX_LEN + DRIVER_MSG_MAX_LINES]; /* the lines, each NUL terminated */
+} driver_msg_t;
+
+typedef struct {
+    uint32_t received;
+    uint32_t dropped;           /* pushed out of a full queue */
+    uint32_t shown;
+    uint32_t truncated;         /* longer than DRIVER_MSG_MAX_LEN or DRIVER_MSG_MAX_LINES */
+    uint32_t layout_max_us;
+    uint32_t layout_avg_us;
+    uint32_t burst_max_frame_us; /* worst loop iteration of the last burst */
+} driver_msg_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Open the socket and start the layout worker, UI thread only
+ * @param font the font the messages are drawn with
+ * @param width the width lines are broken at
+ * @return 0 on success, -1 if the socket or the worker could not be created
+ */
+int driver_msg_init(const lv_font_t * font, int32_t width);
+
+/**
+ * Get the fd that becomes readable when a message was laid out
+ * @return an eventfd, or -1 before driver_msg_init()
+ */
+int driver_msg_get_wake_fd(void);
+
+/**
+ * Take the next message to show, UI thread only
+ * @return the message, valid until the next call, or NULL if nothing is due
+ */
+const driver_msg_t * driver_msg_take(void);
+
+/**
+ * Get the time until a queued message is due
+ * @return milliseconds, LV_NO_TIMER_READY if the queue is empty
+ */
+uint32_t driver_msg_next_ms(void);
+
+/**
+ * Account the duration of a loop iteration to the current burst
+ * @param us the busy time of the iteration, without the wait
+ */
+void driver_msg_note_frame(uint32_t us);
+
+/**
+ * Get the counters
+ * @param stats filled with the counters
+ */
+void driver_msg_get_stats(driver_msg_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DRIVER_MSG_H*/
@@ -0,0 +1,158 @@
+/**
+ * @file error_view.c
+ *
+ * Error screen, updated straight from the fault path
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "error_view.h"
+#include "fault.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define INDICATOR_CNT 3
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static lv_obj_t * create_label(lv_obj_t * parent, const char * txt, lv_color_t color, const lv_font_t * font);
+static void apply(uint32_t faults, uint32_t changed);
+static lv_color_t fault_color(uint32_t faults, uint32_t group);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/* TS, AMS and IMD along the bottom */
+static const char * const indicator_texts[INDICATOR_CNT] = {"TS", "AMS", "IMD"};
+static const uint32_t indicator_groups[INDICATOR_CNT] = {FAULT_GROUP_TS, FAULT_GROUP_AMS, FAULT_GROUP_IMD};
+
+static lv_obj_t * title;
+static lv_obj_t * indicators[INDICATOR_CNT];
+static lv_obj_t * list;
+static lv_obj_t * lines[FAULT_COUNT];
+static int line_slot[FAULT_COUNT];
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void error_view_create(lv_obj_t * parent, const lv_font_t * title_font, const lv_font_t * line_font)
+{
+    int i;
+
+    title = create_label(parent, "CRITICAL ERROR", lv_color_hex(0xFF0000), title_font);
+    lv_obj_align(title, LV_ALIGN_CENTER, 0, -200);
+
+    for(i = 0; i < INDICATOR_CNT; i++) {
+        indicators[i] = create_label(parent, indicator_texts[i], fault_color(0, indicator_groups[i]), title_font);
+        lv_obj_align(indicators[i], LV_ALIGN_CENTER, (i - 1) * 250, 200);
+    }
+
+    list = lv_obj_create(parent);
+    lv_obj_add_flag(list, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(list, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_size(list, 800, 300);
+    lv_obj_set_style_radius(list, 0, LV_PART_MAIN);
+    lv_obj_set_style_border_width(list, 0, LV_PART_MAIN);
+    lv_obj_set_style_bg_color(list, lv_color_hex(0x000000), LV_PART_MAIN);
+    lv_obj_set_style_pad_all(list, 0, LV_PART_MAIN);
+    lv_obj_align(list, LV_ALIGN_CENTER, 0, 0);
+
+    /* One line per fault, shown and positioned by apply() */
+    for(i = 0; i < FAULT_COUNT; i++) {
+        lines[i] = create_label(list, fault_get_text((fault_id_t)i), lv_color_hex(0xffffff), line_font);
+        lv_obj_set_width(lines[i], 800);
+        lv_obj_set_style_text_align(lines[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+        lv_obj_align(lines[i], LV_ALIGN_TOP_MID, 0, 0);
+        line_slot[i] = 0;
+    }
+}
+
+void error_view_set_visible(bool visible)
+{
+    lv_obj_t * objs[] = {title, indicators[0], indicators[1], indicators[2], list};
+    size_t i;
+
+    if(title == NULL) return;
+
+    for(i = 0; i < sizeof(objs) / sizeof(objs[0]); i++) {
+        if(visible) lv_obj_remove_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
+        else lv_obj_add_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+bool error_view_poll(lv_display_t * disp, void (*takeover_cb)(void))
+{
+    uint32_t faults;
+    uint32_t changed;
+
+    if(title == NULL) return false;
+    if(!fault_take(&faults, &changed)) return false;
+
+    apply(faults, changed);
+
+    /* A newly set fault takes over the screen, clearing one only updates the list */
+    if((faults & changed) && takeover_cb) takeover_cb();
+
+    /* Draw now instead of waiting for the refresh timer */
+    lv_refr_now(disp);
+    fault_frame_done();
+    return true;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static lv_obj_t * create_label(lv_obj_t * parent, const char * txt, lv_color_t color, const lv_font_t * font)
+{
+    lv_obj_t * label = lv_label_create(parent);
+    lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+    lv_label_set_text_static(label, txt);
+    lv_obj_set_style_text_color(label, color, LV_PART_MAIN);
+    lv_obj_set_style_text_font(label, font, LV_PART_MAIN);
+    return label;
+}
+
+/**
+ * Restyle what a fault word change touches
+ * @param faults the current fault word
+ * @param changed the bits that changed
+ */
+static void apply(uint32_t faults, uint32_t changed)
+{
+    int slot = 0;
+    int i;
+
+    /* Indicators are only restyled when their group flipped */
+    for(i = 0; i < INDICATOR_CNT; i++) {
+        if(changed & indicator_groups[i]) {
+            lv_obj_set_style_text_color(indicators[i], fault_color(faults, indicator_groups[i]), LV_PART_MAIN);
+        }
+    }
+
+    /* Active faults are listed in id order, only lines that appear, disappear or move are touched */
+    for(i = 0; i < FAULT_COUNT; i++) {
+        if(!(faults & FAULT_BIT(i))) {
+            if(changed & FAULT_BIT(i)) lv_obj_add_flag(lines[i], LV_OBJ_FLAG_HIDDEN);
+            continue;
+        }
+        if(line_slot[i] != slot) {
+            lv_obj_set_y(lines[i], slot * ERROR_VIEW_LINE_HEIGHT);
+            line_slot[i] = slot;
+        }
+        if(changed & FAULT_BIT(i)) lv_obj_remove_flag(lines[i], LV_OBJ_FLAG_HIDDEN);
+        slot++;
+    }
+}
+
+static lv_color_t fault_color(uint32_t faults, uint32_t group)
+{
+    return (faults & group) ? lv_color_hex(0xFF0000) : lv_color_hex(0x222222);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file error_view.h
+ *
+ * The error screen and the path from a fault word change to it.
+ *
+ * error_view_poll() is called first on every loop iteration. It takes a
+ * change of the fault word from fault.h, restyles only the indicators and
+ * lines that changed, lets the caller switch to the error screen when a
+ * fault was newly set, and renders and flushes the frame before it
+ * returns, so a fault is on the panel without waiting for the refresh
+ * timer.
+ */
+
+#ifndef ERROR_VIEW_H
+#define ERROR_VIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Distance of two fault lines */
+#define ERROR_VIEW_LINE_HEIGHT 40
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Build the error screen, hidden
+ * @param parent the screen
+ * @param title_font font of the title and the TS/AMS/IMD indicators
+ * @param line_font font of the fault lines
+ */
+void error_view_create(lv_obj_t * parent, const lv_font_t * title_font, const lv_font_t * line_font);
+
+/**
+ * Show or hide the error screen, nothing before error_view_create()
+ * @param visible true to show it
+ */
+void error_view_set_visible(bool visible);
+
+/**
+ * Draw a change of the fault word right away, UI thread only. Before
+ * error_view_create() the change is left pending.
+ * @param disp the display to refresh
+ * @param takeover_cb called when a fault was newly set, to bring the error
+ *                    screen up, e.g. with error_view_set_visible()
+ * @return true if a change was drawn
+ */
+bool error_view_poll(lv_display_t * disp, void (*takeover_cb)(void));
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*ERROR_VIEW_H*/
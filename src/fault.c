@@ -0,0 +1,198 @@
+/**
+ * @file fault.c
+ *
+ * Fault word ingress, change ring and latency accounting
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "fault.h"
+#include "dash_clock.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void dump_signal_handler(int sig);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const char * const fault_texts[FAULT_COUNT] = {
+    [FAULT_OVER_VOLTAGE]  = "OVER VOLTAGE",
+    [FAULT_UNDER_VOLTAGE] = "UNDER VOLTAGE",
+    [FAULT_OVER_TEMP]     = "BATTERY TEMP",
+    [FAULT_AMS_COMM]      = "AMS COMM LOST",
+    [FAULT_ISOLATION]     = "ISOLATION FAULT",
+    [FAULT_BSPD_TIMEOUT]  = "BSPD TIMEOUT",
+    [FAULT_SHUTDOWN]      = "SHUTDOWN OPEN",
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static fault_event_t ring[FAULT_RING_SIZE];
+static uint32_t ring_head;
+static uint32_t ring_cnt;
+static uint32_t reported_word;
+static uint64_t reported_ns;
+
+/* UI thread side */
+static uint32_t shown_word;
+static uint64_t pending_ns;
+static fault_stats_t stats;
+
+static int wake_fd = -1;
+static volatile sig_atomic_t dump_requested;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int fault_init(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = dump_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    /* Stays installed for every dump, interrupted reads and polls carry on */
+    sa.sa_flags = SA_RESTART;
+    if(sigaction(SIGUSR1, &sa, NULL) != 0) return -1;
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return wake_fd < 0 ? -1 : 0;
+}
+
+int fault_get_wake_fd(void)
+{
+    return wake_fd;
+}
+
+void fault_report(uint32_t word)
+{
+    uint64_t one = 1;
+    uint64_t ts = dash_clock_mono_us() * 1000;
+    fault_event_t * ev;
+
+    pthread_mutex_lock(&lock);
+    if(word == reported_word) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    ev = &ring[ring_head];
+    ev->arrival_ns = ts;
+    ev->word = word;
+    ev->changed = word ^ reported_word;
+    ring_head = (ring_head + 1) % FAULT_RING_SIZE;
+    if(ring_cnt < FAULT_RING_SIZE) ring_cnt++;
+
+    reported_word = word;
+    reported_ns = ts;
+    pthread_mutex_unlock(&lock);
+
+    if(wake_fd >= 0 && write(wake_fd, &one, sizeof(one)) < 0) {
+        /* Counter saturated, the UI is awake anyway */
+    }
+}
+
+bool fault_take(uint32_t * word, uint32_t * changed)
+{
+    uint64_t cnt;
+    uint32_t w;
+    uint64_t ts;
+
+    if(dump_requested) {
+        dump_requested = 0;
+        fault_dump(stderr);
+    }
+
+    if(wake_fd >= 0 && read(wake_fd, &cnt, sizeof(cnt)) < 0) {
+        /* Nothing pending, EAGAIN */
+    }
+
+    pthread_mutex_lock(&lock);
+    w = reported_word;
+    ts = reported_ns;
+    pthread_mutex_unlock(&lock);
+
+    *word = w;
+    *changed = w ^ shown_word;
+    if(*changed == 0) return false;
+
+    shown_word = w;
+    pending_ns = ts;
+    stats.changes++;
+    return true;
+}
+
+void fault_frame_done(void)
+{
+    uint32_t latency;
+
+    if(pending_ns == 0) return;
+
+    latency = (uint32_t)(dash_clock_mono_us() - pending_ns / 1000);
+    pending_ns = 0;
+
+    stats.last_latency_us = latency;
+    if(latency > stats.max_latency_us) stats.max_latency_us = latency;
+}
+
+const char * fault_get_text(fault_id_t id)
+{
+    return id < FAULT_COUNT ? fault_texts[id] : "";
+}
+
+void fault_dump(FILE * f)
+{
+    fault_event_t copy[FAULT_RING_SIZE];
+    uint32_t cnt;
+    uint32_t head;
+    uint32_t i;
+
+    pthread_mutex_lock(&lock);
+    cnt = ring_cnt;
+    head = ring_head;
+    for(i = 0; i < FAULT_RING_SIZE; i++) copy[i] = ring[i];
+    pthread_mutex_unlock(&lock);
+
+    fprintf(f, "fault log: %u changes, last latency %uus, max latency %uus\n",
+            (unsigned)stats.changes, (unsigned)stats.last_latency_us, (unsigned)stats.max_latency_us);
+
+    for(i = 0; i < cnt; i++) {
+        const fault_event_t * ev = &copy[(head + FAULT_RING_SIZE - cnt + i) % FAULT_RING_SIZE];
+        int id;
+
+        fprintf(f, "%llu.%06llu word=0x%02x", (unsigned long long)(ev->arrival_ns / 1000000000ULL),
+                (unsigned long long)(ev->arrival_ns % 1000000000ULL / 1000), (unsigned)ev->word);
+        for(id = 0; id < FAULT_COUNT; id++) {
+            if(ev->changed & FAULT_BIT(id)) {
+                fprintf(f, " %c%s", (ev->word & FAULT_BIT(id)) ? '+' : '-', fault_texts[id]);
+            }
+        }
+        fprintf(f, "\n");
+    }
+}
+
+void fault_get_stats(fault_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void dump_signal_handler(int sig)
+{
+    (void)sig;
+    dump_requested = 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file fault.h
+ *
+ * Fast path for safety faults.
+ *
+ * Fault words do not go through the telemetry model and the update
+ * scheduler. The UI thread checks them first on every loop iteration and
+ * redraws the error screen immediately. Every change of the fault word is
+ * timestamped into a ring that is dumped to stderr on SIGUSR1.
+ */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define FAULT_BIT(id) (1u << (id))
+
+/* Faults lighting each indicator of the error screen */
+#define FAULT_GROUP_AMS  (FAULT_BIT(FAULT_OVER_VOLTAGE) | FAULT_BIT(FAULT_UNDER_VOLTAGE) | \
+                          FAULT_BIT(FAULT_OVER_TEMP) | FAULT_BIT(FAULT_AMS_COMM))
+#define FAULT_GROUP_IMD  FAULT_BIT(FAULT_ISOLATION)
+#define FAULT_GROUP_BSPD FAULT_BIT(FAULT_BSPD_TIMEOUT)
+#define FAULT_GROUP_TS   FAULT_BIT(FAULT_SHUTDOWN)
+
+/* Number of fault changes kept for the dump */
+#define FAULT_RING_SIZE 64
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    FAULT_OVER_VOLTAGE,
+    FAULT_UNDER_VOLTAGE,
+    FAULT_OVER_TEMP,
+    FAULT_AMS_COMM,
+    FAULT_ISOLATION,
+    FAULT_BSPD_TIMEOUT,
+    FAULT_SHUTDOWN,
+    FAULT_COUNT
+} fault_id_t;
+
+typedef struct {
+    uint64_t arrival_ns; /* CLOCK_MONOTONIC */
+    uint32_t word;       /* the complete fault word */
+    uint32_t changed;    /* bits that differ from the previous word */
+} fault_event_t;
+
+typedef struct {
+    uint32_t changes;        /* fault word changes received */
+    uint32_t last_latency_us; /* arrival to flushed frame of the last change */
+    uint32_t max_latency_us;
+} fault_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Initialize the fault path
+ * @return 0 on success, -1 if the dump signal or the wake-up fd could not be set up
+ */
+int fault_init(void);
+
+/**
+ * Get the fd that becomes readable when the fault word changed
+ * @return an eventfd, or -1 before fault_init()
+ */
+int fault_get_wake_fd(void);
+
+/**
+ * Report the current fault word, can be called from any thread
+ * @param word FAULT_BIT() of every active fault
+ */
+void fault_report(uint32_t word);
+
+/**
+ * Collect a fault word change, UI thread only
+ * @param word set to the current fault word
+ * @param changed set to the bits that changed since the previous call
+ * @return true if something changed and must be drawn now
+ */
+bool fault_take(uint32_t * word, uint32_t * changed);
+
+/**
+ * Tell that the frame showing the last collected change was flushed
+ */
+void fault_frame_done(void);
+
+/**
+ * Get the text shown on the error screen for a fault
+ * @param id the fault
+ * @return the text
+ */
+const char * fault_get_text(fault_id_t id);
+
+/**
+ * Print the fault ring, oldest change first
+ * @param f the output stream
+ */
+void fault_dump(FILE * f);
+
+/**
+ * Get the counters and latencies
+ * @param stats filled with the statistics
+ */
+void fault_get_stats(fault_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*FAULT_H*/
@@ -0,0 +1,199 @@
+/**
+ * @file frame_check.c
+ *
+ * Frame and render time capture of UI states
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "frame_check.h"
+#include "dash_clock.h"
+#include "simulator_util.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void state_timer_cb(lv_timer_t * timer);
+static uint32_t time_render(void);
+static int write_frame(const char * name);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const char * out_dir;
+static lv_display_t * display;
+static const frame_check_state_t * state_list;
+static uint32_t state_cnt;
+static uint32_t current;
+static FILE * render_file;
+static bool done;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int frame_check_start(lv_display_t * disp, const frame_check_state_t * states, uint32_t cnt)
+{
+    char path[PATH_MAX];
+
+    out_dir = getenv_default("DASH_FRAME_CHECK", "");
+    if(out_dir[0] == '\0') return 0;
+
+    if(mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "frame_check: cannot create %s: %s\n", out_dir, strerror(errno));
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/render.txt", out_dir);
+    render_file = fopen(path, "w");
+    if(render_file == NULL) {
+        fprintf(stderr, "frame_check: cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if(!dash_clock_is_virtual()) {
+        LV_LOG_WARN("frame_check: not on the virtual clock, frames may differ between runs");
+    }
+
+    display = disp;
+    state_list = states;
+    state_cnt = cnt;
+    current = 0;
+    done = cnt == 0;
+    if(done) return 0;
+
+    lv_timer_create(state_timer_cb, states[0].settle_ms, NULL);
+    states[0].enter(states[0].arg);
+    LV_LOG_USER("frame_check: %u states into %s", (unsigned)cnt, out_dir);
+    return 0;
+}
+
+bool frame_check_done(void)
+{
+    return done;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Capture the settled state and enter the next one
+ * @param timer the state timer
+ */
+static void state_timer_cb(lv_timer_t * timer)
+{
+    const frame_check_state_t * state = &state_list[current];
+    uint32_t render_us;
+
+    /* What the state changed is drawn before the frame is taken */
+    lv_refr_now(display);
+    if(write_frame(state->name) != 0) fprintf(stderr, "frame_check: frame of %s not written\n", state->name);
+
+    render_us = time_render();
+    fprintf(render_file, "%s %u\n", state->name, (unsigned)render_us);
+    LV_LOG_USER("frame_check: %s rendered in %uus", state->name, (unsigned)render_us);
+
+    if(++current == state_cnt) {
+        fclose(render_file);
+        render_file = NULL;
+        lv_timer_delete(timer);
+        done = true;
+        return;
+    }
+
+    lv_timer_set_period(timer, state_list[current].settle_ms);
+    state_list[current].enter(state_list[current].arg);
+}
+
+/**
+ * Render the whole screen repeatedly
+ * @return the fastest render in us
+ */
+static uint32_t time_render(void)
+{
+    uint32_t best = UINT32_MAX;
+    uint32_t start;
+    uint32_t elapsed;
+    uint32_t i;
+
+    for(i = 0; i < FRAME_CHECK_RENDER_RUNS; i++) {
+        lv_obj_invalidate(lv_screen_active());
+        start = (uint32_t)dash_clock_mono_us();
+        lv_refr_now(display);
+        elapsed = (uint32_t)dash_clock_mono_us() - start;
+        best = LV_MIN(best, elapsed);
+    }
+
+    return best;
+}
+
+/**
+ * Write the active draw buffer as a binary PPM
+ * @param name the file name without extension
+ * @return 0 on success, -1 on error
+ */
+static int write_frame(const char * name)
+{
+    lv_draw_buf_t * buf = lv_display_get_buf_active(display);
+    char path[PATH_MAX];
+    uint8_t * row;
+    const uint8_t * src;
+    uint16_t px;
+    uint32_t x;
+    uint32_t y;
+    FILE * f;
+
+    if(buf == NULL) return -1;
+
+    row = malloc(buf->header.w * 3u);
+    if(row == NULL) return -1;
+
+    snprintf(path, sizeof(path), "%s/%s.ppm", out_dir, name);
+    f = fopen(path, "wb");
+    if(f == NULL) {
+        fprintf(stderr, "frame_check: cannot create %s: %s\n", path, strerror(errno));
+        free(row);
+        return -1;
+    }
+
+    fprintf(f, "P6\n%u %u\n255\n", (unsigned)buf->header.w, (unsigned)buf->header.h);
+    for(y = 0; y < buf->header.h; y++) {
+        src = buf->data + y * buf->header.stride;
+        for(x = 0; x < buf->header.w; x++) {
+            switch(buf->header.cf) {
+                case LV_COLOR_FORMAT_RGB565:
+                    px = (uint16_t)(src[2 * x] | src[2 * x + 1] << 8);
+                    row[3 * x] = (uint8_t)((px >> 11) * 255 / 31);
+                    row[3 * x + 1] = (uint8_t)(((px >> 5) & 0x3F) * 255 / 63);
+                    row[3 * x + 2] = (uint8_t)((px & 0x1F) * 255 / 31);
+                    break;
+                case LV_COLOR_FORMAT_RGB888:
+                    /* Stored blue first */
+                    row[3 * x] = src[3 * x + 2];
+                    row[3 * x + 1] = src[3 * x + 1];
+                    row[3 * x + 2] = src[3 * x];
+                    break;
+                default:
+                    /* XRGB8888 and ARGB8888, blue first */
+                    row[3 * x] = src[4 * x + 2];
+                    row[3 * x + 1] = src[4 * x + 1];
+                    row[3 * x + 2] = src[4 * x];
+                    break;
+            }
+        }
+        fwrite(row, 3, buf->header.w, f);
+    }
+
+    free(row);
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file frame_check.h
+ *
+ * Captures the frames of defined UI states and their render times, for
+ * the golden frame check of scripts/golden_frames.py.
+ *
+ * With DASH_FRAME_CHECK set, once the UI is built, the states are entered
+ * one after the other. Each is given its settle time to let filters,
+ * timers and transitions finish, then:
+ * - the frame is brought up to date and written to <name>.ppm
+ * - the whole screen is rendered FRAME_CHECK_RENDER_RUNS times and the
+ *   fastest render, in wall time, is appended to render.txt
+ * After the last state frame_check_done() tells the loop to end.
+ *
+ * Only meaningful on the headless display and the virtual clock of
+ * dash_clock.h: the frames then depend on nothing but the states.
+ *
+ * Environment:
+ * - DASH_FRAME_CHECK  directory the frames are written to, no capture if unset
+ */
+
+#ifndef FRAME_CHECK_H
+#define FRAME_CHECK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Full screen renders timed per state, the fastest one counts */
+#define FRAME_CHECK_RENDER_RUNS 7
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char * name;          /* file name of the frame, no extension */
+    void (*enter)(uint32_t arg);
+    uint32_t arg;
+    uint32_t settle_ms;         /* dashboard time before the frame is taken */
+} frame_check_state_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Enter the first state if DASH_FRAME_CHECK is set, call once the UI is built
+ * @param disp the display to capture
+ * @param states the states, must stay valid
+ * @param cnt number of states
+ * @return 0 if the capture runs or is not enabled, -1 on error
+ */
+int frame_check_start(lv_display_t * disp, const frame_check_state_t * states, uint32_t cnt);
+
+/**
+ * Tell whether every state was captured
+ * @return true once the loop may end
+ */
+bool frame_check_done(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*FRAME_CHECK_H*/
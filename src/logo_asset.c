@@ -0,0 +1,92 @@
+/**
+ * @file logo_asset.c
+ *
+ * Logo decode and draw time accounting
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "logo_asset.h"
+#include "dash_clock.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define REPORT_PERIOD_MS 5000
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void draw_event_cb(lv_event_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static uint32_t draw_start_us;
+static uint32_t draw_cnt;
+static uint32_t draw_max_us;
+static uint32_t draw_total_us;
+static uint32_t last_report;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int logo_asset_prepare(void)
+{
+    lv_image_decoder_dsc_t dsc;
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    lv_result_t res;
+
+    /* The first touch of the compressed data pages it in, the decoded
+     * buffer then stays in the image cache for every later draw */
+    res = lv_image_decoder_open(&dsc, &oem_logo, NULL);
+    if(res != LV_RESULT_OK) {
+        LV_LOG_WARN("logo: decode failed");
+        return -1;
+    }
+    lv_image_decoder_close(&dsc);
+
+    LV_LOG_USER("logo: %ux%u cf=%u, %u bytes in the binary, decoded in %uus",
+                (unsigned)oem_logo.header.w, (unsigned)oem_logo.header.h, (unsigned)oem_logo.header.cf,
+                (unsigned)oem_logo.data_size, (unsigned)((uint32_t)dash_clock_mono_us() - start));
+    return 0;
+}
+
+void logo_asset_track_draw(lv_obj_t * img)
+{
+    lv_obj_add_event_cb(img, draw_event_cb, LV_EVENT_DRAW_MAIN_BEGIN, NULL);
+    lv_obj_add_event_cb(img, draw_event_cb, LV_EVENT_DRAW_MAIN_END, NULL);
+    last_report = lv_tick_get();
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void draw_event_cb(lv_event_t * e)
+{
+    uint32_t elapsed;
+
+    if(lv_event_get_code(e) == LV_EVENT_DRAW_MAIN_BEGIN) {
+        draw_start_us = (uint32_t)dash_clock_mono_us();
+        return;
+    }
+
+    /* Without draw threads the software renderer draws while the tasks are queued */
+    elapsed = (uint32_t)dash_clock_mono_us() - draw_start_us;
+    draw_cnt++;
+    draw_total_us += elapsed;
+    if(elapsed > draw_max_us) draw_max_us = elapsed;
+
+    if(draw_cnt == 1 || lv_tick_elaps(last_report) >= REPORT_PERIOD_MS) {
+        last_report = lv_tick_get();
+        LV_LOG_USER("logo: %u draws, avg %uus, max %uus", (unsigned)draw_cnt,
+                    (unsigned)(draw_total_us / draw_cnt), (unsigned)draw_max_us);
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file logo_asset.h
+ *
+ * The OEM logo in the display's native color format.
+ *
+ * scripts/gen_logo.py pre-blends src/oem_logo.c over black, converts it to
+ * RGB565 or XRGB8888 to match LV_COLOR_DEPTH and RLE compresses it. The
+ * result keeps the name oem_logo. logo_asset_prepare() decodes it once
+ * into the image cache, so drawing the logo is a plain opaque copy.
+ */
+
+#ifndef LOGO_ASSET_H
+#define LOGO_ASSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lvgl/lvgl.h"
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+LV_IMAGE_DECLARE(oem_logo);
+
+/**
+ * Decode the logo into the image cache and log its size and decode time
+ * @return 0 on success, -1 if the decoder failed (the logo is then decoded when drawn)
+ */
+int logo_asset_prepare(void);
+
+/**
+ * Log how long an image object takes to draw, on the first draw then every 5 s
+ * @param img the image showing the logo
+ */
+void logo_asset_track_draw(lv_obj_t * img);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LOGO_ASSET_H*/
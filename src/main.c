@@ -2,6 +2,7 @@
   #define _DEFAULT_SOURCE /* needed for usleep() */
 #endif
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -11,19 +12,49 @@
 #else
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/eventfd.h>
 #endif
 #include "lvgl/lvgl.h"
 #include <gpiod.h>
 
+#include "refresh_governor.h"
+#include "telemetry.h"
+#include "update_sched.h"
+#include "fault.h"
+#include "error_view.h"
+#include "dash_alloc.h"
+#include "boot_splash.h"
+#include "ui_stages.h"
+#include "slogan_rotation.h"
+#include "logo_asset.h"
+#include "mode_cards.h"
+#include "view_lifecycle.h"
+#include "scroll_text.h"
+#include "driver_msg.h"
+#include "telem_interp.h"
+#include "signal_cond.h"
+#include "rt_threads.h"
+#include "ui_watchdog.h"
+#include "replay.h"
+#include "session_log.h"
+#include "udp_telem.h"
+#include "vcu_uart.h"
+#include "telem_synth.h"
+#include "dash_clock.h"
+#include "frame_check.h"
+#include "dash_calc.h"
+#include "dash_fonts.h"
+
 #if LV_USE_OS != LV_OS_FREERTOS
 
 #define BATTERY_BAR_WIDTH 80
 #define BATTERY_BAR_HEIGHT 480
 #define BATTERY_SECTIONS 24
-#define MAX_SLOGANS 128
-#define MAX_LEN 128
-#define SLOGAN_FILE "src/slogans.txt"
-#define USED_FILE "src/slogan_flags.bin"
+#define FBDEV_FILE "/dev/fb0"
+
+// Size of the in-memory display with DASH_HEADLESS=1
+#define HEADLESS_HOR_RES 800
+#define HEADLESS_VER_RES 480
 
 // GPIO Pin definitions (BCM numbering)
 #define CLK_PIN 17
@@ -33,6 +64,7 @@
 // GPIO chip and lines
 static struct gpiod_chip *chip;
 static struct gpiod_line_request *line_request;
+static struct gpiod_edge_event_buffer *edge_events;
 static unsigned int clk_offset = CLK_PIN;
 static unsigned int dt_offset = DT_PIN;
 static unsigned int sw_offset = SW_PIN;
@@ -42,9 +74,25 @@ static int clk_last_state = 0;
 static double last_rotation_time = 0;
 static double last_mode_change_time = 0;
 static int sw_last_state = 1;
+static double sw_ignore_until = 0;
 static const double MIN_ROTATION_INTERVAL = 0.005;  // 5ms debounce
+static const double BUTTON_DEBOUNCE = 0.05;  // 50ms debounce
+static const double INPUT_HOLD = 0.1;  // keep sampling the levels this long after an edge
+static const int64_t INPUT_POLL_NS = 5000000;  // 5ms
 static const double MODE_CONFIRM_DELAY = 0.5;  // 500ms confirmation delay
 
+// Input decoded from the GPIO lines, by the input thread with DASH_THREADS=split
+typedef enum {
+    INPUT_ROTATE_CCW,
+    INPUT_ROTATE_CW,
+    INPUT_PRESS
+} input_event_t;
+#define INPUT_QUEUE_LEN 16
+static input_event_t input_queue[INPUT_QUEUE_LEN];
+static uint32_t input_head, input_cnt;
+static pthread_mutex_t input_lock = PTHREAD_MUTEX_INITIALIZER;
+static int input_wake_fd = -1;
+
 // Mode management
 static const char* modes[] = {"MENU", "RACE", "QUAL", "PITL"};
 static int current_mode_index = 0;
@@ -59,6 +107,9 @@ typedef enum {
 } screen_state_t;
 static screen_state_t current_screen = SCREEN_LOGO;
 
+// Timers and animations of each screen only run while it is shown
+static int screen_views[SCREEN_ERROR + 1];
+
 // Start up screen
 static lv_obj_t *logo, *mark, *slogan;
 
@@ -74,6 +125,8 @@ static lv_obj_t *lap_time, *last_time, *best_time;
 
 // Battery
 static lv_obj_t *battery_bar, *batt_border, *batt_text;
+static lv_obj_t *battery_segments[BATTERY_SECTIONS];
+static int battery_filled = -1;
 static lv_obj_t *batt_percent_border, *batt_percent;
 static lv_obj_t *batt_temp_border, *batt_temp;
 static lv_obj_t *batt_volt_border, *batt_volt;
@@ -86,7 +139,7 @@ static lv_obj_t *lv_border, *lv, *hv_border, *hv;
 static lv_obj_t *rtd_border, *rtd;
 
 // Settings
-static lv_obj_t *set_screen, *set_text;
+static lv_obj_t *set_screen;
 
 // Driver messages
 static lv_obj_t *msg_border, *msg;
@@ -95,27 +148,38 @@ static lv_obj_t *msg_border, *msg;
 static lv_obj_t *throttle_cont, *throttle, *throttle_text;
 static lv_obj_t *brake_cont, *brake, *brake_text;
 
-// Error and safety systems
-static lv_obj_t *error, *ts, *ams, *imd, *error_msg, *error_msg_border;
+// Lap timer of the dash
 static lv_timer_t *lap_timer;
 
 // Misc
 static uint32_t lap_start_ms;
-static char slogans[MAX_SLOGANS][MAX_LEN];
-static int slogan_count = 0;
-static unsigned char used[MAX_SLOGANS];
-static lv_timer_t *mode_confirm_timer = NULL;
+static lv_timer_t *mode_confirm_timer, *hide_set_screen_timer;
+static int lap_running = 0;
+
+// Rendering into memory, see create_headless_display()
+static bool headless;
+
+// Label texts are owned here and set with lv_label_set_text_static(),
+// so updating a value never reallocates the label's text
+static char speed_buf[8], throttle_buf[8], brake_buf[8];
+static char tire_bufs[4][8];
+static char batt_percent_buf[8], temp_buf[12], volt_buf[8];
+static char lap_time_buf[16];
 
+// Dashboard time, virtual with DASH_CLOCK=virtual, see dash_clock.h
 static double get_time_seconds(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+    return (double)dash_clock_now_us() / 1e6;
 }
 
 static uint32_t get_ms(void) {
+    return dash_clock_now_ms();
+}
+
+// Wall time, for how long the loop was busy
+static double get_wall_seconds(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
 }
 
 static void setup_gpio(void) {
@@ -149,6 +213,8 @@ static void setup_gpio(void) {
     
     gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
     gpiod_line_settings_set_bias(settings, GPIOD_LINE_BIAS_PULL_UP);
+    // Edge events wake up the main loop while the dash is idle
+    gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
     
     line_cfg = gpiod_line_config_new();
     if (!line_cfg) {
@@ -174,35 +240,51 @@ static void setup_gpio(void) {
         exit(1);
     }
     
+    edge_events = gpiod_edge_event_buffer_new(16);
+    if (!edge_events) {
+        fprintf(stderr, "Failed to create edge event buffer\n");
+        exit(1);
+    }
+    
     clk_last_state = gpiod_line_request_get_value(line_request, clk_offset);
     sw_last_state = gpiod_line_request_get_value(line_request, sw_offset);
 }
 
+static void drain_gpio_events(void) {
+    // The line levels are read directly, the events only serve as wakeups
+    while (gpiod_line_request_wait_edge_events(line_request, 0) > 0) {
+        if (gpiod_line_request_read_edge_events(line_request, edge_events, 16) <= 0) break;
+    }
+}
+
 static void update_mode_label(void) {
-    lv_label_set_text(mode, modes[pending_mode_index]);
+    lv_label_set_text_static(mode, modes[pending_mode_index]);
+}
+
+// One-shot timers are created once at boot, paused, and re-armed with this
+static void arm_timer(lv_timer_t *timer) {
+    lv_timer_reset(timer);
+    lv_timer_resume(timer);
 }
 
 static void hide_set_screen_cb(lv_timer_t *timer)
 {
-    lv_obj_add_flag(set_screen, LV_OBJ_FLAG_HIDDEN);
-    lv_timer_delete(timer);
+    mode_cards_hide();
+    lv_timer_pause(timer);
 }
 
 static void mode_confirm_timer_cb(lv_timer_t *timer) {
-    // Flash the screen with the confirmed mode
-    lv_obj_remove_flag(set_screen, LV_OBJ_FLAG_HIDDEN);
-    lv_label_set_text(set_text, modes[pending_mode_index]);
+    // Flash the pre-rendered card of the confirmed mode
+    mode_cards_show(pending_mode_index);
     
     // Confirm the mode change
     current_mode_index = pending_mode_index;
     mode_confirmed = 1;
     
     // Hide the flash screen after 1 second
-    lv_timer_create(hide_set_screen_cb, 1000, NULL);
+    arm_timer(hide_set_screen_timer);
     
-    // Delete this timer
-    mode_confirm_timer = NULL;
-    lv_timer_delete(timer);
+    lv_timer_pause(timer);
 }
 
 static void handle_mode_change(int direction) {
@@ -218,35 +300,87 @@ static void handle_mode_change(int direction) {
     mode_confirmed = 0;
     last_mode_change_time = get_time_seconds();
     
-    // Cancel existing timer if any
-    if (mode_confirm_timer != NULL) {
-        lv_timer_delete(mode_confirm_timer);
-        mode_confirm_timer = NULL;
+    // Restart the confirmation delay
+    arm_timer(mode_confirm_timer);
+}
+
+static void push_input(input_event_t ev) {
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&input_lock);
+    // A full queue means the UI is stuck, the oldest turns matter least
+    if (input_cnt == INPUT_QUEUE_LEN) {
+        input_head = (input_head + 1) % INPUT_QUEUE_LEN;
+        input_cnt--;
     }
-    
-    // Create new confirmation timer
-    mode_confirm_timer = lv_timer_create(mode_confirm_timer_cb, (uint32_t)(MODE_CONFIRM_DELAY * 1000), NULL);
+    input_queue[(input_head + input_cnt) % INPUT_QUEUE_LEN] = ev;
+    input_cnt++;
+    pthread_mutex_unlock(&input_lock);
+
+    if (input_wake_fd >= 0 && write(input_wake_fd, &one, sizeof(one)) < 0) {
+        // Counter saturated, the UI is awake anyway
+    }
+}
+
+static bool take_input(input_event_t *ev) {
+    bool found = false;
+
+    pthread_mutex_lock(&input_lock);
+    if (input_cnt > 0) {
+        *ev = input_queue[input_head];
+        input_head = (input_head + 1) % INPUT_QUEUE_LEN;
+        input_cnt--;
+        found = true;
+    }
+    pthread_mutex_unlock(&input_lock);
+
+    return found;
 }
 
-static void read_encoder(void) {
+// Decodes the encoder and the button from the line levels, on the thread reading the input
+static void sample_input(void) {
     double current_time = get_time_seconds();
     int clk_state = gpiod_line_request_get_value(line_request, clk_offset);
     
-    if (current_screen == SCREEN_DASH) {
-        if (clk_state == 0 && clk_last_state == 1) {
-            if ((current_time - last_rotation_time) > MIN_ROTATION_INTERVAL) {
-                int dt_state = gpiod_line_request_get_value(line_request, dt_offset);
-                if (dt_state == 0) {
-                    handle_mode_change(-1);
-                } else {
-                    handle_mode_change(1);
-                }
-                last_rotation_time = current_time;
-            }
+    if (clk_state == 0 && clk_last_state == 1) {
+        if ((current_time - last_rotation_time) > MIN_ROTATION_INTERVAL) {
+            int dt_state = gpiod_line_request_get_value(line_request, dt_offset);
+            push_input(dt_state == 0 ? INPUT_ROTATE_CCW : INPUT_ROTATE_CW);
+            last_rotation_time = current_time;
         }
     }
     
     clk_last_state = clk_state;
+
+    // The button bounces for a while after a press, its level is ignored meanwhile
+    if (current_time < sw_ignore_until) return;
+
+    int sw_state = gpiod_line_request_get_value(line_request, sw_offset);
+
+    if (sw_state == 0 && sw_last_state == 1) {
+        push_input(INPUT_PRESS);
+        sw_ignore_until = current_time + BUTTON_DEBOUNCE;
+    }
+
+    sw_last_state = sw_state;
+}
+
+static void *input_thread_main(void *arg) {
+    double last_edge = 0;
+    int64_t timeout_ns = -1;
+    (void)arg;
+
+    while (1) {
+        if (gpiod_line_request_wait_edge_events(line_request, timeout_ns) > 0) {
+            drain_gpio_events();
+            last_edge = get_time_seconds();
+        }
+        sample_input();
+        // Same as refresh_governor.c on the UI thread: sample through a detent, then block
+        timeout_ns = get_time_seconds() - last_edge < INPUT_HOLD ? INPUT_POLL_NS : -1;
+    }
+
+    return NULL;
 }
 
 static void hide_logo_screen(void) {
@@ -271,8 +405,9 @@ static void hide_dash_elements(void) {
         batt_volt_border, volt_border, throttle_cont,
         throttle_text, brake_cont, brake_text, msg_border
     };
+    // Widgets of build steps that did not run yet are NULL
     for(size_t i = 0; i < sizeof(objs)/sizeof(objs[0]); i++) {
-        lv_obj_add_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
+        if (objs[i] != NULL) lv_obj_add_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
     }
 }
 
@@ -287,41 +422,24 @@ static void show_dash_elements(void) {
         throttle_text, brake_cont, brake_text, msg_border
     };
     for(size_t i = 0; i < sizeof(objs)/sizeof(objs[0]); i++) {
-        lv_obj_remove_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
-    }
-}
-
-static void hide_error_elements(void) {
-    lv_obj_t * objs[] = {
-        error, ts, ams, imd, error_msg, error_msg_border
-    };
-    for(size_t i = 0; i < sizeof(objs)/sizeof(objs[0]); i++) {
-        lv_obj_add_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
-    }
-}
-
-static void show_error_elements(void) {
-    lv_obj_t * objs[] = {
-        error, ts, ams, imd, error_msg, error_msg_border
-    };
-    for(size_t i = 0; i < sizeof(objs)/sizeof(objs[0]); i++) {
-        lv_obj_remove_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
+        if (objs[i] != NULL) lv_obj_remove_flag(objs[i], LV_OBJ_FLAG_HIDDEN);
     }
 }
 
+// Paused while the dash is hidden, the lap clock is derived from lap_start_ms so no time is lost
 static void lap_timer_cb(lv_timer_t *timer) {
     lv_obj_t *label = lv_timer_get_user_data(timer);
     uint32_t elapsed = get_ms() - lap_start_ms;
-    char buf[16];
-    lv_snprintf(buf, sizeof(buf), "%02lu:%02lu.%03lu", elapsed/60000, (elapsed%60000)/1000, elapsed%1000);
-    lv_label_set_text(label, buf);
+    dash_calc_lap_time(lap_time_buf, sizeof(lap_time_buf), elapsed);
+    lv_label_set_text_static(label, lap_time_buf);
 }
 
 static void switch_to_screen(screen_state_t new_screen) {
     // Hide all screens first
     hide_logo_screen();
     hide_dash_elements();
-    hide_error_elements();
+    error_view_set_visible(false);
+    view_lifecycle_hide(screen_views[current_screen]);
     
     // Show the requested screen
     switch(new_screen) {
@@ -330,20 +448,25 @@ static void switch_to_screen(screen_state_t new_screen) {
             break;
         case SCREEN_DASH:
             show_dash_elements();
-            if (lap_timer == NULL) {
+            if (!lap_running) {
                 lap_start_ms = get_ms();
-                lap_timer = lv_timer_create(lap_timer_cb, 10, lap_time);
+                view_lifecycle_timer_run(lap_timer, true);
+                lap_running = 1;
             }
             break;
         case SCREEN_ERROR:
-            show_error_elements();
+            error_view_set_visible(true);
             break;
     }
     
+    view_lifecycle_show(screen_views[new_screen]);
     current_screen = new_screen;
 }
 
 static void handle_button_press(void) {
+    // Every screen must exist before switching
+    ui_stages_finish();
+
     // Cycle through screens: ERROR -> DASH -> LOGO -> ERROR
     switch(current_screen) {
         case SCREEN_ERROR:
@@ -358,71 +481,29 @@ static void handle_button_press(void) {
     }
 }
 
-static void read_button(void) {
-    int sw_state = gpiod_line_request_get_value(line_request, sw_offset);
-    
-    if (sw_state == 0 && sw_last_state == 1) {
-        handle_button_press();
-        usleep(50000);
-    }
-    
-    sw_last_state = sw_state;
-}
+static void poll_input(void) {
+    input_event_t ev;
+    uint64_t cnt;
 
-static void load_slogans() {
-    FILE *f = fopen(SLOGAN_FILE, "r");
-    if (!f) exit(1);
-    slogan_count = 0;
-    while(fgets(slogans[slogan_count], MAX_LEN, f)) {
-        slogans[slogan_count][strcspn(slogans[slogan_count], "\n")] = 0;
-        if (++slogan_count >= MAX_SLOGANS) break;
+    if (input_wake_fd >= 0 && read(input_wake_fd, &cnt, sizeof(cnt)) < 0) {
+        // Nothing pending, EAGAIN
     }
-    fclose(f);
-}
 
-static void load_used_flags() {
-    FILE *f = fopen(USED_FILE, "rb");
-    if (!f) { memset(used, 0, sizeof(used)); return; }
-    fread(used, 1, slogan_count, f);
-    fclose(f);
-}
-
-static void save_used_flags() {
-    FILE *f = fopen(USED_FILE, "wb");
-    fwrite(used, 1, slogan_count, f);
-    fclose(f);
-}
-
-static int pick_random_unused() {
-    int count = 0;
-    for(int i=0;i<slogan_count;i++) if(!used[i]) count++;
-    if(count==0) { memset(used,0,slogan_count); save_used_flags(); count=slogan_count; }
-    int target = rand()%count;
-    for(int i=0;i<slogan_count;i++) if(!used[i] && target--==0) return i;
-    return 0;
-}
-
-static void wrap_slogan(char *s) {
-    int len = strlen(s); if(len<=45) return;
-    int mid=len/2, best=-1, best_dist=9999;
-    for(int i=0;i<len;i++) if(s[i]==',' && abs(i-mid)<best_dist){best=i; break;}
-    if(best!=-1){memmove(&s[best+2],&s[best+1],strlen(&s[best+1])+1); s[best+1]='\n'; return;}
-    best_dist=9999; best=-1;
-    for(int i=0;i<len;i++) if(s[i]==' ' && abs(i-mid)<best_dist){best=i; best_dist=abs(i-mid);}
-    if(best!=-1) s[best]='\n';
-}
-
-static lv_color_t get_tire_color(int temp) {
-    if(temp<0) temp=0; 
-    if(temp>200) temp=200;
-    if(temp<=40) return lv_color_hex(0xC8C8C8);
-    if(temp<=70){float t=(temp-40)/30.0f; return lv_color_make((uint8_t)(200*(1-t)),(uint8_t)(200+55*t),(uint8_t)(200*(1-t)));}
-    if(temp<=90) return lv_color_hex(0x00FF00);
-    if(temp<=120){float t=(temp-90)/30.0f; return lv_color_make((uint8_t)(255*t),(uint8_t)(255*(1-t)),0);}
-    return lv_color_hex(0xFF0000);
+    while (take_input(&ev)) {
+        switch (ev) {
+            case INPUT_ROTATE_CCW:
+            case INPUT_ROTATE_CW:
+                // The mode is only changed from the dash
+                if (current_screen == SCREEN_DASH) handle_mode_change(ev == INPUT_ROTATE_CCW ? -1 : 1);
+                break;
+            case INPUT_PRESS:
+                handle_button_press();
+                break;
+        }
+    }
 }
 
-static void update_tire_color(lv_obj_t *border,int temp){lv_obj_set_style_bg_color(border,get_tire_color(temp),LV_PART_MAIN);}
+static void update_tire_color(lv_obj_t *border,int temp){lv_obj_set_style_bg_color(border,dash_calc_tire_color(temp),LV_PART_MAIN);}
 
 static void update_all_tire_colors(int fl,int fr,int rl,int rr){update_tire_color(fl_border,fl);update_tire_color(fr_border,fr);update_tire_color(rl_border,rl);update_tire_color(rr_border,rr);}
 
@@ -433,52 +514,20 @@ static void tire_color_timer(lv_timer_t *timer){
     lv_timer_delete(timer);
 }
 
-static lv_color_t get_battery_color(int index,int total){
-    float t=(float)index/(total-1); uint8_t r,g,b=0;
-    if(t<=0.25f){float lt=t/0.25f; r=255; g=(lt<0.5f)?(uint8_t)(lt/0.5f*120):(uint8_t)(120+(lt-0.5f)/0.5f*(200-120));}
-    else{float lt=(t-0.25f)/0.75f; r=(uint8_t)((1-lt)*255); g=(uint8_t)(200+lt*(255-200));}
-    return lv_color_make(r,g,b);
-}
-
-static void update_battery_bar(int percentage){
-    lv_obj_clean(battery_bar); if(percentage<0) percentage=0; if(percentage>100) percentage=100;
-    int h=BATTERY_BAR_HEIGHT/BATTERY_SECTIONS,filled=(percentage*BATTERY_SECTIONS+99)/100;
+static void create_battery_segments(void){
+    int h=BATTERY_BAR_HEIGHT/BATTERY_SECTIONS;
     for(int i=0;i<BATTERY_SECTIONS;i++){
         lv_obj_t *s=lv_obj_create(battery_bar);
         lv_obj_remove_flag(s,LV_OBJ_FLAG_SCROLLABLE); lv_obj_set_style_radius(s,0,LV_PART_MAIN);
         lv_obj_set_size(s,BATTERY_BAR_WIDTH,h); lv_obj_align(s,LV_ALIGN_BOTTOM_MID,0,-i*h+22);
-        lv_obj_set_style_bg_color(s,(i<filled)?get_battery_color(i,BATTERY_SECTIONS):lv_color_black(),LV_PART_MAIN);
+        lv_obj_set_style_bg_color(s,lv_color_black(),LV_PART_MAIN);
         lv_obj_set_style_border_width(s,1,LV_PART_MAIN);
+        battery_segments[i]=s;
     }
 }
 
-static void msg_enable_vertical_scroll(lv_obj_t * msg, lv_coord_t view_height)
-{
-    lv_coord_t text_h = lv_obj_get_height(msg);
-
-    if(text_h <= view_height) {
-        return;
-    }
-
-    lv_obj_align(msg, LV_ALIGN_TOP_MID, 0, 0);
-
-    lv_anim_t a;
-    lv_anim_init(&a);
-
-    lv_anim_set_var(&a, msg);
-
-    lv_anim_set_time(&a, text_h*15);             // scroll up
-    lv_anim_set_playback_time(&a, text_h*15);    // scroll down
-
-    lv_anim_set_playback_delay(&a, 1000);    // pause at BOTTOM
-    lv_anim_set_repeat_delay(&a, 1000);      // pause at TOP
-
-    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
-
-    lv_anim_set_values(&a, 0, -(text_h - view_height));
-
-    lv_anim_set_exec_cb(&a, (lv_anim_exec_xcb_t)lv_obj_set_y);
-    lv_anim_start(&a);
+static void update_battery_bar(int percentage){
+    dash_calc_battery_bar(battery_segments, BATTERY_SECTIONS, &battery_filled, percentage);
 }
 
 static lv_obj_t* create_label(lv_obj_t *parent,const char *txt,lv_color_t color,const lv_font_t *font,int hidden){
@@ -510,25 +559,164 @@ static void delete_logo(lv_timer_t *timer)
     lv_timer_delete(timer);
 }
 
+static lv_color_t get_status_color(float value) {
+    return value >= 0.5f ? lv_color_hex(0x00ff00) : lv_color_hex(0xff0000);
+}
+
+static void apply_speed(void) {
+    lv_snprintf(speed_buf, sizeof(speed_buf), "%d", (int)telem_interp_get(TELEM_SPEED));
+    lv_label_set_text_static(speed, speed_buf);
+}
+
+static void apply_pedals(void) {
+    int t = (int)telemetry_get(TELEM_THROTTLE).value;
+    int b = (int)telemetry_get(TELEM_BRAKE).value;
+    lv_bar_set_value(throttle, t, LV_ANIM_OFF);
+    lv_snprintf(throttle_buf, sizeof(throttle_buf), "%d", t);
+    lv_label_set_text_static(throttle_text, throttle_buf);
+    lv_bar_set_value(brake, b, LV_ANIM_OFF);
+    lv_snprintf(brake_buf, sizeof(brake_buf), "%d", b);
+    lv_label_set_text_static(brake_text, brake_buf);
+}
+
+// A newly set fault brings up the error screen, see error_view_poll()
+static void fault_takeover(void) {
+    // The error view is built first, the other steps keep going behind it
+    mode_cards_dismiss();
+    if (current_screen != SCREEN_ERROR) switch_to_screen(SCREEN_ERROR);
+}
+
+static void poll_driver_msg(void) {
+    const driver_msg_t *m = driver_msg_take();
+    if (m == NULL) return;
+
+    // Rasterized in the next refresh, the message stays valid until the next take
+    scroll_text_set_lines(msg, m->text, m->lines, m->line_cnt);
+}
+
+// Read encoder and button, or take what the input thread read
+static void read_input(void) {
+    if (line_request != NULL && !rt_threads_split_input()) {
+        drain_gpio_events();
+        sample_input();
+    }
+    poll_input();
+}
+
+// Faults go first and are drawn right away
+static void poll_faults(void) {
+    error_view_poll(lv_display_get_default(), fault_takeover);
+}
+
+// Stages of the UI loop before the timer handler, allocations are counted per stage
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    uint32_t site;
+} loop_stage_t;
+static loop_stage_t loop_stages[] = {
+    {"input", read_input, 0},
+    {"faults", poll_faults, 0},
+    {"vcu", vcu_uart_poll, 0},
+    {"replay", replay_step, 0},
+    {"sched", update_sched_run, 0},
+    {"driver_msg", poll_driver_msg, 0},
+};
+
+static void apply_tires(void) {
+    static int drawn[4] = {INT_MIN, INT_MIN, INT_MIN, INT_MIN};
+    lv_obj_t *labels[] = {fl_temp, fr_temp, rl_temp, rr_temp};
+    lv_obj_t *borders[] = {fl_border, fr_border, rl_border, rr_border};
+    for(int i = 0; i < 4; i++) {
+        int t = (int)signal_cond_get(TELEM_TIRE_FL + i);
+        // The group is applied when any tire changed, leave the others alone
+        if(t == drawn[i]) continue;
+        drawn[i] = t;
+        lv_snprintf(tire_bufs[i], sizeof(tire_bufs[i]), "%d", t);
+        lv_label_set_text_static(labels[i], tire_bufs[i]);
+        update_tire_color(borders[i], t);
+    }
+}
+
+static void apply_battery(void) {
+    float soc = telem_interp_get(TELEM_BATT_SOC);
+    update_battery_bar((int)soc);
+    lv_snprintf(batt_percent_buf, sizeof(batt_percent_buf), "%.1f%%", soc);
+    lv_label_set_text_static(batt_percent, batt_percent_buf);
+}
+
+static void apply_batt_temp(void) {
+    lv_snprintf(temp_buf, sizeof(temp_buf), "%d°F", (int)signal_cond_get(TELEM_BATT_TEMP));
+    lv_label_set_text_static(temp, temp_buf);
+}
+
+static void apply_pack_volt(void) {
+    lv_snprintf(volt_buf, sizeof(volt_buf), "%.1f", signal_cond_get(TELEM_PACK_VOLT));
+    lv_label_set_text_static(volt, volt_buf);
+}
+
+static void apply_status(void) {
+    // Level 1 is above the 0.5 threshold of signal_conds[]
+    lv_obj_set_style_bg_color(rtd_border, get_status_color(signal_cond_get_level(TELEM_RTD)), LV_PART_MAIN);
+    lv_obj_set_style_bg_color(hv_border, get_status_color(signal_cond_get_level(TELEM_HV_ON)), LV_PART_MAIN);
+    lv_obj_set_style_bg_color(lv_border, get_status_color(signal_cond_get_level(TELEM_LV_OK)), LV_PART_MAIN);
+}
+
+// What the speed and battery widgets draw of their value, see telem_interp.h
+static int32_t quantize_speed(float v) {
+    return (int32_t)v;
+}
+
+static int32_t quantize_soc(float v) {
+    // The label rounds to tenths, the bar changes less often
+    return (int32_t)(v * 10.0f + 0.5f);
+}
+
+// Driver critical widgets first, the scheduler defers the rest when a frame runs long
+static const update_widget_t dash_widgets[] = {
+    {"speed",     UPDATE_PRIO_HIGH,   REFRESH_CLASS_GAUGE,       TELEM_MASK(TELEM_SPEED), apply_speed},
+    {"pedals",    UPDATE_PRIO_HIGH,   REFRESH_CLASS_GAUGE,       TELEM_MASK(TELEM_THROTTLE) | TELEM_MASK(TELEM_BRAKE), apply_pedals},
+    {"status",    UPDATE_PRIO_NORMAL, REFRESH_CLASS_STATUS,      TELEM_MASK(TELEM_RTD) | TELEM_MASK(TELEM_HV_ON) | TELEM_MASK(TELEM_LV_OK), apply_status},
+    {"tires",     UPDATE_PRIO_NORMAL, REFRESH_CLASS_TEMPERATURE, TELEM_MASK(TELEM_TIRE_FL) | TELEM_MASK(TELEM_TIRE_FR) |
+                                                                 TELEM_MASK(TELEM_TIRE_RL) | TELEM_MASK(TELEM_TIRE_RR), apply_tires},
+    {"battery",   UPDATE_PRIO_NORMAL, REFRESH_CLASS_GAUGE,       TELEM_MASK(TELEM_BATT_SOC), apply_battery},
+    {"batt_temp", UPDATE_PRIO_LOW,    REFRESH_CLASS_TEMPERATURE, TELEM_MASK(TELEM_BATT_TEMP), apply_batt_temp},
+    {"pack_volt", UPDATE_PRIO_LOW,    REFRESH_CLASS_TEMPERATURE, TELEM_MASK(TELEM_PACK_VOLT), apply_pack_volt},
+};
+
+// Conditioning of the noisy channels, see signal_cond.h. The tire thresholds
+// are the color stops of dash_calc_tire_color(), the status ones the 0/1 switch.
+#define TIRE_COND(ch) {ch, true, 500.0f, 1.0f, 2.0f, 1000, 4, {40.0f, 70.0f, 90.0f, 120.0f}}
+#define STATUS_COND(ch) {ch, false, 0.0f, 0.0f, 0.2f, 100, 1, {0.5f}}
+static const signal_cond_cfg_t signal_conds[] = {
+    TIRE_COND(TELEM_TIRE_FL),
+    TIRE_COND(TELEM_TIRE_FR),
+    TIRE_COND(TELEM_TIRE_RL),
+    TIRE_COND(TELEM_TIRE_RR),
+    {TELEM_BATT_TEMP, true, 1000.0f, 0.6f, 0.0f, 0, 0, {0}},
+    {TELEM_PACK_VOLT, false, 300.0f, 0.2f, 0.0f, 0, 0, {0}},
+    STATUS_COND(TELEM_RTD),
+    STATUS_COND(TELEM_HV_ON),
+    STATUS_COND(TELEM_LV_OK),
+};
+
 static void change_speed(lv_timer_t *timer)
 {
-    lv_label_set_text(speed, "26");
-    update_battery_bar(76);
-    lv_label_set_text(batt_percent, "76.0%");
-    lv_obj_set_style_bg_color(rtd_border, lv_color_hex(0x00ff00), LV_PART_MAIN);
-    lv_obj_set_style_bg_color(hv_border, lv_color_hex(0x00ff00), LV_PART_MAIN);
-    lv_bar_set_value(throttle, 68, LV_ANIM_OFF);
-    lv_label_set_text(throttle_text, "68");
-    lv_bar_set_value(brake, 23, LV_ANIM_OFF);
-    lv_label_set_text(brake_text, "23");
+    telemetry_publish(TELEM_SPEED, 26);
+    telemetry_publish(TELEM_BATT_SOC, 76);
+    telemetry_publish(TELEM_RTD, 1);
+    telemetry_publish(TELEM_HV_ON, 1);
+    telemetry_publish(TELEM_LV_OK, 1);
+    telemetry_publish(TELEM_THROTTLE, 68);
+    telemetry_publish(TELEM_BRAKE, 23);
     lv_timer_delete(timer);
 }
 
 static void set_mode(lv_timer_t *timer)
 {
-    lv_obj_remove_flag(set_screen, LV_OBJ_FLAG_HIDDEN);
-    lv_label_set_text(mode, "QUAL");
-    lv_timer_create(hide_set_screen_cb, 1000, NULL);
+    mode_cards_show(2);
+    lv_label_set_text_static(mode, "QUAL");
+    arm_timer(hide_set_screen_timer);
     lv_timer_delete(timer);
 }
 
@@ -552,109 +740,98 @@ static void show_error(lv_timer_t *timer)
 
 static void hide_error(lv_timer_t *timer)
 {
-    hide_error_elements();
+    error_view_set_visible(false);
     lv_timer_delete(timer);
 }
 
-int main(int argc,char **argv){
-    /* Initialize LVGL */
-    lv_init();
-
-    /* Initialize GPIO */
-    setup_gpio();
-
-    /* Add framebuffer display setup */
-    lv_display_t *disp = lv_linux_fbdev_create();
-    lv_linux_fbdev_set_file(disp, "/dev/fb0");
-    
-    (void)argc;(void)argv; srand(time(NULL));
-
-    load_slogans(); load_used_flags();
-    int idx=pick_random_unused(); used[idx]=1; save_used_flags();
-    char wrapped[MAX_LEN]; strncpy(wrapped,slogans[idx],MAX_LEN-1); wrapped[MAX_LEN-1]=0; wrap_slogan(wrapped);
-    lv_obj_set_style_bg_color(lv_screen_active(),lv_color_black(),LV_PART_MAIN);
-
-    logo=lv_image_create(lv_screen_active()); LV_IMAGE_DECLARE(oem_logo); lv_image_set_src(logo,&oem_logo); lv_obj_align(logo,LV_ALIGN_CENTER,0,-40);
-    mark=create_label(lv_screen_active(),"Mk VIII",lv_color_hex(0xffffff),&lv_font_montserrat_32,0); lv_obj_align(mark,LV_ALIGN_CENTER,0,50);
-    slogan=create_label(lv_screen_active(),wrapped,lv_color_hex(0xffffff),&lv_font_montserrat_28,0); lv_obj_set_style_text_align(slogan,LV_TEXT_ALIGN_CENTER,LV_PART_MAIN); lv_obj_align(slogan,LV_ALIGN_CENTER,0,140);
+// Views built after the first frame, one ui_stages step each
+static void build_error_view(void) {
+    error_view_create(lv_screen_active(), &dash_font_roboto_48, &dash_font_roboto_32);
+}
 
-    speed=create_label(lv_screen_active(),"0",lv_color_hex(0xffffff),&lv_font_roboto_184,1); lv_obj_align(speed,LV_ALIGN_CENTER,0,-80);
+static void build_dash_top(void) {
+    speed=create_label(lv_screen_active(),"0",lv_color_hex(0xffffff),&dash_font_roboto_184,1); lv_obj_align(speed,LV_ALIGN_CENTER,0,-80);
 
     fl_border=create_border(lv_screen_active(),100,72,lv_color_hex(0x00FF00),lv_color_hex(0x000000)); lv_obj_add_flag(fl_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(fl_border,LV_ALIGN_TOP_LEFT,5,100);
     fr_border=create_border(lv_screen_active(),100,72,lv_color_hex(0x00FF00),lv_color_hex(0x000000)); lv_obj_add_flag(fr_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(fr_border,LV_ALIGN_TOP_LEFT,110,100);
     rl_border=create_border(lv_screen_active(),100,72,lv_color_hex(0x00FF00),lv_color_hex(0x000000)); lv_obj_add_flag(rl_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(rl_border,LV_ALIGN_TOP_LEFT,5,177);
     rr_border=create_border(lv_screen_active(),100,72,lv_color_hex(0x00FF00),lv_color_hex(0x000000)); lv_obj_add_flag(rr_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(rr_border,LV_ALIGN_TOP_LEFT,110,177);
 
-    fl_temp=create_label(fl_border,"80",lv_color_hex(0x000000),&lv_font_roboto_48,1); lv_obj_center(fl_temp);
-    fr_temp=create_label(fr_border,"80",lv_color_hex(0x000000),&lv_font_roboto_48,1); lv_obj_center(fr_temp);
-    rl_temp=create_label(rl_border,"80",lv_color_hex(0x000000),&lv_font_roboto_48,1); lv_obj_center(rl_temp);
-    rr_temp=create_label(rr_border,"80",lv_color_hex(0x000000),&lv_font_roboto_48,1); lv_obj_center(rr_temp);
+    fl_temp=create_label(fl_border,"80",lv_color_hex(0x000000),&dash_font_roboto_48,1); lv_obj_center(fl_temp);
+    fr_temp=create_label(fr_border,"80",lv_color_hex(0x000000),&dash_font_roboto_48,1); lv_obj_center(fr_temp);
+    rl_temp=create_label(rl_border,"80",lv_color_hex(0x000000),&dash_font_roboto_48,1); lv_obj_center(rl_temp);
+    rr_temp=create_label(rr_border,"80",lv_color_hex(0x000000),&dash_font_roboto_48,1); lv_obj_center(rr_temp);
 
     mode_text_border=create_border(lv_screen_active(),145,32,lv_color_hex(0x000000),lv_color_hex(0xffffff)); lv_obj_add_flag(mode_text_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(mode_text_border,LV_ALIGN_BOTTOM_MID,12,-5);
     lv_obj_set_style_border_width(mode_text_border,1,LV_PART_MAIN);
-    mode_text=create_label(mode_text_border,"DRIVEMODE",lv_color_hex(0xffffff),&lv_font_roboto_24,0); lv_obj_center(mode_text);
+    mode_text=create_label(mode_text_border,"DRIVEMODE",lv_color_hex(0xffffff),&dash_font_roboto_24,0); lv_obj_center(mode_text);
 
     mode_border=create_border(lv_screen_active(),70,32,lv_color_hex(0xffffff),lv_color_hex(0xffffff)); lv_obj_add_flag(mode_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(mode_border,LV_ALIGN_BOTTOM_MID,117,-5);
-    mode=create_label(mode_border,"MENU",lv_color_hex(0x000000),&lv_font_roboto_24,0); lv_obj_center(mode);
+    mode=create_label(mode_border,"MENU",lv_color_hex(0x000000),&dash_font_roboto_24,0); lv_obj_center(mode);
 
-    lap_time=create_label(lv_screen_active(),"00:00.000",lv_color_hex(0xffffff),&lv_font_roboto_64,1); lv_obj_align(lap_time,LV_ALIGN_TOP_LEFT,10,10);
-    last_time=create_label(lv_screen_active(),"-0.294",lv_color_hex(0x00ff00),&lv_font_roboto_64,1); lv_obj_align(last_time,LV_ALIGN_TOP_RIGHT,-90,10);
-    best_time=create_label(lv_screen_active(),"01:25.892",lv_color_hex(0x9D00FF),&lv_font_roboto_40,1); lv_obj_align(best_time,LV_ALIGN_CENTER,0,15);
+    lap_time=create_label(lv_screen_active(),"00:00.000",lv_color_hex(0xffffff),&dash_font_roboto_64,1); lv_obj_align(lap_time,LV_ALIGN_TOP_LEFT,10,10);
+    last_time=create_label(lv_screen_active(),"-0.294",lv_color_hex(0x00ff00),&dash_font_roboto_64,1); lv_obj_align(last_time,LV_ALIGN_TOP_RIGHT,-90,10);
+    best_time=create_label(lv_screen_active(),"01:25.892",lv_color_hex(0x9D00FF),&dash_font_roboto_40,1); lv_obj_align(best_time,LV_ALIGN_CENTER,0,15);
+}
 
+static void build_dash_battery(void) {
     battery_bar=create_border(lv_screen_active(),BATTERY_BAR_WIDTH,BATTERY_BAR_HEIGHT,lv_color_black(),lv_color_white()); lv_obj_add_flag(battery_bar,LV_OBJ_FLAG_HIDDEN); lv_obj_align(battery_bar,LV_ALIGN_BOTTOM_RIGHT,0,0);
     lv_obj_set_style_border_width(battery_bar,1,LV_PART_MAIN);
+    create_battery_segments();
 
     rtd_border=create_border(lv_screen_active(),208,32,lv_color_hex(0xff0000),lv_color_black()); lv_obj_add_flag(rtd_border,LV_OBJ_FLAG_HIDDEN); lv_obj_align(rtd_border,LV_ALIGN_BOTTOM_LEFT,5,-5);
-    rtd=create_label(rtd_border,"READY TO DRIVE",lv_color_hex(0x000000),&lv_font_roboto_24,0); lv_obj_center(rtd);
+    rtd=create_label(rtd_border,"READY TO DRIVE",lv_color_hex(0x000000),&dash_font_roboto_24,0); lv_obj_center(rtd);
 
     batt_border = create_border(lv_screen_active(), 70, 32, lv_color_hex(0x000000), lv_color_black());
     lv_obj_add_flag(batt_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(batt_border, LV_ALIGN_BOTTOM_RIGHT, -165, -5);
-    batt_text = create_label(batt_border, "BATT", lv_color_hex(0xffffff), &lv_font_roboto_24, 0);
+    batt_text = create_label(batt_border, "BATT", lv_color_hex(0xffffff), &dash_font_roboto_24, 0);
     lv_obj_center(batt_text);
 
     batt_percent_border = create_border(lv_screen_active(), 80, 32, lv_color_hex(0xffffff), lv_color_black());
     lv_obj_add_flag(batt_percent_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(batt_percent_border, LV_ALIGN_BOTTOM_RIGHT, -85, -5);
-    batt_percent = create_label(batt_percent_border, "FULL", lv_color_hex(0x000000), &lv_font_roboto_24, 0);
+    batt_percent = create_label(batt_percent_border, "FULL", lv_color_hex(0x000000), &dash_font_roboto_24, 0);
     lv_obj_center(batt_percent);
 
     lv_border = create_border(lv_screen_active(), 48, 32, lv_color_hex(0x00ff00), lv_color_black());
     lv_obj_add_flag(lv_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(lv_border, LV_ALIGN_BOTTOM_LEFT, 218, -5);
-    lv = create_label(lv_border, "LV", lv_color_hex(0x000000), &lv_font_roboto_24, 0);
+    lv = create_label(lv_border, "LV", lv_color_hex(0x000000), &dash_font_roboto_24, 0);
     lv_obj_center(lv);
 
     hv_border = create_border(lv_screen_active(), 48, 32, lv_color_hex(0xff0000), lv_color_black());
     lv_obj_add_flag(hv_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(hv_border, LV_ALIGN_BOTTOM_LEFT, 271, -5);
-    hv = create_label(hv_border, "HV", lv_color_hex(0x000000), &lv_font_roboto_24, 0);
+    hv = create_label(hv_border, "HV", lv_color_hex(0x000000), &dash_font_roboto_24, 0);
     lv_obj_center(hv);
 
     batt_temp_border = create_border(lv_screen_active(), 70, 32, lv_color_hex(0x000000), lv_color_black());
     lv_obj_add_flag(batt_temp_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(batt_temp_border, LV_ALIGN_BOTTOM_RIGHT, -165, -42);
-    batt_temp = create_label(batt_temp_border, "TEMP", lv_color_hex(0xffffff), &lv_font_roboto_24, 0);
+    batt_temp = create_label(batt_temp_border, "TEMP", lv_color_hex(0xffffff), &dash_font_roboto_24, 0);
     lv_obj_center(batt_temp);
 
     temp_border = create_border(lv_screen_active(), 80, 32, lv_color_hex(0xffffff), lv_color_black());
     lv_obj_add_flag(temp_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(temp_border, LV_ALIGN_BOTTOM_RIGHT, -85, -42);
-    temp = create_label(temp_border, "143°F", lv_color_hex(0x000000), &lv_font_roboto_24, 0);
+    temp = create_label(temp_border, "143°F", lv_color_hex(0x000000), &dash_font_roboto_24, 0);
     lv_obj_center(temp);
 
     batt_volt_border = create_border(lv_screen_active(), 70, 32, lv_color_hex(0x000000), lv_color_black());
     lv_obj_add_flag(batt_volt_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(batt_volt_border, LV_ALIGN_BOTTOM_RIGHT, -165, -79);
-    batt_volt = create_label(batt_volt_border, "VOLT", lv_color_hex(0xffffff), &lv_font_roboto_24, 0);
+    batt_volt = create_label(batt_volt_border, "VOLT", lv_color_hex(0xffffff), &dash_font_roboto_24, 0);
     lv_obj_center(batt_volt);
 
     volt_border = create_border(lv_screen_active(), 80, 32, lv_color_hex(0xffffff), lv_color_black());
     lv_obj_add_flag(volt_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_align(volt_border, LV_ALIGN_BOTTOM_RIGHT, -85, -79);
-    volt = create_label(volt_border, "432.7", lv_color_hex(0x000000), &lv_font_roboto_24, 0);
+    volt = create_label(volt_border, "432.7", lv_color_hex(0x000000), &dash_font_roboto_24, 0);
     lv_obj_center(volt);
+}
 
+static void build_dash_pedals(void) {
     throttle_cont = lv_obj_create(lv_screen_active());
     lv_obj_add_flag(throttle_cont, LV_OBJ_FLAG_HIDDEN);
     lv_obj_set_size(throttle_cont, 30, 160);
@@ -680,7 +857,7 @@ int main(int argc,char **argv){
     lv_obj_add_flag(throttle_text, LV_OBJ_FLAG_HIDDEN);
     lv_label_set_text(throttle_text, "0");
     lv_obj_set_style_text_color(throttle_text, lv_color_white(), LV_PART_MAIN);
-    lv_obj_set_style_text_font(throttle_text, &lv_font_roboto_24, LV_PART_MAIN);
+    lv_obj_set_style_text_font(throttle_text, &dash_font_roboto_24, LV_PART_MAIN);
     lv_obj_align(throttle_text, LV_ALIGN_CENTER, 235, -150);
 
     brake_cont = lv_obj_create(lv_screen_active());
@@ -708,7 +885,7 @@ int main(int argc,char **argv){
     lv_obj_add_flag(brake_text, LV_OBJ_FLAG_HIDDEN);
     lv_label_set_text(brake_text, "0");
     lv_obj_set_style_text_color(brake_text, lv_color_white(), LV_PART_MAIN);
-    lv_obj_set_style_text_font(brake_text, &lv_font_roboto_24, LV_PART_MAIN);
+    lv_obj_set_style_text_font(brake_text, &dash_font_roboto_24, LV_PART_MAIN);
     lv_obj_align(brake_text, LV_ALIGN_CENTER, 195, -150);
 
     lv_obj_set_style_bg_color(throttle_cont, lv_color_black(), LV_PART_MAIN);
@@ -723,64 +900,62 @@ int main(int argc,char **argv){
     lv_obj_set_style_bg_color(brake_cont, lv_color_black(), LV_PART_MAIN);
     lv_obj_set_style_bg_color(brake, lv_color_black(), LV_PART_MAIN);
     lv_obj_set_style_bg_color(brake, lv_color_hex(0xFF0000), LV_PART_INDICATOR);
+}
 
+static void build_dash_overlays(void) {
     msg_border = create_border(lv_screen_active(), 547, 156, lv_color_hex(0x000000), lv_color_hex(0xffffff));
     lv_obj_set_style_border_width(msg_border, 1, LV_PART_MAIN);
     lv_obj_add_flag(msg_border, LV_OBJ_FLAG_HIDDEN);
     lv_obj_set_style_pad_all(msg_border, 0, LV_PART_MAIN);
     lv_obj_align(msg_border, LV_ALIGN_BOTTOM_LEFT, 5, -42);
 
-    msg = lv_label_create(msg_border);
-    lv_obj_set_width(msg, 547);
-    lv_label_set_long_mode(msg, LV_LABEL_LONG_WRAP);
-    lv_label_set_text(msg, "HEY KEFAN!");
-    lv_obj_set_style_text_color(msg, lv_color_hex(0xffffff), LV_PART_MAIN);
-    lv_obj_set_style_text_font(msg, &lv_font_roboto_48, LV_PART_MAIN);
-    lv_obj_set_style_text_align(msg, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-    lv_obj_align(msg, LV_ALIGN_CENTER, 0, 0);
-    lv_obj_update_layout(msg);
-    msg_enable_vertical_scroll(msg, 156);
-
-    set_screen = create_border(lv_screen_active(), 800, 480, lv_color_hex(0xffffff), lv_color_black());
-    lv_obj_add_flag(set_screen, LV_OBJ_FLAG_HIDDEN);
-    lv_obj_align(set_screen, LV_ALIGN_CENTER, 0, 0);
+    // Rasterized once per message, scrolling only moves the shown window
+    msg = scroll_text_create(msg_border, screen_views[SCREEN_DASH], &dash_font_roboto_48, DRIVER_MSG_MAX_LINES, lv_color_hex(0xffffff), lv_color_hex(0x000000));
+    lv_obj_set_size(msg, LV_PCT(100), LV_PCT(100));
+    scroll_text_set_text(msg, "HEY KEFAN!");
+
+    // Messages from the pit are laid out off the UI thread to the box's width
+    if (driver_msg_init(&dash_font_roboto_48, lv_obj_get_content_width(msg)) == 0) {
+        refresh_governor_add_wake_fd(driver_msg_get_wake_fd());
+    } else {
+        fprintf(stderr, "Driver messages unavailable\n");
+    }
 
-    set_text = create_label(set_screen, "QUAL", lv_color_hex(0x000000), &lv_font_roboto_184, 0);
-    lv_obj_center(set_text);
+    // Shows the mode cards, rendered by the build_mode_card steps
+    set_screen = lv_image_create(lv_screen_active());
+    lv_obj_set_size(set_screen, 800, 480);
+    lv_obj_align(set_screen, LV_ALIGN_CENTER, 0, 0);
+    // The panel does not hold the headless frames
+    mode_cards_init(set_screen, headless ? NULL : FBDEV_FILE);
 
     int battery_level = 100; // example
     update_battery_bar(battery_level);
+}
 
-    // Error Screen
-    error = create_label(lv_screen_active(), "CRITICAL ERROR", lv_color_hex(0xFF0000), &lv_font_roboto_48, 1);
-    lv_obj_align(error, LV_ALIGN_CENTER, 0, -200);
-
-    ts = create_label(lv_screen_active(), "TS", lv_color_hex(0x222222), &lv_font_roboto_48, 1);
-    lv_obj_align(ts, LV_ALIGN_CENTER, -250, 200);
-
-    ams = create_label(lv_screen_active(), "AMS", lv_color_hex(0xFF0000), &lv_font_roboto_48, 1);
-    lv_obj_align(ams, LV_ALIGN_CENTER, 0, 200);
-
-    imd = create_label(lv_screen_active(), "IMD", lv_color_hex(0x222222), &lv_font_roboto_48, 1);
-    lv_obj_align(imd, LV_ALIGN_CENTER, 250, 200);
-
-    error_msg_border = create_border(lv_screen_active(), 800, 300, lv_color_hex(0x000000), lv_color_hex(0xffffff));
-    lv_obj_add_flag(error_msg_border, LV_OBJ_FLAG_HIDDEN);
-    lv_obj_set_style_pad_all(error_msg_border, 0, LV_PART_MAIN);
-    lv_obj_align(error_msg_border, LV_ALIGN_CENTER, 0, 0);
-
-    error_msg = lv_label_create(error_msg_border);
-    lv_obj_add_flag(error_msg, LV_OBJ_FLAG_HIDDEN);
-    lv_obj_set_width(error_msg, 800);
-    lv_label_set_long_mode(error_msg, LV_LABEL_LONG_WRAP);
-    lv_label_set_text(error_msg, "OVER VOLTAGE\nBATTERY TEMP\nBSPD TIMEOUT");
-    lv_obj_set_style_text_line_space(error_msg, 5, LV_PART_MAIN);
-    lv_obj_set_style_text_color(error_msg, lv_color_hex(0xffffff), LV_PART_MAIN);
-    lv_obj_set_style_text_font(error_msg, &lv_font_roboto_32, LV_PART_MAIN);
-    lv_obj_set_style_text_align(error_msg, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-    lv_obj_align(error_msg, LV_ALIGN_CENTER, 0, 0);
-    lv_obj_update_layout(error_msg);
-    msg_enable_vertical_scroll(error_msg, 300);
+static void build_mode_card(void) {
+    static uint32_t next_card;
+    mode_cards_render(next_card, modes[next_card], &dash_font_roboto_184);
+    if (++next_card == sizeof(modes)/sizeof(modes[0])) mode_cards_render_done();
+}
+
+static void build_finish(void) {
+    for(size_t i = 0; i < sizeof(dash_widgets)/sizeof(dash_widgets[0]); i++) {
+        update_sched_register(&dash_widgets[i]);
+    }
+    telem_interp_add(TELEM_SPEED, quantize_speed, screen_views[SCREEN_DASH]);
+    telem_interp_add(TELEM_BATT_SOC, quantize_soc, screen_views[SCREEN_DASH]);
+    if(signal_cond_init(signal_conds, sizeof(signal_conds)/sizeof(signal_conds[0])) != 0) {
+        fprintf(stderr, "Signal conditioning disabled\n");
+        signal_cond_init(NULL, 0);
+    }
+
+    // Every timer of the steady state exists from boot, they are paused and re-armed
+    lap_timer = lv_timer_create(lap_timer_cb, refresh_governor_class_period(REFRESH_CLASS_LAP_TIMER), lap_time);
+    view_lifecycle_attach_timer(screen_views[SCREEN_DASH], lap_timer, lap_running);
+    mode_confirm_timer = lv_timer_create(mode_confirm_timer_cb, (uint32_t)(MODE_CONFIRM_DELAY * 1000), NULL);
+    lv_timer_pause(mode_confirm_timer);
+    hide_set_screen_timer = lv_timer_create(hide_set_screen_cb, 1000, NULL);
+    lv_timer_pause(hide_set_screen_timer);
 
     lv_timer_create(tire_color_timer, 1000, NULL);
     /*lv_timer_create(delete_logo, 2000, NULL);
@@ -791,26 +966,269 @@ int main(int argc,char **argv){
     lv_timer_create(show_error, 10001, NULL);
     lv_timer_create(hide_error, 20000, NULL);
     lv_timer_create(show_dash, 20001, NULL);*/
+}
+
+// The error view goes first, a fault during warm-up needs it soonest
+static const ui_stage_t build_steps[] = {
+    {"error", build_error_view},
+    {"dash_top", build_dash_top},
+    {"dash_battery", build_dash_battery},
+    {"dash_pedals", build_dash_pedals},
+    {"dash_overlays", build_dash_overlays},
+    {"card_menu", build_mode_card},
+    {"card_race", build_mode_card},
+    {"card_qual", build_mode_card},
+    {"card_pitl", build_mode_card},
+    {"finish", build_finish},
+};
+
+// States of the golden frame check, see frame_check.h and scripts/golden_frames.py
+static void check_logo(uint32_t arg) {
+    LV_UNUSED(arg);
+    switch_to_screen(SCREEN_LOGO);
+}
+
+static void check_dash(uint32_t arg) {
+    LV_UNUSED(arg);
+    switch_to_screen(SCREEN_DASH);
+    // One tire at each color stop of dash_calc_tire_color()
+    telemetry_publish(TELEM_SPEED, 87);
+    telemetry_publish(TELEM_THROTTLE, 68);
+    telemetry_publish(TELEM_BRAKE, 12);
+    telemetry_publish(TELEM_TIRE_FL, 35);
+    telemetry_publish(TELEM_TIRE_FR, 60);
+    telemetry_publish(TELEM_TIRE_RL, 80);
+    telemetry_publish(TELEM_TIRE_RR, 130);
+    telemetry_publish(TELEM_BATT_SOC, 76);
+    telemetry_publish(TELEM_BATT_TEMP, 104);
+    telemetry_publish(TELEM_PACK_VOLT, 388);
+    telemetry_publish(TELEM_LV_OK, 1);
+    telemetry_publish(TELEM_HV_ON, 1);
+    telemetry_publish(TELEM_RTD, 1);
+}
+
+static void check_mode(uint32_t arg) {
+    // As if the encoder stopped on the mode and its delay ran out
+    pending_mode_index = (int)arg;
+    update_mode_label();
+    mode_confirm_timer_cb(mode_confirm_timer);
+}
+
+static void check_error(uint32_t arg) {
+    LV_UNUSED(arg);
+    fault_report(FAULT_BIT(FAULT_OVER_TEMP) | FAULT_BIT(FAULT_ISOLATION));
+}
+
+// The dash settles for the slowest filter of signal_conds[], a card is taken before it hides
+static const frame_check_state_t check_states[] = {
+    {"logo", check_logo, 0, 500},
+    {"dash", check_dash, 0, 6000},
+    {"mode_menu", check_mode, 0, 500},
+    {"mode_race", check_mode, 1, 500},
+    {"mode_qual", check_mode, 2, 500},
+    {"mode_pitl", check_mode, 3, 500},
+    {"error", check_error, 0, 500},
+};
+
+static void ui_built(void) {
+    boot_splash_mark(BOOT_MARK_UI_BUILT);
+
+    /* Captures the check states from here on, when DASH_FRAME_CHECK is set */
+    if (headless && frame_check_start(lv_display_get_default(), check_states,
+                                      sizeof(check_states)/sizeof(check_states[0])) != 0) {
+        exit(1);
+    }
+
+    /* From here on the dashboard must not allocate, see dash_alloc.h */
+    dash_alloc_seal();
+    dash_alloc_report(stdout);
+
+    /* Flush a frame now so the dash ready time is not left to the next invalidation */
+    lv_refr_now(NULL);
+
+    slogan_rotation_commit();
+}
+
+static void headless_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+    lv_display_flush_ready(disp);
+}
+
+// Renders into memory only, no panel and no GPIO, e.g. to replay sessions faster than real time
+static lv_display_t *create_headless_display(void) {
+    lv_display_t *disp = lv_display_create(HEADLESS_HOR_RES, HEADLESS_VER_RES);
+    lv_draw_buf_t *buf = lv_draw_buf_create(HEADLESS_HOR_RES, HEADLESS_VER_RES,
+                                            lv_display_get_color_format(disp), LV_STRIDE_AUTO);
+    LV_ASSERT_MALLOC(buf);
+    lv_display_set_draw_buffers(disp, buf, NULL);
+    lv_display_set_render_mode(disp, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, headless_flush_cb);
+    return disp;
+}
+
+int main(int argc,char **argv){
+    const char *headless_env = getenv("DASH_HEADLESS");
+    headless = headless_env != NULL && atoi(headless_env) != 0;
+
+    /* Put the logo on screen before anything else, LVGL takes over seamlessly */
+    if (!headless && boot_splash_show(FBDEV_FILE) != 0) {
+        fprintf(stderr, "Boot splash unavailable, waiting for the first LVGL frame\n");
+    }
+
+    /* Initialize LVGL, its heap is the counting arena of dash_alloc.c */
+    lv_init();
+    /* LVGL's tick and the dashboard's timing follow the same clock */
+    dash_clock_init();
+    uint32_t boot_site = dash_alloc_enter(dash_alloc_site("boot"));
+
+    /* Pin this thread, lock the memory the heap is in, see rt_threads.h */
+    rt_threads_init();
+
+    lv_display_t *disp;
+    if (headless) {
+        disp = create_headless_display();
+    } else {
+        /* Initialize GPIO */
+        setup_gpio();
+
+        /* Add framebuffer display setup */
+        disp = lv_linux_fbdev_create();
+        lv_linux_fbdev_set_file(disp, FBDEV_FILE);
+    }
+    boot_splash_handover(disp);
+    refresh_governor_init(disp);
+    dash_alloc_track_display(disp);
+    if (headless) {
+        /* No encoder and no button */
+    } else if (rt_threads_split_input()) {
+        /* The input thread owns the lines from here and queues what it decoded */
+        input_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (input_wake_fd < 0 || rt_threads_create(RT_THREAD_INPUT, "dash-input", input_thread_main, NULL) != 0) {
+            fprintf(stderr, "Failed to start the input thread\n");
+            exit(1);
+        }
+        refresh_governor_add_input_fd(input_wake_fd);
+    } else {
+        refresh_governor_add_input_fd(gpiod_line_request_get_fd(line_request));
+    }
+
+    /* Telemetry samples wake up the loop and go through the update scheduler */
+    if (telemetry_init() != 0) {
+        fprintf(stderr, "Failed to initialize telemetry\n");
+        exit(1);
+    }
+    refresh_governor_add_wake_fd(telemetry_get_wake_fd());
+    update_sched_init(disp);
+
+    /* Every sample published from here on is logged, see session_log.h */
+    if (session_log_init() != 0) {
+        fprintf(stderr, "Session logging unavailable\n");
+    }
+
+    /* Faults bypass the scheduler and have their own wakeup */
+    if (fault_init() != 0) {
+        fprintf(stderr, "Failed to initialize fault path\n");
+        exit(1);
+    }
+    refresh_governor_add_wake_fd(fault_get_wake_fd());
+
+    /* Simulator and test rig send telemetry over UDP, see udp_telem.h */
+    if (udp_telem_init() != 0) {
+        fprintf(stderr, "Failed to start the UDP telemetry receiver\n");
+        exit(1);
+    }
+
+    /* VCU link over a UART, read by the loop when its tty wakes it, see vcu_uart.h */
+    if (vcu_uart_init() != 0) {
+        fprintf(stderr, "Failed to open the VCU UART\n");
+        exit(1);
+    }
+    if (vcu_uart_get_fd() >= 0) refresh_governor_add_wake_fd(vcu_uart_get_fd());
+
+    /* Simulated laps for load and soak tests without a car, see telem_synth.h */
+    if (telem_synth_init() != 0) {
+        fprintf(stderr, "Failed to start the telemetry generator\n");
+        exit(1);
+    }
+
+    /* A recorded session replaces the live telemetry, see replay.h */
+    if (replay_init() != 0) {
+        fprintf(stderr, "Failed to start the replay\n");
+        exit(1);
+    }
+    
+    /* A virtual clock run draws the same frames every time */
+    (void)argc;(void)argv; srand(dash_clock_is_virtual() ? 1 : time(NULL));
+
+    // Slogans are pre-wrapped at build time, the rotation state is saved once the dash is up
+    const char *wrapped=slogan_table[slogan_rotation_pick()];
+    lv_obj_set_style_bg_color(lv_screen_active(),lv_color_black(),LV_PART_MAIN);
+
+    screen_views[SCREEN_LOGO] = view_lifecycle_add("logo");
+    screen_views[SCREEN_DASH] = view_lifecycle_add("dash");
+    screen_views[SCREEN_ERROR] = view_lifecycle_add("error");
+    view_lifecycle_show(screen_views[SCREEN_LOGO]);
+
+    logo_asset_prepare();
+    logo=lv_image_create(lv_screen_active()); lv_image_set_src(logo,&oem_logo); lv_obj_align(logo,LV_ALIGN_CENTER,0,BOOT_SPLASH_LOGO_OFS_Y);
+    logo_asset_track_draw(logo);
+    mark=create_label(lv_screen_active(),"Mk VIII",lv_color_hex(0xffffff),&lv_font_montserrat_32,0); lv_obj_align(mark,LV_ALIGN_CENTER,0,50);
+    slogan=create_label(lv_screen_active(),wrapped,lv_color_hex(0xffffff),&lv_font_montserrat_28,0); lv_obj_set_style_text_align(slogan,LV_TEXT_ALIGN_CENTER,LV_PART_MAIN); lv_obj_align(slogan,LV_ALIGN_CENTER,0,140);
+
+    /* Only the logo view is built before the first frame, the rest follows in steps */
+    ui_stages_start(disp, build_steps, sizeof(build_steps)/sizeof(build_steps[0]), ui_built);
+    dash_alloc_leave(boot_site);
+
+    for (size_t i = 0; i < sizeof(loop_stages)/sizeof(loop_stages[0]); i++) {
+        loop_stages[i].site = dash_alloc_site(loop_stages[i].name);
+    }
+    uint32_t timer_site = dash_alloc_site("lv_timer");
+
+    /* A stalled loop stops petting the hardware watchdog */
+    if (ui_watchdog_init() != 0) {
+        fprintf(stderr, "Failed to start the UI watchdog\n");
+    }
 
     while(1)
     {
-        /* Read encoder and button */
-        read_encoder();
-        read_button();
+        double loop_start = get_wall_seconds();
+        ui_watchdog_frame_start();
+        /* Input, faults, then the telemetry that arrived since the last frame */
+        for (size_t i = 0; i < sizeof(loop_stages)/sizeof(loop_stages[0]); i++) {
+            uint32_t prev_site = dash_alloc_enter(loop_stages[i].site);
+            loop_stages[i].run();
+            dash_alloc_leave(prev_site);
+        }
         /* Periodically call the lv_task handler.
         * It could be done in a timer interrupt or an OS task too.*/
+        uint32_t prev_site = dash_alloc_enter(timer_site);
+        uint32_t handler_start_ms = lv_tick_get();
         uint32_t sleep_time_ms = lv_timer_handler();
-        if(sleep_time_ms == LV_NO_TIMER_READY)
-        {
-            sleep_time_ms =  LV_DEF_REFR_PERIOD;
+        boot_splash_note_frame(lv_tick_elaps(handler_start_ms));
+        /* Nothing of a hidden screen may have run */
+        view_lifecycle_audit();
+        dash_alloc_leave(prev_site);
+        driver_msg_note_frame((uint32_t)((get_wall_seconds() - loop_start) * 1e6));
+        /* Sleeps until the next timer, a frame, an input edge, a queued message,
+         * a rate limited widget update or the next interpolation or conditioning step */
+        sleep_time_ms = LV_MIN(sleep_time_ms, update_sched_next_ms());
+        sleep_time_ms = LV_MIN(sleep_time_ms, driver_msg_next_ms());
+        sleep_time_ms = LV_MIN(sleep_time_ms, signal_cond_next_ms());
+        sleep_time_ms = LV_MIN(sleep_time_ms, replay_next_ms());
+        ui_watchdog_frame_end();
+        refresh_governor_wait(LV_MIN(sleep_time_ms, telem_interp_next_ms()));
+        if (dash_clock_end_reached()) {
+            LV_LOG_USER("clock: end of the virtual run");
+            exit(0);
+        }
+        if (frame_check_done()) {
+            LV_LOG_USER("frame_check: done");
+            exit(0);
         }
-    #ifdef _MSC_VER
-        Sleep(sleep_time_ms);
-    #else
-        usleep(sleep_time_ms * 1000);
-    #endif
     }
 
+    gpiod_edge_event_buffer_free(edge_events);
     gpiod_line_request_release(line_request);
     gpiod_chip_close(chip);
     
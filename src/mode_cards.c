@@ -0,0 +1,246 @@
+/**
+ * @file mode_cards.c
+ *
+ * Pre-rendered mode cards with cached frame restore
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+
+#include "mode_cards.h"
+#include "dash_clock.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void map_framebuffer(const char * fb_path);
+static bool capture_frame(void);
+static void invalidate_event_cb(lv_event_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static lv_obj_t * host;
+static lv_display_t * disp;
+static lv_draw_buf_t * cards[MODE_CARDS_MAX];
+
+/* Offscreen label the cards are rendered from */
+static lv_obj_t * render_scr;
+static lv_obj_t * render_label;
+
+/* Frame under the card */
+static int fb_fd = -1;
+static uint8_t * fbp;
+static size_t fb_size;
+static uint32_t fb_line_length;
+static lv_draw_buf_t * frame;
+static bool frame_valid;
+
+/* Areas invalidated while a card was up */
+static lv_area_t dirty[MODE_CARDS_MAX_DIRTY];
+static uint32_t dirty_cnt;
+static bool visible;
+static bool own_invalidation;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void mode_cards_init(lv_obj_t * card_host, const char * fb_path)
+{
+    LV_ASSERT_NULL(card_host);
+
+    host = card_host;
+    disp = lv_obj_get_display(host);
+
+    lv_obj_set_style_bg_color(host, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(host, LV_OPA_COVER, LV_PART_MAIN);
+    lv_image_set_inner_align(host, LV_IMAGE_ALIGN_CENTER);
+    lv_obj_add_flag(host, LV_OBJ_FLAG_HIDDEN);
+
+    lv_display_add_event_cb(disp, invalidate_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+
+    if(fb_path != NULL) map_framebuffer(fb_path);
+}
+
+void mode_cards_render(uint32_t idx, const char * text, const lv_font_t * font)
+{
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+
+    if(idx >= MODE_CARDS_MAX) return;
+
+    /* A screen that is never loaded, so rendering the cards invalidates nothing */
+    if(render_scr == NULL) {
+        render_scr = lv_obj_create(NULL);
+        render_label = lv_label_create(render_scr);
+        lv_obj_set_style_text_color(render_label, lv_color_black(), LV_PART_MAIN);
+        lv_obj_set_style_bg_color(render_label, lv_color_white(), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(render_label, LV_OPA_COVER, LV_PART_MAIN);
+    }
+
+    lv_obj_set_style_text_font(render_label, font, LV_PART_MAIN);
+    lv_label_set_text_static(render_label, text);
+    lv_obj_update_layout(render_scr);
+
+    if(cards[idx] != NULL) lv_draw_buf_destroy(cards[idx]);
+    cards[idx] = lv_snapshot_take(render_label, lv_display_get_color_format(disp));
+    if(cards[idx] == NULL) {
+        LV_LOG_WARN("cards: could not render %s", text);
+        return;
+    }
+
+    LV_LOG_USER("cards: %s rendered in %uus", text, (unsigned)((uint32_t)dash_clock_mono_us() - start));
+}
+
+void mode_cards_render_done(void)
+{
+    if(render_scr == NULL) return;
+
+    lv_obj_delete(render_scr);
+    render_scr = NULL;
+    render_label = NULL;
+}
+
+void mode_cards_show(uint32_t idx)
+{
+    if(idx >= MODE_CARDS_MAX || cards[idx] == NULL) return;
+
+    /* Back to back mode changes keep the frame of the first one */
+    if(!visible) {
+        /* Draw what is pending first, the copy must be the current frame */
+        lv_refr_now(disp);
+        frame_valid = capture_frame();
+        dirty_cnt = 0;
+    }
+
+    own_invalidation = true;
+    lv_image_set_src(host, cards[idx]);
+    lv_obj_remove_flag(host, LV_OBJ_FLAG_HIDDEN);
+    own_invalidation = false;
+    visible = true;
+}
+
+void mode_cards_hide(void)
+{
+    uint32_t i;
+
+    if(!visible) return;
+
+    if(!frame_valid) {
+        mode_cards_dismiss();
+        return;
+    }
+
+    /* Draw the saved frame over the whole screen: one opaque copy */
+    own_invalidation = true;
+    lv_image_set_src(host, frame);
+    lv_refr_now(disp);
+
+    /* The screen already shows what is under the card, hide it without a redraw */
+    lv_display_enable_invalidation(disp, false);
+    lv_obj_add_flag(host, LV_OBJ_FLAG_HIDDEN);
+    lv_display_enable_invalidation(disp, true);
+    own_invalidation = false;
+    visible = false;
+
+    /* Whatever changed while the card was up is still to be drawn */
+    for(i = 0; i < dirty_cnt; i++) lv_obj_invalidate_area(lv_screen_active(), &dirty[i]);
+    dirty_cnt = 0;
+}
+
+void mode_cards_dismiss(void)
+{
+    if(!visible) return;
+
+    lv_obj_add_flag(host, LV_OBJ_FLAG_HIDDEN);
+    visible = false;
+    dirty_cnt = 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void map_framebuffer(const char * fb_path)
+{
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    int32_t hor = lv_display_get_horizontal_resolution(disp);
+    int32_t ver = lv_display_get_vertical_resolution(disp);
+
+    fb_fd = open(fb_path, O_RDONLY | O_CLOEXEC);
+    if(fb_fd < 0) return;
+
+    if(ioctl(fb_fd, FBIOGET_FSCREENINFO, &finfo) < 0 || ioctl(fb_fd, FBIOGET_VSCREENINFO, &vinfo) < 0 ||
+       vinfo.bits_per_pixel != (uint32_t)lv_color_format_get_size(cf) * 8 ||
+       (int32_t)vinfo.xres < hor || (int32_t)vinfo.yres < ver) {
+        LV_LOG_WARN("cards: %s does not match the display, no frame restore", fb_path);
+        close(fb_fd);
+        fb_fd = -1;
+        return;
+    }
+
+    fb_line_length = finfo.line_length;
+    fb_size = (size_t)finfo.line_length * vinfo.yres_virtual;
+    fbp = mmap(NULL, fb_size, PROT_READ, MAP_SHARED, fb_fd, 0);
+    if(fbp == MAP_FAILED) {
+        fbp = NULL;
+        close(fb_fd);
+        fb_fd = -1;
+        return;
+    }
+
+    /* Allocated once at boot, reused for every card */
+    frame = lv_draw_buf_create((uint32_t)hor, (uint32_t)ver, cf, LV_STRIDE_AUTO);
+}
+
+/**
+ * Copy the visible framebuffer page into the frame buffer
+ * @return true if the frame can be used to restore the screen
+ */
+static bool capture_frame(void)
+{
+    struct fb_var_screeninfo vinfo;
+    uint32_t row_bytes;
+    uint32_t y;
+    const uint8_t * src;
+
+    if(fbp == NULL || frame == NULL) return false;
+
+    /* The visible page may have been panned since init */
+    if(ioctl(fb_fd, FBIOGET_VSCREENINFO, &vinfo) < 0) return false;
+
+    row_bytes = frame->header.w * lv_color_format_get_size(frame->header.cf);
+    src = fbp + (size_t)vinfo.yoffset * fb_line_length + (size_t)vinfo.xoffset * (vinfo.bits_per_pixel / 8);
+    for(y = 0; y < frame->header.h; y++) {
+        memcpy(frame->data + (size_t)y * frame->header.stride, src + (size_t)y * fb_line_length, row_bytes);
+    }
+
+    /* Same buffer, new content */
+    lv_image_cache_drop(frame);
+    return true;
+}
+
+static void invalidate_event_cb(lv_event_t * e)
+{
+    const lv_area_t * area = lv_event_get_param(e);
+
+    if(!visible || own_invalidation || area == NULL) return;
+
+    if(dirty_cnt < MODE_CARDS_MAX_DIRTY) {
+        dirty[dirty_cnt++] = *area;
+    }
+    else {
+        lv_area_join(&dirty[MODE_CARDS_MAX_DIRTY - 1], &dirty[MODE_CARDS_MAX_DIRTY - 1], area);
+    }
+}
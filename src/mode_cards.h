@@ -0,0 +1,90 @@
+/**
+ * @file mode_cards.h
+ *
+ * Pre-rendered full screen cards announcing the drive mode.
+ *
+ * Every card is rendered once, during the staged startup, with
+ * lv_snapshot from a label on a screen that is never loaded. Showing a
+ * card is then a white fill and one opaque image copy, with no glyph
+ * rasterization.
+ *
+ * When a card is shown the frame under it is copied from the framebuffer.
+ * Hiding the card draws that copy instead of re-rendering every dash
+ * widget. The areas invalidated while the card was up are invalidated
+ * again afterwards, so nothing that changed in between is lost.
+ */
+
+#ifndef MODE_CARDS_H
+#define MODE_CARDS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define MODE_CARDS_MAX 8
+
+/* Areas remembered while a card is up, more are merged into one */
+#define MODE_CARDS_MAX_DIRTY 8
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Set up the cards
+ * @param host a full screen image object, hidden, that shows the cards
+ * @param fb_path the framebuffer the frame under a card is copied from,
+ *                NULL to always re-render after a card
+ */
+void mode_cards_init(lv_obj_t * host, const char * fb_path);
+
+/**
+ * Render the card of one text, meant to be a ui_stages step per card
+ * @param idx the card index, less than MODE_CARDS_MAX
+ * @param text the text, must stay valid
+ * @param font the font of the text
+ */
+void mode_cards_render(uint32_t idx, const char * text, const lv_font_t * font);
+
+/**
+ * Free what was only needed for rendering, after the last card
+ */
+void mode_cards_render_done(void);
+
+/**
+ * Show a card over the current screen
+ * @param idx the card index
+ */
+void mode_cards_show(uint32_t idx);
+
+/**
+ * Hide the card and bring back the frame that was under it
+ */
+void mode_cards_hide(void);
+
+/**
+ * Hide the card without restoring the frame, when the screen changes anyway
+ */
+void mode_cards_dismiss(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*MODE_CARDS_H*/
@@ -0,0 +1,229 @@
+/**
+ * @file refresh_governor.c
+ *
+ * Adaptive sleep for the dashboard main loop
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <limits.h>
+#include <poll.h>
+
+#include "refresh_governor.h"
+#include "rt_threads.h"
+#include "dash_clock.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Stay at full rate this long after the last frame, input or telemetry sample */
+#define ACTIVE_HOLD_MS 500
+
+/* Sample the encoder lines this often right after an input edge */
+#define INPUT_POLL_MS 5
+#define INPUT_HOLD_MS 100
+
+/* Print FPS and CPU idle this often */
+#define REPORT_PERIOD_MS 5000
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int add_fd(int fd, bool input);
+static void display_event_cb(lv_event_t * e);
+static bool is_active(void);
+static void report(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/* Panel rate for anything the driver reads while moving, slower for the rest */
+static const uint32_t class_period_ms[REFRESH_CLASS_COUNT] = {
+    [REFRESH_CLASS_LAP_TIMER]   = LV_DEF_REFR_PERIOD,
+    [REFRESH_CLASS_GAUGE]       = LV_DEF_REFR_PERIOD,
+    [REFRESH_CLASS_TEMPERATURE] = 250,
+    [REFRESH_CLASS_STATUS]      = 100,
+};
+
+static struct pollfd wake_fds[REFRESH_GOVERNOR_MAX_WAKE_FDS];
+static bool wake_fd_input[REFRESH_GOVERNOR_MAX_WAKE_FDS];
+static uint32_t wake_fd_cnt;
+
+static bool render_pending;
+static uint32_t last_activity;
+static uint32_t last_input;
+
+static uint32_t report_start;
+static uint32_t waited_ms;
+static uint32_t frame_cnt;
+static uint32_t wakeup_cnt;
+static refresh_governor_stats_t last_stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void refresh_governor_init(lv_display_t * disp)
+{
+    LV_ASSERT_NULL(disp);
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_RENDER_READY, NULL);
+
+    last_activity = lv_tick_get();
+    report_start = last_activity;
+}
+
+int refresh_governor_add_wake_fd(int fd)
+{
+    return add_fd(fd, false);
+}
+
+int refresh_governor_add_input_fd(int fd)
+{
+    return add_fd(fd, true);
+}
+
+uint32_t refresh_governor_class_period(refresh_class_t cls)
+{
+    LV_ASSERT(cls < REFRESH_CLASS_COUNT);
+    return class_period_ms[cls];
+}
+
+void refresh_governor_note_activity(void)
+{
+    last_activity = lv_tick_get();
+}
+
+void refresh_governor_wait(uint32_t timer_idle_ms)
+{
+    uint32_t now = lv_tick_get();
+    uint32_t cap = LV_NO_TIMER_READY;
+    uint32_t wait_ms;
+    uint32_t wait_start;
+    uint32_t i;
+    int32_t late;
+    int timeout;
+    int ready;
+
+    if(lv_tick_elaps(last_input) < INPUT_HOLD_MS) {
+        /* The encoder is decoded from line levels, keep sampling during a detent */
+        cap = INPUT_POLL_MS;
+    }
+    else if(is_active()) {
+        cap = LV_DEF_REFR_PERIOD;
+    }
+
+    last_stats.idle = cap == LV_NO_TIMER_READY;
+
+    wait_ms = LV_MIN(timer_idle_ms, cap);
+    if(wait_ms == LV_NO_TIMER_READY) {
+        /* Nothing is due: sleep until an fd wakes us, never forever without one */
+        timeout = wake_fd_cnt > 0 ? -1 : LV_DEF_REFR_PERIOD;
+    }
+    else {
+        /* A far away timer must not wrap into a negative, endless poll() */
+        timeout = (int)LV_MIN(wait_ms, (uint32_t)INT_MAX);
+    }
+
+    if(dash_clock_is_virtual()) {
+        /* Take what is ready without sleeping, the time passes on the virtual clock */
+        ready = poll(wake_fds, wake_fd_cnt, 0);
+        if(timeout < 0) timeout = LV_DEF_REFR_PERIOD;
+        dash_clock_advance(ready > 0 ? 1 : LV_MAX(timeout, 1));
+    }
+    else {
+        wait_start = (uint32_t)dash_clock_mono_us();
+        ready = poll(wake_fds, wake_fd_cnt, timeout);
+        if(ready == 0 && timeout > 0) {
+            /* Woken up by the timeout, how late that was is the scheduling latency */
+            late = (int32_t)((uint32_t)dash_clock_mono_us() - wait_start - (uint32_t)timeout * 1000);
+            rt_threads_note_wakeup(late > 0 ? (uint32_t)late : 0);
+        }
+    }
+
+    if(ready > 0) {
+        last_activity = lv_tick_get();
+        /* Only an encoder or button edge starts the line sampling, telemetry does not */
+        for(i = 0; i < wake_fd_cnt; i++) {
+            if(wake_fd_input[i] && (wake_fds[i].revents & POLLIN)) last_input = last_activity;
+        }
+    }
+
+    waited_ms += lv_tick_elaps(now);
+    wakeup_cnt++;
+
+    if(lv_tick_elaps(report_start) >= REPORT_PERIOD_MS) {
+        report();
+    }
+}
+
+void refresh_governor_get_stats(refresh_governor_stats_t * stats)
+{
+    *stats = last_stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static int add_fd(int fd, bool input)
+{
+    if(wake_fd_cnt >= REFRESH_GOVERNOR_MAX_WAKE_FDS) {
+        LV_LOG_WARN("Too many wake fds, fd %d ignored", fd);
+        return -1;
+    }
+
+    wake_fds[wake_fd_cnt].fd = fd;
+    wake_fds[wake_fd_cnt].events = POLLIN;
+    wake_fd_input[wake_fd_cnt] = input;
+    wake_fd_cnt++;
+    return 0;
+}
+
+static void display_event_cb(lv_event_t * e)
+{
+    switch(lv_event_get_code(e)) {
+        case LV_EVENT_INVALIDATE_AREA:
+            render_pending = true;
+            break;
+        case LV_EVENT_RENDER_READY:
+            render_pending = false;
+            last_activity = lv_tick_get();
+            frame_cnt++;
+            break;
+        default:
+            break;
+    }
+}
+
+static bool is_active(void)
+{
+    return render_pending ||
+           lv_anim_count_running() > 0 ||
+           lv_tick_elaps(last_activity) < ACTIVE_HOLD_MS;
+}
+
+static void report(void)
+{
+    uint32_t period = lv_tick_elaps(report_start);
+
+    last_stats.frames = frame_cnt;
+    last_stats.wakeups = wakeup_cnt;
+    last_stats.fps_x10 = frame_cnt * 10000 / period;
+    last_stats.idle_pct = LV_MIN(waited_ms, period) * 100 / period;
+
+    LV_LOG_USER("refresh: %s fps=%u.%u idle=%u%% wakeups=%u",
+                last_stats.idle ? "idle" : "active",
+                (unsigned)(last_stats.fps_x10 / 10), (unsigned)(last_stats.fps_x10 % 10),
+                (unsigned)last_stats.idle_pct, (unsigned)last_stats.wakeups);
+
+    report_start = lv_tick_get();
+    waited_ms = 0;
+    frame_cnt = 0;
+    wakeup_cnt = 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file refresh_governor.h
+ *
+ * Decides how long the main loop may sleep between two calls of
+ * lv_timer_handler().
+ *
+ * While something moves on screen (pending invalidations, running
+ * animations, fresh telemetry or input) the loop runs at panel rate.
+ * Once the dash is static the loop only wakes up for LVGL timers that
+ * are actually due or when one of the registered file descriptors
+ * (GPIO edge events, telemetry sockets, ...) becomes readable.
+ */
+
+#ifndef REFRESH_GOVERNOR_H
+#define REFRESH_GOVERNOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of file descriptors that can wake up the main loop */
+#define REFRESH_GOVERNOR_MAX_WAKE_FDS 8
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Widget classes, each one is capped to its own update period */
+typedef enum {
+    REFRESH_CLASS_LAP_TIMER,   /* running lap clock */
+    REFRESH_CLASS_GAUGE,       /* speed, pedals, battery bar */
+    REFRESH_CLASS_TEMPERATURE, /* tire and pack temperatures, pack voltage */
+    REFRESH_CLASS_STATUS,      /* RTD/HV/LV, drive mode, messages */
+    REFRESH_CLASS_COUNT
+} refresh_class_t;
+
+typedef struct {
+    uint32_t frames;      /* frames rendered since the last report */
+    uint32_t wakeups;     /* main loop iterations since the last report */
+    uint32_t fps_x10;     /* achieved frames per second, times 10 */
+    uint32_t idle_pct;    /* share of wall time spent waiting for work */
+    bool idle;            /* true if the last wait was event-only */
+} refresh_governor_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Attach the governor to a display so it can track invalidations and frames
+ * @param disp the display to track
+ */
+void refresh_governor_init(lv_display_t * disp);
+
+/**
+ * Register a file descriptor that wakes up the main loop when readable
+ * @param fd the file descriptor, readiness is treated as activity
+ * @return 0 on success, -1 if the table is full
+ */
+int refresh_governor_add_wake_fd(int fd);
+
+/**
+ * Register the file descriptor of the encoder and button lines. When it is
+ * readable the loop also samples the lines every few ms for a short while.
+ * @param fd the file descriptor
+ * @return 0 on success, -1 if the table is full
+ */
+int refresh_governor_add_input_fd(int fd);
+
+/**
+ * Get the minimum update period of a widget class
+ * @param cls the widget class
+ * @return period in milliseconds
+ */
+uint32_t refresh_governor_class_period(refresh_class_t cls);
+
+/**
+ * Signal that new data arrived, keeps the loop at full rate for a while
+ */
+void refresh_governor_note_activity(void);
+
+/**
+ * Sleep until the next piece of work is due
+ * @param timer_idle_ms the value returned by lv_timer_handler()
+ */
+void refresh_governor_wait(uint32_t timer_idle_ms);
+
+/**
+ * Get the statistics of the last report period
+ * @param stats filled with the statistics
+ */
+void refresh_governor_get_stats(refresh_governor_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*REFRESH_GOVERNOR_H*/
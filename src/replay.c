@@ -0,0 +1,319 @@
+/**
+ * @file replay.c
+ *
+ * Memory mapped session replay
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lvgl/lvgl.h"
+#include "replay.h"
+#include "telemetry.h"
+#include "fault.h"
+#include "rt_threads.h"
+#include "dash_clock.h"
+#include "simulator_util.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t t_ms;
+    uint32_t record;
+} index_entry_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * replay_main(void * arg);
+static void publish_until(uint32_t t_ms);
+static bool rewind_or_finish(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const uint8_t * map;
+static size_t map_size;
+static const replay_record_t * records;
+static uint32_t record_cnt;
+
+static index_entry_t * index_entries;
+static uint32_t index_cnt;
+
+static uint32_t cursor;
+static uint32_t base_ms;        /* session time at the start or the last rewind */
+static uint64_t start_ns;       /* wall time at the start */
+static uint32_t step_ms;        /* session time stepped at speed 0 */
+static uint32_t clock_start_ms; /* dash_clock time at the start, stepped at speed > 0 */
+static float play_speed;
+static bool stepping;
+static bool looping;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static replay_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int replay_init(void)
+{
+    const char * path = getenv_default("DASH_REPLAY", "");
+    float speed = (float)atof(getenv_default("DASH_REPLAY_SPEED", "1"));
+    float start_s = (float)atof(getenv_default("DASH_REPLAY_START_S", "0"));
+
+    if(path[0] == '\0') return 0;
+
+    looping = atoi(getenv_default("DASH_REPLAY_LOOP", "0")) != 0;
+    if(replay_open(path) != 0) return -1;
+    if(start_s > 0.0f) replay_seek((uint32_t)(start_s * 1000.0f));
+    return replay_start(LV_MAX(speed, 0.0f));
+}
+
+int replay_open(const char * path)
+{
+    const replay_header_t * hdr;
+    struct stat st;
+    uint32_t i;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "replay: cannot open %s: %s\n", path, strerror(errno));
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    if((size_t)st.st_size < sizeof(replay_header_t)) {
+        fprintf(stderr, "replay: %s is too short\n", path);
+        close(fd);
+        return -1;
+    }
+
+    map_size = (size_t)st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        fprintf(stderr, "replay: cannot map %s: %s\n", path, strerror(errno));
+        map = NULL;
+        return -1;
+    }
+    /* Read front to back, let the kernel read ahead */
+    madvise((void *)map, map_size, MADV_SEQUENTIAL);
+
+    hdr = (const replay_header_t *)map;
+    if(memcmp(hdr->magic, REPLAY_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != REPLAY_VERSION ||
+       hdr->record_size != sizeof(replay_record_t)) {
+        fprintf(stderr, "replay: %s is not a version %d session\n", path, REPLAY_VERSION);
+        munmap((void *)map, map_size);
+        map = NULL;
+        return -1;
+    }
+
+    records = (const replay_record_t *)(map + sizeof(replay_header_t));
+    record_cnt = (uint32_t)((map_size - sizeof(replay_header_t)) / sizeof(replay_record_t));
+    if((map_size - sizeof(replay_header_t)) % sizeof(replay_record_t) != 0) {
+        /* A recording cut short, the last record is incomplete */
+        fprintf(stderr, "replay: %s ends with a partial record, ignored\n", path);
+    }
+
+    index_cnt = (record_cnt + REPLAY_INDEX_STRIDE - 1) / REPLAY_INDEX_STRIDE;
+    index_entries = malloc(LV_MAX(index_cnt, 1) * sizeof(index_entry_t));
+    if(index_entries == NULL) {
+        munmap((void *)map, map_size);
+        map = NULL;
+        return -1;
+    }
+
+    for(i = 0; i < record_cnt; i++) {
+        if(i > 0 && records[i].t_ms < records[i - 1].t_ms) {
+            fprintf(stderr, "replay: %s goes back in time at record %u\n", path, (unsigned)i);
+            free(index_entries);
+            index_entries = NULL;
+            munmap((void *)map, map_size);
+            map = NULL;
+            return -1;
+        }
+        if(i % REPLAY_INDEX_STRIDE == 0) {
+            index_entries[i / REPLAY_INDEX_STRIDE].t_ms = records[i].t_ms;
+            index_entries[i / REPLAY_INDEX_STRIDE].record = i;
+        }
+    }
+
+    cursor = 0;
+    base_ms = record_cnt > 0 ? records[0].t_ms : 0;
+    stats.records = record_cnt;
+    stats.duration_ms = record_cnt > 0 ? records[record_cnt - 1].t_ms : 0;
+
+    LV_LOG_USER("replay: %s, %u records over %us, %u index entries", path, (unsigned)record_cnt,
+                (unsigned)(stats.duration_ms / 1000), (unsigned)index_cnt);
+    return 0;
+}
+
+void replay_seek(uint32_t t_ms)
+{
+    uint32_t lo = 0;
+    uint32_t hi = index_cnt;
+    uint32_t mid;
+    uint32_t i;
+
+    /* Last index entry at or before t_ms */
+    while(hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if(index_entries[mid].t_ms <= t_ms) lo = mid;
+        else hi = mid;
+    }
+
+    i = index_cnt > 0 ? index_entries[lo].record : 0;
+    while(i < record_cnt && records[i].t_ms < t_ms) i++;
+
+    cursor = i;
+    base_ms = t_ms;
+}
+
+int replay_start(float speed)
+{
+    play_speed = speed;
+    start_ns = dash_clock_mono_us() * 1000;
+    stats.position_ms = base_ms;
+
+    if(speed <= 0.0f || dash_clock_is_virtual()) {
+        /* Stepped by the UI loop */
+        stepping = true;
+        step_ms = base_ms;
+        clock_start_ms = dash_clock_now_ms();
+        if(speed <= 0.0f) LV_LOG_USER("replay: frame by frame");
+        else LV_LOG_USER("replay: %.1fx on the virtual clock", (double)speed);
+        return 0;
+    }
+
+    if(rt_threads_create(RT_THREAD_TELEMETRY, "dash-replay", replay_main, NULL) != 0) return -1;
+    LV_LOG_USER("replay: %.1fx", (double)speed);
+    return 0;
+}
+
+void replay_step(void)
+{
+    if(!stepping) return;
+
+    if(play_speed > 0.0f) step_ms = base_ms + (uint32_t)((dash_clock_now_ms() - clock_start_ms) * (double)play_speed);
+    else step_ms += LV_DEF_REFR_PERIOD;
+    publish_until(step_ms);
+    if(cursor >= record_cnt) stepping = rewind_or_finish();
+}
+
+uint32_t replay_next_ms(void)
+{
+    double due_ms;
+    uint32_t elapsed;
+
+    if(!stepping) return LV_NO_TIMER_READY;
+    if(play_speed <= 0.0f || cursor >= record_cnt) return 0;
+
+    /* On the virtual clock: the time until the next record is due */
+    due_ms = ceil((records[cursor].t_ms - base_ms) / (double)play_speed);
+    elapsed = dash_clock_now_ms() - clock_start_ms;
+    return due_ms > elapsed ? (uint32_t)LV_MIN(due_ms - elapsed, (double)LV_NO_TIMER_READY - 1) : 0;
+}
+
+void replay_get_stats(replay_stats_t * out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * replay_main(void * arg)
+{
+    struct timespec due;
+    uint64_t due_ns;
+    uint32_t t;
+
+    (void)arg;
+
+    do {
+        while(cursor < record_cnt) {
+            t = records[cursor].t_ms;
+            due_ns = start_ns + (uint64_t)((double)(t - base_ms) * 1e6 / play_speed);
+            due.tv_sec = (time_t)(due_ns / 1000000000u);
+            due.tv_nsec = (long)(due_ns % 1000000000u);
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR) {}
+
+            /* Everything recorded at the same time goes out together */
+            publish_until(t);
+        }
+    } while(rewind_or_finish());
+
+    return NULL;
+}
+
+/**
+ * Publish the records up to a session time, straight from the mapping
+ * @param t_ms the session time
+ */
+static void publish_until(uint32_t t_ms)
+{
+    const replay_record_t * rec;
+    uint32_t cnt = 0;
+
+    while(cursor < record_cnt && records[cursor].t_ms <= t_ms) {
+        rec = &records[cursor++];
+        if(rec->ch < TELEM_CHANNEL_COUNT) telemetry_publish((telem_channel_t)rec->ch, rec->v.value);
+        else if(rec->ch == REPLAY_CH_FAULT) fault_report(rec->v.word);
+        cnt++;
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.published += cnt;
+    stats.position_ms = t_ms;
+    stats.wall_ms = (uint32_t)((dash_clock_mono_us() * 1000 - start_ns) / 1000000);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Start over at the end of the session with DASH_REPLAY_LOOP, or stop
+ * @return true if the session starts over
+ */
+static bool rewind_or_finish(void)
+{
+    replay_stats_t s;
+
+    replay_get_stats(&s);
+    LV_LOG_USER("replay: %u records, %us of session in %u.%03us", (unsigned)s.published,
+                (unsigned)((s.duration_ms - (record_cnt > 0 ? records[0].t_ms : 0)) / 1000),
+                (unsigned)(s.wall_ms / 1000), (unsigned)(s.wall_ms % 1000));
+
+    if(looping && record_cnt > 0) {
+        cursor = 0;
+        base_ms = records[0].t_ms;
+        step_ms = base_ms;
+        clock_start_ms = dash_clock_now_ms();
+        start_ns = dash_clock_mono_us() * 1000;
+        return true;
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.done = true;
+    pthread_mutex_unlock(&lock);
+    return false;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file replay.h
+ *
+ * Replay of a recorded session into the telemetry model and the fault path.
+ *
+ * The session file is mapped read-only and its records are published
+ * straight from the mapping, nothing is read into buffers. A sparse index
+ * of every REPLAY_INDEX_STRIDE-th record is built at open, a seek is a
+ * binary search in it followed by a scan of at most one stride.
+ *
+ * At a speed > 0 a telemetry thread publishes the records at their
+ * recorded times scaled by the speed. At speed 0 the UI loop steps the
+ * replay by one frame period of session time per iteration, so every
+ * frame of the session is rendered, as fast as the frames can be drawn.
+ * On the virtual clock of dash_clock.h the UI loop steps the replay at
+ * any speed, by the virtual time that passed scaled by the speed.
+ *
+ * File format, host byte order:
+ * - replay_header_t
+ * - replay_record_t records sorted by time
+ *
+ * Environment:
+ * - DASH_REPLAY         session file, no replay if unset
+ * - DASH_REPLAY_SPEED   1 for real time, N for N times faster, 0 frame by frame
+ * - DASH_REPLAY_START_S start this many seconds into the session
+ * - DASH_REPLAY_LOOP    start over at the end
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define REPLAY_MAGIC   "DASHREC1"
+#define REPLAY_VERSION 1
+
+/* Channel number of the records carrying a fault word */
+#define REPLAY_CH_FAULT 0xFFFF
+
+#define REPLAY_INDEX_STRIDE 256
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;   /* sizeof(replay_record_t) */
+} replay_header_t;
+
+typedef struct {
+    uint32_t t_ms;          /* since the start of the session */
+    uint16_t ch;            /* telem_channel_t or REPLAY_CH_FAULT */
+    uint16_t reserved;
+    union {
+        float value;
+        uint32_t word;      /* fault word of REPLAY_CH_FAULT */
+    } v;
+} replay_record_t;
+
+typedef struct {
+    uint32_t records;       /* in the file */
+    uint32_t duration_ms;   /* session time of the last record */
+    uint32_t position_ms;   /* session time replayed so far */
+    uint32_t published;     /* records published */
+    uint32_t wall_ms;       /* time spent replaying */
+    bool done;
+} replay_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Open and start the replay configured in the environment
+ * @return 0 if a replay runs or none is configured, -1 if the file is not usable
+ */
+int replay_init(void);
+
+/**
+ * Map a session file and index it
+ * @param path the file
+ * @return 0 on success, -1 if it cannot be mapped or is malformed
+ */
+int replay_open(const char * path);
+
+/**
+ * Move to a time of the session, before replay_start()
+ * @param t_ms session time, the next record published is the first one at or after it
+ */
+void replay_seek(uint32_t t_ms);
+
+/**
+ * Start publishing
+ * @param speed session time per wall time, 0 to step with replay_step()
+ *              by frame periods
+ * @return 0 on success, -1 if the replay thread could not be started
+ */
+int replay_start(float speed);
+
+/**
+ * Publish the session up to the current step, UI thread only, at speed 0 or
+ * on the virtual clock
+ */
+void replay_step(void);
+
+/**
+ * Get the time until replay_step() is needed
+ * @return 0 while stepping by frame periods, the time until the next record on
+ *         the virtual clock, LV_NO_TIMER_READY otherwise
+ */
+uint32_t replay_next_ms(void);
+
+/**
+ * Get the progress
+ * @param stats filled with the progress
+ */
+void replay_get_stats(replay_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*REPLAY_H*/
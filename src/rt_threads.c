@@ -0,0 +1,292 @@
+/**
+ * @file rt_threads.c
+ *
+ * CPU pinning, scheduling and memory locking of the dashboard threads
+ */
+
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE /* needed for the CPU affinity and thread names */
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lvgl/lvgl.h"
+#include "rt_threads.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Threads started with rt_threads_create() over the whole run */
+#define MAX_THREADS 8
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char * name;
+    int cpu;
+    int prio;
+} role_cfg_t;
+
+typedef struct {
+    rt_thread_role_t role;
+    rt_thread_fn_t fn;
+    void * arg;
+    char name[16];
+} thread_start_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * thread_main(void * arg);
+static int apply_role(rt_thread_role_t role, const char * name);
+static void lock_memory(void);
+static void prefault_stack(void);
+static void report(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static role_cfg_t roles[RT_THREAD_ROLE_COUNT] = {
+    [RT_THREAD_UI]         = {"ui", 3, 0},
+    [RT_THREAD_INPUT]      = {"input", 2, 80},
+    [RT_THREAD_TELEMETRY]  = {"telemetry", 2, 70},
+    [RT_THREAD_WATCHDOG]   = {"watchdog", -1, 90},
+    [RT_THREAD_BACKGROUND] = {"background", -1, 0},
+};
+
+static bool split_input = true;
+
+static thread_start_t starts[MAX_THREADS];
+static uint32_t start_cnt;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const uint32_t hist_bounds[RT_THREADS_HIST_BUCKETS - 1] = RT_THREADS_HIST_BOUNDS;
+static rt_threads_latency_t latency;
+static uint64_t latency_sum;
+static uint32_t last_report;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void rt_threads_init(void)
+{
+    long cpu_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+    int i;
+
+    split_input = strcmp(getenv_default("DASH_THREADS", "split"), "single") != 0;
+    roles[RT_THREAD_UI].cpu = atoi(getenv_default("DASH_UI_CPU", "3"));
+    roles[RT_THREAD_UI].prio = atoi(getenv_default("DASH_UI_PRIO", "0"));
+    roles[RT_THREAD_INPUT].cpu = atoi(getenv_default("DASH_INPUT_CPU", "2"));
+    roles[RT_THREAD_INPUT].prio = atoi(getenv_default("DASH_INPUT_PRIO", "80"));
+    roles[RT_THREAD_TELEMETRY].cpu = atoi(getenv_default("DASH_TELEM_CPU", "1"));
+    roles[RT_THREAD_TELEMETRY].prio = atoi(getenv_default("DASH_TELEM_PRIO", "70"));
+    roles[RT_THREAD_WATCHDOG].prio = atoi(getenv_default("DASH_WDOG_PRIO", "90"));
+
+    for(i = 0; i < RT_THREAD_ROLE_COUNT; i++) {
+        if(roles[i].cpu >= cpu_cnt) {
+            fprintf(stderr, "rt_threads: no CPU %d for the %s thread, left unpinned\n", roles[i].cpu, roles[i].name);
+            roles[i].cpu = -1;
+        }
+    }
+
+    if(atoi(getenv_default("DASH_MLOCK", "1")) != 0) {
+        lock_memory();
+        prefault_stack();
+    }
+
+    apply_role(RT_THREAD_UI, NULL);
+
+    latency.min_us = UINT32_MAX;
+    last_report = lv_tick_get();
+
+    LV_LOG_USER("rt_threads: %s, ui cpu %d prio %d, input cpu %d prio %d, telemetry cpu %d prio %d",
+                split_input ? "split" : "single",
+                roles[RT_THREAD_UI].cpu, roles[RT_THREAD_UI].prio,
+                roles[RT_THREAD_INPUT].cpu, roles[RT_THREAD_INPUT].prio,
+                roles[RT_THREAD_TELEMETRY].cpu, roles[RT_THREAD_TELEMETRY].prio);
+}
+
+bool rt_threads_split_input(void)
+{
+    return split_input;
+}
+
+int rt_threads_create(rt_thread_role_t role, const char * name, rt_thread_fn_t fn, void * arg)
+{
+    thread_start_t * start;
+    pthread_t thread;
+    pthread_attr_t attr;
+    int res;
+
+    LV_ASSERT(role < RT_THREAD_ROLE_COUNT);
+    LV_ASSERT_NULL(fn);
+
+    pthread_mutex_lock(&lock);
+    if(start_cnt >= MAX_THREADS) {
+        pthread_mutex_unlock(&lock);
+        fprintf(stderr, "rt_threads: too many threads, %s not started\n", name);
+        return -1;
+    }
+    start = &starts[start_cnt++];
+    pthread_mutex_unlock(&lock);
+
+    start->role = role;
+    start->fn = fn;
+    start->arg = arg;
+    lv_snprintf(start->name, sizeof(start->name), "%s", name);
+
+    /* CPU and policy are set by the thread itself, a failure only costs the priority */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, RT_THREADS_STACK_SIZE);
+    res = pthread_create(&thread, &attr, thread_main, start);
+    pthread_attr_destroy(&attr);
+
+    if(res != 0) {
+        fprintf(stderr, "rt_threads: could not start %s: %s\n", name, strerror(res));
+        return -1;
+    }
+    return 0;
+}
+
+void rt_threads_note_wakeup(uint32_t late_us)
+{
+    uint32_t i;
+
+    latency.samples++;
+    latency_sum += late_us;
+    latency.avg_us = (uint32_t)(latency_sum / latency.samples);
+    if(late_us < latency.min_us) latency.min_us = late_us;
+    if(late_us > latency.max_us) latency.max_us = late_us;
+
+    for(i = 0; i < RT_THREADS_HIST_BUCKETS - 1 && late_us >= hist_bounds[i]; i++) {}
+    latency.hist[i]++;
+
+    if(lv_tick_elaps(last_report) >= RT_THREADS_REPORT_MS) {
+        last_report = lv_tick_get();
+        report();
+    }
+}
+
+void rt_threads_get_latency(rt_threads_latency_t * lat)
+{
+    *lat = latency;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * thread_main(void * arg)
+{
+    thread_start_t * start = arg;
+
+    apply_role(start->role, start->name);
+    return start->fn(start->arg);
+}
+
+/**
+ * Pin and schedule the calling thread
+ * @param role the role of the thread
+ * @param name the name of the thread, NULL to keep it
+ * @return 0 if everything was applied, -1 if something was not permitted
+ */
+static int apply_role(rt_thread_role_t role, const char * name)
+{
+    const role_cfg_t * cfg = &roles[role];
+    struct sched_param param = {0};
+    long cpu_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpus;
+    int policy;
+    int res = 0;
+    int err;
+    int i;
+
+    if(name != NULL) pthread_setname_np(pthread_self(), name);
+
+    /* Created threads inherit the CPU of the UI thread, an unpinned role gets them all back */
+    CPU_ZERO(&cpus);
+    if(cfg->cpu >= 0) {
+        CPU_SET(cfg->cpu, &cpus);
+    }
+    else {
+        for(i = 0; i < CPU_SETSIZE && i < cpu_cnt; i++) CPU_SET(i, &cpus);
+        /* Stay off the CPUs of the threads with a deadline, unless nothing is left */
+        for(i = 0; role == RT_THREAD_BACKGROUND && i < RT_THREAD_ROLE_COUNT; i++) {
+            if(roles[i].cpu >= 0 && CPU_COUNT(&cpus) > 1) CPU_CLR(roles[i].cpu, &cpus);
+        }
+    }
+
+    err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if(err != 0) {
+        fprintf(stderr, "rt_threads: could not pin the %s thread: %s\n", cfg->name, strerror(err));
+        res = -1;
+    }
+
+    /* The policy is inherited too, priority 0 goes back to the default one */
+    policy = cfg->prio > 0 ? SCHED_FIFO : SCHED_OTHER;
+    if(policy == SCHED_FIFO) {
+        param.sched_priority = LV_CLAMP(sched_get_priority_min(SCHED_FIFO), cfg->prio,
+                                        sched_get_priority_max(SCHED_FIFO));
+    }
+    err = pthread_setschedparam(pthread_self(), policy, &param);
+    if(err != 0) {
+        fprintf(stderr, "rt_threads: no SCHED_FIFO %d for the %s thread: %s\n",
+                param.sched_priority, cfg->name, strerror(err));
+        res = -1;
+    }
+
+    return res;
+}
+
+static void lock_memory(void)
+{
+    /* Freed memory stays mapped, a later malloc() must not fault it in again */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    /* Only what is touched: the LVGL arena, a replayed session or the framebuffer
+     * are large mappings that the dash uses a part of. The arena is prefaulted
+     * up to its high-water mark by dash_alloc_seal(). */
+    if(mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) != 0) {
+        fprintf(stderr, "rt_threads: could not lock the memory: %s\n", strerror(errno));
+    }
+}
+
+static void prefault_stack(void)
+{
+    volatile uint8_t stack[RT_THREADS_PREFAULT_STACK];
+    size_t i;
+    long page = sysconf(_SC_PAGESIZE);
+
+    for(i = 0; i < sizeof(stack); i += (size_t)page) stack[i] = 0;
+}
+
+static void report(void)
+{
+    LV_LOG_USER("rt_threads: ui wakeup latency over %u wakeups min %uus avg %uus max %uus, "
+                "<50:%u <100:%u <200:%u <500:%u <1m:%u <2m:%u <5m:%u >=5m:%u",
+                (unsigned)latency.samples, (unsigned)latency.min_us, (unsigned)latency.avg_us,
+                (unsigned)latency.max_us,
+                (unsigned)latency.hist[0], (unsigned)latency.hist[1], (unsigned)latency.hist[2],
+                (unsigned)latency.hist[3], (unsigned)latency.hist[4], (unsigned)latency.hist[5],
+                (unsigned)latency.hist[6], (unsigned)latency.hist[7]);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file rt_threads.h
+ *
+ * Threading model of the dashboard.
+ *
+ * Every thread has a role. The role decides the CPU the thread is pinned
+ * to and its scheduling: SCHED_FIFO at the configured priority, or the
+ * default policy for priority 0. Threads without a deadline, e.g. the
+ * driver message layout, run on the CPUs no other role is pinned to.
+ *
+ * rt_threads_init() locks all current and future memory once it is faulted
+ * in, so nothing used is paged out without pinning whole large mappings,
+ * and prefaults the stack of the UI thread.
+ * The latency of the timed wakeups of the UI loop is measured the way
+ * cyclictest does (actual minus programmed wakeup time) and logged as a
+ * histogram every RT_THREADS_REPORT_MS.
+ *
+ * Environment, a CPU of -1 leaves the thread unpinned:
+ * - DASH_THREADS     "split" (default) for the input thread, "single" to
+ *                    read the input on the UI thread
+ * - DASH_UI_CPU      CPU of the UI and rendering thread (default 3)
+ * - DASH_UI_PRIO     SCHED_FIFO priority of the UI thread (default 0)
+ * - DASH_INPUT_CPU   CPU of the input thread (default 2)
+ * - DASH_INPUT_PRIO  SCHED_FIFO priority of the input thread (default 80)
+ * - DASH_TELEM_CPU   CPU of the telemetry acquisition threads (default 1),
+ *                    not the input CPU so a telemetry burst does not delay
+ *                    an encoder edge
+ * - DASH_TELEM_PRIO  SCHED_FIFO priority of the telemetry threads (default 70)
+ * - DASH_WDOG_PRIO   SCHED_FIFO priority of the UI watchdog, unpinned (default 90)
+ * - DASH_MLOCK       lock and prefault memory (default 1)
+ */
+
+#ifndef RT_THREADS_H
+#define RT_THREADS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Stack of the created threads, locked in memory with the rest */
+#define RT_THREADS_STACK_SIZE (256 * 1024)
+
+/* Stack of the UI thread touched at startup */
+#define RT_THREADS_PREFAULT_STACK (512 * 1024)
+
+#define RT_THREADS_REPORT_MS 10000
+
+/* Upper bounds of the latency histogram buckets, us, the last one is open */
+#define RT_THREADS_HIST_BOUNDS {50, 100, 200, 500, 1000, 2000, 5000}
+#define RT_THREADS_HIST_BUCKETS 8
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    RT_THREAD_UI,         /* LVGL timers and rendering, the main thread */
+    RT_THREAD_INPUT,      /* encoder and button */
+    RT_THREAD_TELEMETRY,  /* acquisition of telemetry */
+    RT_THREAD_WATCHDOG,   /* stall detection of the UI thread */
+    RT_THREAD_BACKGROUND, /* everything without a deadline */
+    RT_THREAD_ROLE_COUNT
+} rt_thread_role_t;
+
+typedef void * (*rt_thread_fn_t)(void * arg);
+
+typedef struct {
+    uint32_t samples;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t hist[RT_THREADS_HIST_BUCKETS];
+} rt_threads_latency_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Read the configuration, lock the memory and set up the calling thread as the UI thread
+ */
+void rt_threads_init(void);
+
+/**
+ * Check whether input runs on its own thread
+ * @return true with DASH_THREADS=split
+ */
+bool rt_threads_split_input(void);
+
+/**
+ * Start a detached thread with the CPU and scheduling of a role
+ * @param role the role
+ * @param name thread name, at most 15 characters
+ * @param fn the thread function
+ * @param arg passed to fn
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int rt_threads_create(rt_thread_role_t role, const char * name, rt_thread_fn_t fn, void * arg);
+
+/**
+ * Note a timed wakeup of the UI loop
+ * @param late_us time between the programmed and the actual wakeup
+ */
+void rt_threads_note_wakeup(uint32_t late_us);
+
+/**
+ * Get the wakeup latency since the start
+ * @param lat filled with the statistics
+ */
+void rt_threads_get_latency(rt_threads_latency_t * lat);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*RT_THREADS_H*/
@@ -0,0 +1,487 @@
+/**
+ * @file scroll_text.c
+ *
+ * Scrolling message box drawn from a cached rendering of its text
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "scroll_text.h"
+#include "dash_clock.h"
+#include "view_lifecycle.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define REPORT_PERIOD_MS 5000
+
+/* Scroll step, one per frame */
+#define SCROLL_PERIOD_MS LV_DEF_REFR_PERIOD
+
+/* Joined lines given to the label with DASH_SCROLL_TEXT=label */
+#define JOIN_BUF_SIZE 1024
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    lv_obj_t * obj;
+    lv_obj_t * content;     /* the image showing buf, or the label with DASH_SCROLL_TEXT=label */
+    lv_draw_buf_t * buf;
+    lv_display_t * disp;
+    uint32_t id;
+    const lv_font_t * font;
+    uint32_t max_lines;
+    lv_color_t text_color;
+    lv_color_t bg_color;
+
+    /* Given to scroll_text_set_lines(), rasterized at the next refresh */
+    const char * pending_text;
+    const scroll_text_line_t * pending_lines;
+    uint32_t pending_cnt;
+    bool pending;
+
+    lv_timer_t * scroll_timer;
+    uint32_t scroll_start;
+    uint32_t scroll_last;
+    int32_t scroll_text_h;
+    int32_t scroll_dist;
+
+    scroll_text_stats_t stats;
+    uint32_t draw_start_us;
+    uint32_t draw_total_us;
+    uint32_t last_report;
+} scroll_text_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int32_t render_cached(scroll_text_t * st, const char * text, int32_t w);
+static int32_t render_lines(scroll_text_t * st, const char * text, const scroll_text_line_t * lines,
+                            uint32_t cnt, int32_t w);
+static bool prepare_buf(scroll_text_t * st, lv_color_format_t cf, int32_t w, int32_t h);
+static void create_render_scr(void);
+static void apply_lines(scroll_text_t * st);
+static void start_scroll(scroll_text_t * st, int32_t text_h, int32_t view_h);
+static void scroll_timer_cb(lv_timer_t * t);
+static void refr_start_cb(lv_event_t * e);
+static void draw_event_cb(lv_event_t * e);
+static void delete_event_cb(lv_event_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static bool label_mode;
+static bool mode_read;
+static uint32_t next_id;
+
+/* Never loaded, laying out text on it invalidates nothing */
+static lv_obj_t * render_scr;
+static lv_obj_t * render_label;
+static lv_obj_t * render_canvas;
+
+static char join_buf[JOIN_BUF_SIZE];
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+lv_obj_t * scroll_text_create(lv_obj_t * parent, int view, const lv_font_t * font, uint32_t max_lines,
+                              lv_color_t text_color, lv_color_t bg_color)
+{
+    const char * env;
+    scroll_text_t * st;
+    lv_obj_t * obj;
+
+    if(!mode_read) {
+        env = getenv("DASH_SCROLL_TEXT");
+        label_mode = env != NULL && strcmp(env, "label") == 0;
+        mode_read = true;
+    }
+
+    st = lv_malloc_zeroed(sizeof(scroll_text_t));
+    LV_ASSERT_MALLOC(st);
+
+    st->id = next_id++;
+    st->font = font;
+    st->max_lines = max_lines;
+    st->text_color = text_color;
+    st->bg_color = bg_color;
+    st->last_report = lv_tick_get();
+
+    obj = lv_obj_create(parent);
+    lv_obj_remove_style_all(obj);
+    lv_obj_remove_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_color(obj, bg_color, LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(obj, LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_set_user_data(obj, st);
+    st->obj = obj;
+    st->disp = lv_obj_get_display(obj);
+
+    if(label_mode) {
+        st->content = lv_label_create(obj);
+        lv_obj_set_width(st->content, LV_PCT(100));
+        lv_label_set_long_mode(st->content, LV_LABEL_LONG_WRAP);
+        lv_obj_set_style_text_color(st->content, text_color, LV_PART_MAIN);
+        lv_obj_set_style_text_font(st->content, font, LV_PART_MAIN);
+        lv_obj_set_style_text_align(st->content, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    }
+    else {
+        st->content = lv_image_create(obj);
+    }
+
+    /* Set once here, so moving the content later only updates its styles */
+    lv_obj_align(st->content, LV_ALIGN_CENTER, 0, 0);
+
+    /* Scrolls only while the view is shown */
+    st->scroll_timer = lv_timer_create(scroll_timer_cb, SCROLL_PERIOD_MS, st);
+    view_lifecycle_attach_timer(view, st->scroll_timer, false);
+
+    lv_obj_add_event_cb(obj, draw_event_cb, LV_EVENT_DRAW_MAIN_BEGIN, st);
+    lv_obj_add_event_cb(obj, draw_event_cb, LV_EVENT_DRAW_POST_END, st);
+    lv_obj_add_event_cb(obj, delete_event_cb, LV_EVENT_DELETE, st);
+    lv_display_add_event_cb(st->disp, refr_start_cb, LV_EVENT_REFR_START, st);
+
+    return obj;
+}
+
+void scroll_text_set_text(lv_obj_t * obj, const char * text)
+{
+    scroll_text_t * st = lv_obj_get_user_data(obj);
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    int32_t text_h;
+    int32_t view_h;
+
+    lv_obj_update_layout(obj);
+    view_h = lv_obj_get_content_height(obj);
+
+    if(label_mode) {
+        lv_label_set_text(st->content, text);
+        lv_obj_update_layout(st->content);
+        text_h = lv_obj_get_height(st->content);
+    }
+    else {
+        text_h = render_cached(st, text, lv_obj_get_content_width(obj));
+        if(text_h < 0) return;
+    }
+
+    st->stats.renders++;
+    st->stats.last_render_us = (uint32_t)dash_clock_mono_us() - start;
+
+    start_scroll(st, text_h, view_h);
+}
+
+void scroll_text_set_lines(lv_obj_t * obj, const char * text, const scroll_text_line_t * lines, uint32_t cnt)
+{
+    scroll_text_t * st = lv_obj_get_user_data(obj);
+
+    st->pending_text = text;
+    st->pending_lines = lines;
+    st->pending_cnt = cnt;
+    st->pending = true;
+    lv_obj_invalidate(obj);
+}
+
+void scroll_text_get_stats(lv_obj_t * obj, scroll_text_stats_t * out)
+{
+    scroll_text_t * st = lv_obj_get_user_data(obj);
+    *out = st->stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Rasterize the lines of the last scroll_text_set_lines() and scroll them if they do not fit
+ * @param st the widget
+ */
+static void apply_lines(scroll_text_t * st)
+{
+    const char * text = st->pending_text;
+    const scroll_text_line_t * lines = st->pending_lines;
+    uint32_t cnt = st->pending_cnt;
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    uint32_t len = 0;
+    uint32_t i;
+    int32_t text_h;
+    int32_t view_h;
+
+    st->pending = false;
+    lv_obj_update_layout(st->obj);
+    view_h = lv_obj_get_content_height(st->obj);
+
+    if(label_mode) {
+        /* The label breaks the lines again, like before the worker existed */
+        join_buf[0] = '\0';
+        for(i = 0; i < cnt; i++) {
+            len += lv_snprintf(join_buf + len, sizeof(join_buf) - len, i ? "\n%s" : "%s", text + lines[i].start);
+            if(len >= sizeof(join_buf)) break;
+        }
+        lv_label_set_text(st->content, join_buf);
+        lv_obj_update_layout(st->content);
+        text_h = lv_obj_get_height(st->content);
+    }
+    else {
+        text_h = render_lines(st, text, lines, cnt, lv_obj_get_content_width(st->obj));
+        if(text_h < 0) return;
+    }
+
+    st->stats.renders++;
+    st->stats.last_render_us = (uint32_t)dash_clock_mono_us() - start;
+
+    start_scroll(st, text_h, view_h);
+}
+
+/**
+ * Rasterize the wrapped text into the widget's buffer and show it
+ * @param st the widget
+ * @param text the text
+ * @param w the wrap width
+ * @return the height of the text, -1 on error
+ */
+static int32_t render_cached(scroll_text_t * st, const char * text, int32_t w)
+{
+    lv_display_t * disp = lv_obj_get_display(st->content);
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    int32_t h;
+
+    create_render_scr();
+
+    lv_obj_set_width(render_label, w);
+    lv_obj_set_style_text_font(render_label, st->font, LV_PART_MAIN);
+    lv_obj_set_style_text_color(render_label, st->text_color, LV_PART_MAIN);
+    lv_obj_set_style_bg_color(render_label, st->bg_color, LV_PART_MAIN);
+    lv_label_set_text_static(render_label, text);
+    lv_obj_update_layout(render_scr);
+    h = lv_obj_get_height(render_label);
+
+    lv_image_set_src(st->content, NULL);
+    if(!prepare_buf(st, cf, w, h) || lv_snapshot_take_to_draw_buf(render_label, cf, st->buf) != LV_RESULT_OK) {
+        LV_LOG_WARN("scroll_text %u: could not render %dx%d", (unsigned)st->id, (int)w, (int)h);
+        lv_label_set_text_static(render_label, "");
+        return -1;
+    }
+
+    /* The caller's string is not kept */
+    lv_label_set_text_static(render_label, "");
+
+    lv_image_cache_drop(st->buf);
+    lv_image_set_src(st->content, st->buf);
+
+    LV_LOG_USER("scroll_text %u: %dx%d laid out and rasterized once", (unsigned)st->id, (int)w, (int)h);
+    return h;
+}
+
+/**
+ * Draw lines laid out ahead into the widget's buffer and show it
+ * @param st the widget
+ * @param text the lines, each NUL terminated
+ * @param lines the line offsets and positions
+ * @param cnt number of lines
+ * @param w the box width
+ * @return the height of the text, -1 on error
+ */
+static int32_t render_lines(scroll_text_t * st, const char * text, const scroll_text_line_t * lines,
+                            uint32_t cnt, int32_t w)
+{
+    lv_display_t * disp = lv_obj_get_display(st->content);
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    int32_t line_h = lv_font_get_line_height(st->font);
+    lv_draw_label_dsc_t dsc;
+    lv_layer_t layer;
+    lv_area_t area;
+    int32_t h;
+    uint32_t i;
+
+    if(cnt > st->max_lines) {
+        LV_LOG_WARN("scroll_text %u: %u lines, only %u shown", (unsigned)st->id, (unsigned)cnt,
+                    (unsigned)st->max_lines);
+        cnt = st->max_lines;
+    }
+    h = LV_MAX((int32_t)cnt, 1) * line_h;
+
+    create_render_scr();
+
+    lv_image_set_src(st->content, NULL);
+    if(!prepare_buf(st, cf, w, h)) {
+        LV_LOG_WARN("scroll_text %u: could not render %dx%d", (unsigned)st->id, (int)w, (int)h);
+        return -1;
+    }
+
+    lv_canvas_set_draw_buf(render_canvas, st->buf);
+    lv_canvas_fill_bg(render_canvas, st->bg_color, LV_OPA_COVER);
+    lv_canvas_init_layer(render_canvas, &layer);
+
+    /* Every line fits, expanding skips the line breaking of the label renderer */
+    lv_draw_label_dsc_init(&dsc);
+    dsc.font = st->font;
+    dsc.color = st->text_color;
+    dsc.flag = LV_TEXT_FLAG_EXPAND;
+
+    for(i = 0; i < cnt; i++) {
+        dsc.text = text + lines[i].start;
+        area.x1 = lines[i].x;
+        area.y1 = (int32_t)i * line_h;
+        area.x2 = w - 1;
+        area.y2 = area.y1 + line_h - 1;
+        lv_draw_label(&layer, &dsc, &area);
+    }
+
+    lv_canvas_finish_layer(render_canvas, &layer);
+
+    lv_image_cache_drop(st->buf);
+    lv_image_set_src(st->content, st->buf);
+
+    return h;
+}
+
+/**
+ * Shape the buffer to the given size. It is allocated by the first call for
+ * max_lines of text, or the given height if taller, and never reallocated.
+ * @param st the widget
+ * @param cf the color format
+ * @param w the width
+ * @param h the height
+ * @return true if st->buf can be drawn into, false if it does not fit
+ */
+static bool prepare_buf(scroll_text_t * st, lv_color_format_t cf, int32_t w, int32_t h)
+{
+    int32_t max_h;
+
+    if(st->buf == NULL) {
+        max_h = LV_MAX(h, (int32_t)st->max_lines * lv_font_get_line_height(st->font));
+        st->buf = lv_draw_buf_create((uint32_t)w, (uint32_t)max_h, cf, LV_STRIDE_AUTO);
+        if(st->buf == NULL) return false;
+    }
+
+    return lv_draw_buf_reshape(st->buf, cf, (uint32_t)w, (uint32_t)h, LV_STRIDE_AUTO) != NULL;
+}
+
+static void create_render_scr(void)
+{
+    if(render_scr != NULL) return;
+
+    render_scr = lv_obj_create(NULL);
+    render_label = lv_label_create(render_scr);
+    lv_label_set_long_mode(render_label, LV_LABEL_LONG_WRAP);
+    lv_obj_set_style_text_align(render_label, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(render_label, LV_OPA_COVER, LV_PART_MAIN);
+    render_canvas = lv_canvas_create(render_scr);
+}
+
+/**
+ * Scroll the content if it is taller than the box, or center it
+ * @param st the widget
+ * @param text_h height of the content
+ * @param view_h height of the box
+ */
+static void start_scroll(scroll_text_t * st, int32_t text_h, int32_t view_h)
+{
+    if(text_h <= view_h) {
+        view_lifecycle_timer_run(st->scroll_timer, false);
+        lv_obj_align(st->content, LV_ALIGN_CENTER, 0, 0);
+        return;
+    }
+
+    lv_obj_align(st->content, LV_ALIGN_TOP_MID, 0, 0);
+
+    st->scroll_text_h = text_h;
+    st->scroll_dist = text_h - view_h;
+    st->scroll_start = lv_tick_get();
+    st->scroll_last = st->scroll_start;
+    view_lifecycle_timer_run(st->scroll_timer, true);
+}
+
+/**
+ * Place the content for the current time: scroll down, pause at the bottom,
+ * scroll back up and pause at the top. Unlike an animation the timer exists
+ * from the start, so a new message allocates nothing.
+ */
+static void scroll_timer_cb(lv_timer_t * t)
+{
+    scroll_text_t * st = lv_timer_get_user_data(t);
+    uint32_t move_ms = (uint32_t)st->scroll_text_h * SCROLL_TEXT_MS_PER_PX;
+    uint32_t phase;
+    int32_t y;
+
+    /* Resumed after its view was hidden: start again from the top */
+    if(lv_tick_elaps(st->scroll_last) > 2 * SCROLL_PERIOD_MS) st->scroll_start = lv_tick_get();
+    st->scroll_last = lv_tick_get();
+
+    phase = lv_tick_elaps(st->scroll_start) % (2 * (move_ms + SCROLL_TEXT_PAUSE_MS));
+    if(phase < move_ms) {
+        y = -(int32_t)((int64_t)st->scroll_dist * phase / move_ms);
+    }
+    else if(phase < move_ms + SCROLL_TEXT_PAUSE_MS) {
+        y = -st->scroll_dist;
+    }
+    else if(phase < 2 * move_ms + SCROLL_TEXT_PAUSE_MS) {
+        phase -= move_ms + SCROLL_TEXT_PAUSE_MS;
+        y = -st->scroll_dist + (int32_t)((int64_t)st->scroll_dist * phase / move_ms);
+    }
+    else {
+        y = 0;
+    }
+
+    lv_obj_set_y(st->content, y);
+}
+
+/**
+ * New lines are rasterized when the display starts a refresh, as part of
+ * the render pass, and show up in the frame that follows
+ */
+static void refr_start_cb(lv_event_t * e)
+{
+    scroll_text_t * st = lv_event_get_user_data(e);
+
+    if(st->pending) apply_lines(st);
+}
+
+static void draw_event_cb(lv_event_t * e)
+{
+    scroll_text_t * st = lv_event_get_user_data(e);
+    uint32_t elapsed;
+
+    if(lv_event_get_code(e) == LV_EVENT_DRAW_MAIN_BEGIN) {
+        st->draw_start_us = (uint32_t)dash_clock_mono_us();
+        return;
+    }
+
+    /* Covers the children too, without draw threads they are drawn in between */
+    elapsed = (uint32_t)dash_clock_mono_us() - st->draw_start_us;
+    st->stats.draws++;
+    st->draw_total_us += elapsed;
+    st->stats.avg_draw_us = st->draw_total_us / st->stats.draws;
+    if(elapsed > st->stats.max_draw_us) st->stats.max_draw_us = elapsed;
+
+    if(lv_tick_elaps(st->last_report) >= REPORT_PERIOD_MS) {
+        st->last_report = lv_tick_get();
+        LV_LOG_USER("scroll_text %u (%s): %u draws, avg %uus, max %uus, last render %uus",
+                    (unsigned)st->id, label_mode ? "label" : "cached", (unsigned)st->stats.draws,
+                    (unsigned)st->stats.avg_draw_us, (unsigned)st->stats.max_draw_us,
+                    (unsigned)st->stats.last_render_us);
+    }
+}
+
+static void delete_event_cb(lv_event_t * e)
+{
+    scroll_text_t * st = lv_event_get_user_data(e);
+
+    lv_display_remove_event_cb_with_user_data(st->disp, refr_start_cb, st);
+    view_lifecycle_detach_timer(st->scroll_timer);
+    lv_timer_delete(st->scroll_timer);
+    if(st->buf != NULL) {
+        lv_image_cache_drop(st->buf);
+        lv_draw_buf_destroy(st->buf);
+    }
+    lv_free(st);
+}
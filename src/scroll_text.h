@@ -0,0 +1,114 @@
+/**
+ * @file scroll_text.h
+ *
+ * Message box that scrolls a cached rendering of its text.
+ *
+ * The text is laid out and rasterized once per scroll_text_set_text() into
+ * an opaque draw buffer in the display's color format. The widget shows it
+ * as an image clipped to its content area, so a scroll step only blits a
+ * different window of the buffer instead of laying out and drawing the
+ * glyphs of every visible line again. Text taller than the box scrolls
+ * down and back up with a pause at both ends, while the box's view is
+ * visible.
+ *
+ * Text laid out ahead, e.g. by the driver message worker, is given as
+ * lines with scroll_text_set_lines() and only rasterized here, when the
+ * display starts its next refresh. The buffer is sized for max_lines by
+ * the first text and the scroll timer exists from creation, so a new
+ * message allocates nothing outside the render pass of dash_alloc.h.
+ *
+ * The draw time of every widget is measured and logged periodically. With
+ * DASH_SCROLL_TEXT=label the widgets draw a live label like before, so the
+ * two ways can be compared on the target.
+ */
+
+#ifndef SCROLL_TEXT_H
+#define SCROLL_TEXT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Scroll speed and the pause at the top and at the bottom */
+#define SCROLL_TEXT_MS_PER_PX 15
+#define SCROLL_TEXT_PAUSE_MS  1000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* A line of a text laid out ahead */
+typedef struct {
+    uint16_t start;         /* offset of the line in the text, NUL terminated */
+    int16_t x;              /* left edge in the box */
+} scroll_text_line_t;
+
+typedef struct {
+    uint32_t renders;       /* texts laid out and rasterized */
+    uint32_t last_render_us;
+    uint32_t draws;         /* draws of the widget by the refresh */
+    uint32_t avg_draw_us;
+    uint32_t max_draw_us;
+} scroll_text_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Create a scrolling message box, its size is set by the caller
+ * @param parent the parent object
+ * @param view the view_lifecycle id the scroll timer follows
+ * @param font the text font
+ * @param max_lines lines of the tallest text, further lines are not shown
+ * @param text_color the text color
+ * @param bg_color the background, the cached text is opaque
+ * @return the widget
+ */
+lv_obj_t * scroll_text_create(lv_obj_t * parent, int view, const lv_font_t * font, uint32_t max_lines,
+                              lv_color_t text_color, lv_color_t bg_color);
+
+/**
+ * Lay out and rasterize a new text, and scroll it if it does not fit
+ * @param obj the widget
+ * @param text the text, wrapped to the widget's width and centered, copied
+ */
+void scroll_text_set_text(lv_obj_t * obj, const char * text);
+
+/**
+ * Show a text that is already broken into lines, and scroll it if it does not fit.
+ * It is rasterized at the start of the next refresh, a later call replaces it.
+ * @param obj the widget
+ * @param text the lines, each NUL terminated, kept until the next call
+ * @param lines the line offsets and positions, one font line height apart, kept until the next call
+ * @param cnt number of lines, at most max_lines are shown
+ */
+void scroll_text_set_lines(lv_obj_t * obj, const char * text, const scroll_text_line_t * lines, uint32_t cnt);
+
+/**
+ * Get the render and draw counters of a widget
+ * @param obj the widget
+ * @param stats filled with the counters
+ */
+void scroll_text_get_stats(lv_obj_t * obj, scroll_text_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*SCROLL_TEXT_H*/
@@ -0,0 +1,607 @@
+/**
+ * @file session_log.c
+ *
+ * Columnar segment logger of the telemetry samples
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if DASH_LOG_LZ4
+#include <lz4.h>
+#endif
+
+#include "lvgl/lvgl.h"
+#include "session_log.h"
+#include "dash_clock.h"
+#include "rt_threads.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define QUEUE_MASK (SESSION_LOG_QUEUE_LEN - 1)
+
+/* Column data of a full block: a count per channel and two 5 byte varints per sample */
+#define RAW_MAX (TELEM_CHANNEL_COUNT * 5 + SESSION_LOG_BLOCK_SAMPLES * 10)
+
+#if DASH_LOG_LZ4
+#define STORED_MAX LZ4_COMPRESSBOUND(RAW_MAX)
+#else
+#define STORED_MAX RAW_MAX
+#endif
+
+#define BLOCK_MAX (sizeof(session_log_block_header_t) + STORED_MAX)
+
+#define SEG_NAME_FMT "seg-%06u.dlog"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t seq;
+    uint16_t ch;
+    uint32_t t_ms;
+    float value;
+} queue_cell_t;
+
+typedef struct {
+    uint32_t t_ms;
+    uint32_t bits;
+    uint16_t ch;
+} sample_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * logger_main(void * arg);
+static bool queue_pop(sample_t * s);
+static void encode_block(void);
+static void write_buf(void);
+static void sync_segment(void);
+static int open_segment(void);
+static uint32_t newest_segment(bool * found);
+static uint32_t put_varint(uint8_t * p, uint32_t v);
+static uint32_t zigzag(int32_t v);
+static void crc_init(void);
+static uint32_t crc32(const void * data, size_t len);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/* Bounded multi-producer queue, every cell carries the position it is ready for */
+static queue_cell_t queue[SESSION_LOG_QUEUE_LEN];
+static uint32_t enqueue_pos;
+static uint32_t dequeue_pos;
+static uint32_t dropped;
+static bool running;
+
+/* Owned by the logger thread */
+static const char * log_dir;
+static uint32_t segment_limit;
+static uint32_t sync_period_ms;
+static bool use_lz4;
+
+static sample_t block[SESSION_LOG_BLOCK_SAMPLES];
+static uint32_t block_cnt;
+static uint32_t block_start;
+static uint8_t raw[RAW_MAX];
+
+static uint8_t * buf;
+static uint32_t buf_len;
+static uint32_t buf_start;
+
+static int seg_fd = -1;
+static uint32_t seg_index;
+static uint32_t seg_size;
+static bool seg_unsynced;
+static uint32_t last_sync;
+
+static uint32_t crc_table[256];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static session_log_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int session_log_init(void)
+{
+    uint32_t i;
+
+    log_dir = getenv_default("DASH_LOG_DIR", "");
+    if(log_dir[0] == '\0') return 0;
+
+    segment_limit = (uint32_t)atoi(getenv_default("DASH_LOG_SEGMENT_MB", "64")) * 1024 * 1024;
+    sync_period_ms = (uint32_t)atoi(getenv_default("DASH_LOG_SYNC_S", "5")) * 1000;
+#if DASH_LOG_LZ4
+    use_lz4 = atoi(getenv_default("DASH_LOG_LZ4", "1")) != 0;
+#endif
+
+    crc_init();
+    for(i = 0; i < SESSION_LOG_QUEUE_LEN; i++) queue[i].seq = i;
+
+    if(mkdir(log_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "session_log: cannot create %s: %s\n", log_dir, strerror(errno));
+        return -1;
+    }
+
+    if(posix_memalign((void **)&buf, SESSION_LOG_BUF_ALIGN, SESSION_LOG_BUF_SIZE) != 0) return -1;
+
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    if(rt_threads_create(RT_THREAD_BACKGROUND, "dash-logger", logger_main, NULL) != 0) {
+        __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    LV_LOG_USER("session_log: logging to %s, %s, sync every %us", log_dir, use_lz4 ? "LZ4" : "uncompressed",
+                (unsigned)(sync_period_ms / 1000));
+    return 0;
+}
+
+void session_log_push(telem_channel_t ch, float value, uint32_t t_ms)
+{
+    queue_cell_t * cell;
+    uint32_t pos;
+    uint32_t seq;
+    int32_t diff;
+
+    if(!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+
+    pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    while(1) {
+        cell = &queue[pos & QUEUE_MASK];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int32_t)(seq - pos);
+        if(diff == 0) {
+            /* The cell is free, claim the position */
+            if(__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED)) break;
+        }
+        else if(diff < 0) {
+            /* The logger is a whole queue behind */
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->ch = (uint16_t)ch;
+    cell->t_ms = t_ms;
+    cell->value = value;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+long session_log_recover(const char * path, uint32_t * blocks)
+{
+    session_log_seg_header_t sh;
+    session_log_block_header_t bh;
+    struct stat st;
+    uint8_t * data;
+    uint32_t cnt = 0;
+    off_t off;
+    long cut;
+    int fd;
+
+    if(blocks) *blocks = 0;
+    crc_init();
+
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    data = malloc(STORED_MAX);
+    if(data == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    off = 0;
+    if(pread(fd, &sh, sizeof(sh), 0) == (ssize_t)sizeof(sh) &&
+       memcmp(sh.magic, SESSION_LOG_SEG_MAGIC, sizeof(sh.magic)) == 0 &&
+       sh.header_crc == crc32(&sh, offsetof(session_log_seg_header_t, header_crc))) {
+        off = sizeof(sh);
+
+        /* Walk the blocks up to the first one that is not complete and intact */
+        while(pread(fd, &bh, sizeof(bh), off) == (ssize_t)sizeof(bh)) {
+            if(bh.magic != SESSION_LOG_BLOCK_MAGIC ||
+               bh.header_crc != crc32(&bh, offsetof(session_log_block_header_t, header_crc)) ||
+               bh.stored_size > STORED_MAX ||
+               pread(fd, data, bh.stored_size, off + (off_t)sizeof(bh)) != (ssize_t)bh.stored_size ||
+               bh.data_crc != crc32(data, bh.stored_size)) break;
+            off += (off_t)(sizeof(bh) + bh.stored_size);
+            cnt++;
+        }
+    }
+
+    free(data);
+
+    cut = (long)(st.st_size - off);
+    if(cut > 0) {
+        if(ftruncate(fd, off) != 0 || fdatasync(fd) != 0) {
+            fprintf(stderr, "session_log: cannot truncate %s: %s\n", path, strerror(errno));
+        }
+    }
+    close(fd);
+
+    /* Not even the header made it to the disk */
+    if(off == 0) unlink(path);
+
+    if(blocks) *blocks = cnt;
+    return cut;
+}
+
+void session_log_get_stats(session_log_stats_t * out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    out->pushed = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * logger_main(void * arg)
+{
+    struct timespec period = {0, SESSION_LOG_DRAIN_MS * 1000000L};
+    char path[PATH_MAX];
+    uint32_t last_report;
+    uint32_t recovered;
+    session_log_stats_t s;
+    bool found;
+    uint32_t now;
+    long cut;
+
+    (void)arg;
+
+    /* Samples queue up meanwhile, a long recovery drops the oldest ones */
+    seg_index = newest_segment(&found);
+    if(found) {
+        snprintf(path, sizeof(path), "%s/" SEG_NAME_FMT, log_dir, (unsigned)seg_index);
+        cut = session_log_recover(path, &recovered);
+        if(cut > 0) {
+            fprintf(stderr, "session_log: %s ended with a partial block, cut %ld bytes, %u blocks kept\n",
+                    path, cut, (unsigned)recovered);
+        }
+        seg_index++;
+    }
+
+    if(open_segment() != 0) {
+        __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    last_report = (uint32_t)(dash_clock_mono_us() / 1000);
+    last_sync = last_report;
+
+    while(1) {
+        nanosleep(&period, NULL);
+
+        while(block_cnt < SESSION_LOG_BLOCK_SAMPLES && queue_pop(&block[block_cnt])) {
+            if(block_cnt == 0) block_start = (uint32_t)(dash_clock_mono_us() / 1000);
+            if(++block_cnt == SESSION_LOG_BLOCK_SAMPLES) encode_block();
+        }
+
+        now = (uint32_t)(dash_clock_mono_us() / 1000);
+        if(block_cnt > 0 && now - block_start >= SESSION_LOG_WRITE_MS) encode_block();
+        if(buf_len > 0 && now - buf_start >= SESSION_LOG_WRITE_MS) write_buf();
+        if(seg_unsynced && now - last_sync >= sync_period_ms) sync_segment();
+
+        if(now - last_report >= SESSION_LOG_REPORT_MS) {
+            last_report = now;
+            session_log_get_stats(&s);
+            LV_LOG_USER("session_log: %u samples, %u dropped, %u.%02u bytes/sample, worst write %ums",
+                        (unsigned)s.logged, (unsigned)s.dropped,
+                        (unsigned)(s.logged ? s.stored_bytes / s.logged : 0),
+                        (unsigned)(s.logged ? s.stored_bytes * 100 / s.logged % 100 : 0),
+                        (unsigned)s.worst_write_ms);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Take the oldest sample off the queue, logger thread only
+ * @param s set to the sample
+ * @return false if the queue is empty
+ */
+static bool queue_pop(sample_t * s)
+{
+    queue_cell_t * cell = &queue[dequeue_pos & QUEUE_MASK];
+    uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+    /* Claimed but not written yet, or nothing queued */
+    if(seq != dequeue_pos + 1) return false;
+
+    s->ch = cell->ch;
+    s->t_ms = cell->t_ms;
+    memcpy(&s->bits, &cell->value, sizeof(s->bits));
+
+    /* Free for the producer one lap ahead */
+    __atomic_store_n(&cell->seq, dequeue_pos + SESSION_LOG_QUEUE_LEN, __ATOMIC_RELEASE);
+    dequeue_pos++;
+    return true;
+}
+
+/**
+ * Encode the collected samples as columns and append them to the write buffer
+ */
+static void encode_block(void)
+{
+    uint16_t order[SESSION_LOG_BLOCK_SAMPLES];
+    uint32_t start[TELEM_CHANNEL_COUNT + 1];
+    session_log_block_header_t bh;
+    uint8_t * stored;
+    uint32_t prev_t;
+    uint32_t prev_bits;
+    uint32_t len = 0;
+    uint32_t ch;
+    uint32_t i;
+    const sample_t * s;
+
+    if(buf_len + BLOCK_MAX > SESSION_LOG_BUF_SIZE) write_buf();
+    if(buf_len == 0) buf_start = (uint32_t)(dash_clock_mono_us() / 1000);
+
+    /* Group the samples by channel, keeping their order */
+    memset(start, 0, sizeof(start));
+    for(i = 0; i < block_cnt; i++) start[block[i].ch + 1]++;
+    for(ch = 0; ch < TELEM_CHANNEL_COUNT; ch++) start[ch + 1] += start[ch];
+    for(i = 0; i < block_cnt; i++) order[start[block[i].ch]++] = (uint16_t)i;
+    /* start[ch] is now the end of the channel */
+
+    bh.t0_ms = block[0].t_ms;
+    i = 0;
+    for(ch = 0; ch < TELEM_CHANNEL_COUNT; ch++) {
+        len += put_varint(raw + len, start[ch] - i);
+        prev_t = bh.t0_ms;
+        prev_bits = 0;
+        for(; i < start[ch]; i++) {
+            s = &block[order[i]];
+            len += put_varint(raw + len, zigzag((int32_t)(s->t_ms - prev_t)));
+            len += put_varint(raw + len, zigzag((int32_t)(s->bits - prev_bits)));
+            prev_t = s->t_ms;
+            prev_bits = s->bits;
+        }
+    }
+
+    stored = buf + buf_len + sizeof(bh);
+    bh.flags = 0;
+    bh.stored_size = 0;
+#if DASH_LOG_LZ4
+    if(use_lz4) {
+        int n = LZ4_compress_default((const char *)raw, (char *)stored, (int)len, STORED_MAX);
+        /* Columns that do not shrink are stored as they are */
+        if(n > 0 && (uint32_t)n < len) {
+            bh.flags = SESSION_LOG_BLOCK_LZ4;
+            bh.stored_size = (uint32_t)n;
+        }
+    }
+#endif
+    if(bh.stored_size == 0) {
+        memcpy(stored, raw, len);
+        bh.stored_size = len;
+    }
+
+    bh.magic = SESSION_LOG_BLOCK_MAGIC;
+    bh.channel_cnt = TELEM_CHANNEL_COUNT;
+    bh.sample_cnt = block_cnt;
+    bh.raw_size = len;
+    bh.data_crc = crc32(stored, bh.stored_size);
+    bh.header_crc = crc32(&bh, offsetof(session_log_block_header_t, header_crc));
+    memcpy(buf + buf_len, &bh, sizeof(bh));
+    buf_len += (uint32_t)sizeof(bh) + bh.stored_size;
+
+    pthread_mutex_lock(&lock);
+    stats.logged += block_cnt;
+    stats.blocks++;
+    stats.raw_bytes += (uint64_t)block_cnt * 8;
+    stats.stored_bytes += sizeof(bh) + bh.stored_size;
+    pthread_mutex_unlock(&lock);
+
+    block_cnt = 0;
+}
+
+/**
+ * Append the write buffer to the segment, start a new segment once it is full.
+ * A short write is cut back to the last whole block.
+ */
+static void write_buf(void)
+{
+    uint32_t start = (uint32_t)(dash_clock_mono_us() / 1000);
+    uint32_t done = 0;
+    ssize_t n;
+
+    while(done < buf_len) {
+        n = write(seg_fd, buf + done, buf_len - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) {
+            /* Disk full or gone, the samples are lost but the dash keeps running */
+            fprintf(stderr, "session_log: write failed: %s\n", n < 0 ? strerror(errno) : "no space");
+            break;
+        }
+        done += (uint32_t)n;
+    }
+
+    /* The buffer holds whole blocks: cut a torn tail so the segment ends on the
+     * last block boundary, or start a new segment if its header is missing */
+    if(done < buf_len) {
+        if(seg_size == 0) {
+            seg_size = segment_limit;
+        }
+        else if(done > 0 && ftruncate(seg_fd, (off_t)seg_size) != 0) {
+            fprintf(stderr, "session_log: cannot truncate: %s\n", strerror(errno));
+            seg_size = segment_limit;
+        }
+        done = 0;
+    }
+
+    seg_size += done;
+    seg_unsynced = true;
+    buf_len = 0;
+
+    pthread_mutex_lock(&lock);
+    stats.worst_write_ms = LV_MAX(stats.worst_write_ms, (uint32_t)(dash_clock_mono_us() / 1000) - start);
+    pthread_mutex_unlock(&lock);
+
+    if(seg_size >= segment_limit) {
+        sync_segment();
+        close(seg_fd);
+        seg_fd = -1;
+        seg_index++;
+        if(open_segment() != 0) __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    }
+}
+
+static void sync_segment(void)
+{
+    uint32_t start = (uint32_t)(dash_clock_mono_us() / 1000);
+
+    if(fdatasync(seg_fd) != 0) fprintf(stderr, "session_log: fdatasync failed: %s\n", strerror(errno));
+    last_sync = (uint32_t)(dash_clock_mono_us() / 1000);
+    seg_unsynced = false;
+
+    pthread_mutex_lock(&lock);
+    stats.syncs++;
+    stats.worst_write_ms = LV_MAX(stats.worst_write_ms, last_sync - start);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Create the segment seg_index and put its header into the write buffer
+ * @return 0 on success, -1 if it cannot be created
+ */
+static int open_segment(void)
+{
+    session_log_seg_header_t sh;
+    struct timespec ts;
+    char path[PATH_MAX];
+    int dir_fd;
+
+    snprintf(path, sizeof(path), "%s/" SEG_NAME_FMT, log_dir, (unsigned)seg_index);
+    seg_fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    if(seg_fd < 0) {
+        fprintf(stderr, "session_log: cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* The new name survives a power loss */
+    dir_fd = open(log_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(&sh, 0, sizeof(sh));
+    memcpy(sh.magic, SESSION_LOG_SEG_MAGIC, sizeof(sh.magic));
+    sh.version = SESSION_LOG_VERSION;
+    sh.channel_cnt = TELEM_CHANNEL_COUNT;
+    sh.start_unix_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)(ts.tv_nsec / 1000000);
+    sh.start_mono_ms = (uint32_t)(dash_clock_mono_us() / 1000);
+    sh.header_crc = crc32(&sh, offsetof(session_log_seg_header_t, header_crc));
+
+    buf_start = (uint32_t)(dash_clock_mono_us() / 1000);
+    memcpy(buf, &sh, sizeof(sh));
+    buf_len = sizeof(sh);
+    seg_size = 0;
+
+    pthread_mutex_lock(&lock);
+    stats.segments++;
+    stats.stored_bytes += sizeof(sh);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/**
+ * Find the highest segment number in the log directory
+ * @param found set to false if there is no segment
+ * @return the number
+ */
+static uint32_t newest_segment(bool * found)
+{
+    struct dirent * de;
+    uint32_t newest = 0;
+    unsigned idx;
+    DIR * dir;
+
+    *found = false;
+    dir = opendir(log_dir);
+    if(dir == NULL) return 0;
+
+    while((de = readdir(dir)) != NULL) {
+        if(sscanf(de->d_name, SEG_NAME_FMT, &idx) == 1 && (!*found || idx > newest)) {
+            newest = idx;
+            *found = true;
+        }
+    }
+    closedir(dir);
+
+    return newest;
+}
+
+static uint32_t put_varint(uint8_t * p, uint32_t v)
+{
+    uint32_t n = 0;
+
+    while(v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static void crc_init(void)
+{
+    uint32_t i;
+    uint32_t k;
+    uint32_t c;
+
+    if(crc_table[1] != 0) return;
+
+    for(i = 0; i < 256; i++) {
+        c = i;
+        for(k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(const void * data, size_t len)
+{
+    const uint8_t * p = data;
+    uint32_t c = 0xFFFFFFFFu;
+
+    while(len--) c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file session_log.h
+ *
+ * On-car logger of every telemetry sample.
+ *
+ * telemetry_publish() pushes each sample into a bounded lock-free queue,
+ * a push never blocks and never makes a system call. A full queue drops
+ * the sample and counts it. The logger thread drains the queue every
+ * SESSION_LOG_DRAIN_MS and collects up to SESSION_LOG_BLOCK_SAMPLES
+ * samples into a block.
+ *
+ * A block stores one column per channel: the number of samples, then for
+ * each sample the time and the bits of the value as zigzag varint deltas
+ * to the previous sample of the channel. The column data is optionally
+ * LZ4 compressed. Blocks are appended to a buffer of SESSION_LOG_BUF_SIZE
+ * bytes, aligned for the block device, which is written out when it is
+ * full or SESSION_LOG_WRITE_MS after its first block. fdatasync() runs
+ * every DASH_LOG_SYNC_S.
+ *
+ * Segment file layout, host byte order:
+ * - session_log_seg_header_t
+ * - session_log_block_header_t followed by stored_size bytes, repeated
+ *
+ * Both headers and the block data carry a CRC-32 (zlib polynomial). A
+ * crash leaves a partial block at the end of the newest segment,
+ * session_log_recover() cuts the segment back to its last intact block
+ * and runs on that segment at startup. scripts/session_dump.py decodes
+ * segments.
+ *
+ * Environment:
+ * - DASH_LOG_DIR         directory of the segments, no logging if unset
+ * - DASH_LOG_SEGMENT_MB  size at which a new segment is started (default 64)
+ * - DASH_LOG_SYNC_S      seconds between fdatasync() calls (default 5)
+ * - DASH_LOG_LZ4         compress the blocks when built with LZ4 (default 1)
+ */
+
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "telemetry.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define SESSION_LOG_SEG_MAGIC   "DASHSEG1"
+#define SESSION_LOG_BLOCK_MAGIC 0x4B4C4244u   /* "DBLK" */
+#define SESSION_LOG_VERSION     1
+
+/* Block flags */
+#define SESSION_LOG_BLOCK_LZ4 0x0001u
+
+/* Entries of the sample queue, a power of two */
+#define SESSION_LOG_QUEUE_LEN 16384
+
+#define SESSION_LOG_BLOCK_SAMPLES 4096
+#define SESSION_LOG_BUF_SIZE      (256 * 1024)
+#define SESSION_LOG_BUF_ALIGN     4096
+
+#define SESSION_LOG_DRAIN_MS  10
+#define SESSION_LOG_WRITE_MS  1000
+#define SESSION_LOG_REPORT_MS 10000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t channel_cnt;
+    uint64_t start_unix_ms;     /* wall time when the segment was started */
+    uint32_t start_mono_ms;     /* the same moment on the clock of the samples */
+    uint32_t header_crc;        /* of the bytes before it */
+} session_log_seg_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t flags;
+    uint16_t channel_cnt;
+    uint32_t sample_cnt;
+    uint32_t raw_size;          /* column data before compression */
+    uint32_t stored_size;       /* bytes following the header */
+    uint32_t t0_ms;             /* time the first delta of each column is taken to */
+    uint32_t data_crc;          /* of the stored bytes */
+    uint32_t header_crc;        /* of the bytes before it */
+} session_log_block_header_t;
+
+typedef struct {
+    uint32_t pushed;            /* samples queued */
+    uint32_t dropped;           /* samples lost to a full queue */
+    uint32_t logged;            /* samples written to a segment */
+    uint32_t blocks;
+    uint64_t raw_bytes;         /* 8 bytes per sample of time and value */
+    uint64_t stored_bytes;      /* headers included */
+    uint32_t syncs;
+    uint32_t worst_write_ms;    /* longest write() or fdatasync() */
+    uint32_t segments;
+} session_log_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Recover the newest segment and start the logger thread if DASH_LOG_DIR is set
+ * @return 0 if the logger runs or none is configured, -1 if it could not be started
+ */
+int session_log_init(void);
+
+/**
+ * Queue a sample, lock-free, from any thread
+ * @param ch the channel
+ * @param value the value
+ * @param t_ms time of the sample, CLOCK_MONOTONIC
+ */
+void session_log_push(telem_channel_t ch, float value, uint32_t t_ms);
+
+/**
+ * Cut a segment back to its last intact block
+ * @param path the segment
+ * @param blocks set to the number of intact blocks, can be NULL
+ * @return bytes cut off, 0 if the segment was intact, -1 if it could not be read
+ */
+long session_log_recover(const char * path, uint32_t * blocks);
+
+/**
+ * Get the statistics of the logger
+ * @param stats filled with the statistics
+ */
+void session_log_get_stats(session_log_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*SESSION_LOG_H*/
@@ -0,0 +1,333 @@
+/**
+ * @file signal_cond.c
+ *
+ * Filtering, deadband, hysteresis and hold of telemetry channels
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "signal_cond.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Channels are processed as lanes of fixed size arrays, padded for the vector width */
+#define LANES 16
+
+/* A longer step after an idle period would let the average jump to the new sample */
+#define MAX_DT_MS (2 * SIGNAL_COND_TICK_MS)
+
+#define REPORT_PERIOD_MS 5000
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void tick(uint32_t fresh_mask, uint32_t now, float dt);
+static bool is_busy(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/* Configuration, an unconfigured lane passes its input through */
+static float tau_ms[LANES];
+static float deadband[LANES];
+static float hysteresis[LANES];
+static float settle_eps[LANES];
+static int32_t median_on[LANES];
+static uint32_t hold_ms[LANES];
+static float thresholds[SIGNAL_COND_MAX_THRESHOLDS][LANES]; /* FLT_MAX when unused */
+
+/* State */
+static float hist[3][LANES];
+static float filt[LANES];
+static float out[LANES];
+static int32_t above[SIGNAL_COND_MAX_THRESHOLDS][LANES];
+static int32_t plain_level[LANES];  /* level without hysteresis, for the counters */
+static int32_t level[LANES];
+static int32_t cand[LANES];
+static uint32_t since[LANES];
+static int32_t seeded[LANES];
+static int32_t busy[LANES];         /* filter settling or level held */
+
+static uint32_t cond_mask;
+static uint32_t fresh_pending;
+static uint32_t last_tick;
+static uint32_t last_report;
+static signal_cond_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int signal_cond_init(const signal_cond_cfg_t * cfg, uint32_t cnt)
+{
+    uint32_t i, k;
+
+    LV_ASSERT(TELEM_CHANNEL_COUNT <= LANES);
+
+    for(i = 0; i < LANES; i++) {
+        tau_ms[i] = 0.0f;
+        deadband[i] = 0.0f;
+        hysteresis[i] = 0.0f;
+        settle_eps[i] = 0.001f;
+        median_on[i] = 0;
+        hold_ms[i] = 0;
+        for(k = 0; k < SIGNAL_COND_MAX_THRESHOLDS; k++) thresholds[k][i] = FLT_MAX;
+    }
+    cond_mask = 0;
+
+    for(i = 0; i < cnt; i++) {
+        const signal_cond_cfg_t * c = &cfg[i];
+        uint32_t ch = c->ch;
+
+        if(ch >= TELEM_CHANNEL_COUNT || (cond_mask & TELEM_MASK(ch)) ||
+           c->threshold_cnt > SIGNAL_COND_MAX_THRESHOLDS ||
+           c->tau_ms < 0.0f || c->deadband < 0.0f || c->hysteresis < 0.0f) {
+            fprintf(stderr, "signal_cond: invalid entry %u\n", (unsigned)i);
+            return -1;
+        }
+        for(k = 1; k < c->threshold_cnt; k++) {
+            if(c->thresholds[k] <= c->thresholds[k - 1]) {
+                fprintf(stderr, "signal_cond: thresholds of entry %u not ascending\n", (unsigned)i);
+                return -1;
+            }
+        }
+
+        tau_ms[ch] = c->tau_ms;
+        deadband[ch] = c->deadband;
+        hysteresis[ch] = c->hysteresis;
+        settle_eps[ch] = c->deadband * 0.25f + 0.001f;
+        median_on[ch] = c->median;
+        hold_ms[ch] = c->hold_ms;
+        for(k = 0; k < c->threshold_cnt; k++) thresholds[k][ch] = c->thresholds[k];
+        cond_mask |= TELEM_MASK(ch);
+    }
+
+    /* The first sample of every lane initializes its state */
+    for(i = 0; i < LANES; i++) {
+        seeded[i] = 0;
+        busy[i] = 0;
+        level[i] = 0;
+        cand[i] = 0;
+        plain_level[i] = 0;
+        for(k = 0; k < SIGNAL_COND_MAX_THRESHOLDS; k++) above[k][i] = 0;
+    }
+
+    fresh_pending = 0;
+    last_tick = lv_tick_get();
+    last_report = last_tick;
+    return 0;
+}
+
+uint32_t signal_cond_run(uint32_t dirty)
+{
+    uint32_t changed = dirty & ~cond_mask;
+    uint32_t elaps;
+    uint32_t cond_changed;
+    uint32_t i;
+    float prev_out[LANES];
+    int32_t prev_level[LANES];
+
+    fresh_pending |= dirty & cond_mask;
+
+    if(fresh_pending == 0 && !is_busy()) {
+        /* Idle, start the next tick from here */
+        last_tick = lv_tick_get();
+        return changed;
+    }
+
+    elaps = lv_tick_elaps(last_tick);
+    if(elaps < SIGNAL_COND_TICK_MS) return changed;
+    last_tick = lv_tick_get();
+
+    for(i = 0; i < LANES; i++) {
+        prev_out[i] = out[i];
+        prev_level[i] = level[i];
+    }
+
+    tick(fresh_pending, last_tick, (float)LV_MIN(elaps, MAX_DT_MS));
+
+    cond_changed = 0;
+    for(i = 0; i < TELEM_CHANNEL_COUNT; i++) {
+        if(!(cond_mask & TELEM_MASK(i))) continue;
+
+        if(out[i] != prev_out[i] || level[i] != prev_level[i]) {
+            cond_changed |= TELEM_MASK(i);
+            stats.changes++;
+        }
+        else if(fresh_pending & TELEM_MASK(i)) {
+            stats.samples_absorbed++;
+        }
+    }
+
+    stats.ticks++;
+    fresh_pending = 0;
+
+    if(lv_tick_elaps(last_report) >= REPORT_PERIOD_MS) {
+        last_report = lv_tick_get();
+        LV_LOG_USER("signal_cond: %u ticks, %u changes, %u samples absorbed, %u level flips avoided",
+                    (unsigned)stats.ticks, (unsigned)stats.changes,
+                    (unsigned)stats.samples_absorbed, (unsigned)stats.flips_avoided);
+    }
+
+    return changed | cond_changed;
+}
+
+float signal_cond_get(telem_channel_t ch)
+{
+    if(ch < TELEM_CHANNEL_COUNT && (cond_mask & TELEM_MASK(ch)) && seeded[ch]) return out[ch];
+    return telemetry_get(ch).value;
+}
+
+uint32_t signal_cond_get_level(telem_channel_t ch)
+{
+    if(ch >= TELEM_CHANNEL_COUNT) return 0;
+    return (uint32_t)level[ch];
+}
+
+uint32_t signal_cond_next_ms(void)
+{
+    uint32_t elaps;
+
+    if(fresh_pending == 0 && !is_busy()) return LV_NO_TIMER_READY;
+
+    elaps = lv_tick_elaps(last_tick);
+    return elaps >= SIGNAL_COND_TICK_MS ? 0 : SIGNAL_COND_TICK_MS - elaps;
+}
+
+void signal_cond_get_stats(signal_cond_stats_t * out_stats)
+{
+    *out_stats = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Advance every lane by one step. The loops have no data dependent branches,
+ * conditions are computed as 0/1 and applied by selects, so they vectorize.
+ * @param fresh_mask TELEM_MASK() of the channels with new samples since the previous step
+ * @param now the time of the step
+ * @param dt the time since the previous step, ms
+ */
+static void tick(uint32_t fresh_mask, uint32_t now, float dt)
+{
+    float raw[LANES] = {0};
+    int32_t fresh[LANES];
+    int32_t first[LANES];
+    int32_t raw_level[LANES];
+    int32_t plain[LANES];
+    float lo[LANES];
+    float hi[LANES];
+    uint32_t flips = 0;
+    uint32_t i, k;
+
+    telemetry_get_values(raw);
+
+    for(i = 0; i < LANES; i++) fresh[i] = (fresh_mask >> i) & 1;
+
+    /* A lane's first sample is taken as is */
+    for(i = 0; i < LANES; i++) {
+        first[i] = fresh[i] & !seeded[i];
+        hist[0][i] = first[i] ? raw[i] : hist[0][i];
+        hist[1][i] = first[i] ? raw[i] : hist[1][i];
+        hist[2][i] = first[i] ? raw[i] : hist[2][i];
+        filt[i] = first[i] ? raw[i] : filt[i];
+        out[i] = first[i] ? raw[i] : out[i];
+        seeded[i] |= fresh[i];
+    }
+
+    /* Median of 3, then the moving average. It runs on every step until settled,
+     * the last input is held between samples. */
+    for(i = 0; i < LANES; i++) {
+        float a, b, c, x, alpha;
+
+        hist[0][i] = fresh[i] ? hist[1][i] : hist[0][i];
+        hist[1][i] = fresh[i] ? hist[2][i] : hist[1][i];
+        hist[2][i] = fresh[i] ? raw[i] : hist[2][i];
+
+        a = hist[0][i];
+        b = hist[1][i];
+        c = hist[2][i];
+        x = median_on[i] ? fmaxf(fminf(a, b), fminf(fmaxf(a, b), c)) : c;
+
+        alpha = dt / (tau_ms[i] + dt);
+        filt[i] += alpha * (x - filt[i]);
+        busy[i] = fabsf(x - filt[i]) > settle_eps[i];
+        filt[i] = busy[i] ? filt[i] : x;
+    }
+
+    /* Thresholds with hysteresis */
+    for(i = 0; i < LANES; i++) {
+        raw_level[i] = 0;
+        plain[i] = 0;
+    }
+    for(k = 0; k < SIGNAL_COND_MAX_THRESHOLDS; k++) {
+        for(i = 0; i < LANES; i++) {
+            float th = thresholds[k][i];
+            float f = filt[i];
+            int32_t hyst = (f > th + hysteresis[i]) | (above[k][i] & (f >= th - hysteresis[i]));
+            above[k][i] = first[i] ? (f > th) : hyst;
+            raw_level[i] += above[k][i];
+            plain[i] += f > th;
+        }
+    }
+
+    /* A new level is committed after persisting for the hold time, the first one at once */
+    for(i = 0; i < LANES; i++) {
+        int32_t differ = raw_level[i] != level[i];
+        int32_t was_held = cand[i] != level[i];
+        int32_t restart = differ & (raw_level[i] != cand[i]);
+        int32_t commit;
+        int32_t move;
+
+        since[i] = restart ? now : since[i];
+        cand[i] = differ ? raw_level[i] : level[i];
+        commit = differ & (((now - since[i]) >= hold_ms[i]) | first[i]);
+        level[i] = commit ? raw_level[i] : level[i];
+        busy[i] |= cand[i] != level[i];
+
+        /* Crossings swallowed by the hysteresis, and held levels that went back */
+        flips += (uint32_t)((plain[i] != plain_level[i]) & (raw_level[i] == level[i]) & !commit) +
+                 (uint32_t)(was_held & !differ);
+        plain_level[i] = plain[i];
+
+        /* The output follows the filter past the deadband and on a new level */
+        move = (fabsf(filt[i] - out[i]) > deadband[i]) | commit;
+        out[i] = move ? filt[i] : out[i];
+    }
+
+    /* The output stays in the band of its level, so the value and the color agree */
+    for(i = 0; i < LANES; i++) {
+        lo[i] = -FLT_MAX;
+        hi[i] = FLT_MAX;
+    }
+    for(k = 0; k < SIGNAL_COND_MAX_THRESHOLDS; k++) {
+        for(i = 0; i < LANES; i++) {
+            float th = thresholds[k][i];
+            lo[i] = level[i] > (int32_t)k ? fmaxf(lo[i], th) : lo[i];
+            hi[i] = level[i] <= (int32_t)k ? fminf(hi[i], th) : hi[i];
+        }
+    }
+    for(i = 0; i < LANES; i++) out[i] = fminf(fmaxf(out[i], lo[i]), hi[i]);
+
+    stats.flips_avoided += flips;
+}
+
+static bool is_busy(void)
+{
+    uint32_t i;
+    int32_t any = 0;
+
+    for(i = 0; i < TELEM_CHANNEL_COUNT; i++) any |= busy[i] & seeded[i];
+    return any != 0;
+}
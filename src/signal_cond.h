@@ -0,0 +1,120 @@
+/**
+ * @file signal_cond.h
+ *
+ * Conditioning of noisy telemetry before it reaches the widgets.
+ *
+ * Every configured channel goes through, in this order:
+ * - an optional median of its last 3 samples, against single sample spikes
+ * - an exponential moving average with a time constant
+ * - a deadband: the output only follows the filter once it moved further
+ * - thresholds with hysteresis, splitting the range into levels, e.g. the
+ *   color bands of a tire. A new level is taken after it persisted for the
+ *   hold time, and the output stays inside the band of the current level.
+ *
+ * A channel is reported as changed only when its output value or level
+ * changed, so a value sitting on a threshold no longer flips its widget on
+ * every sample. All channels are processed together by branch free loops
+ * over arrays, at SIGNAL_COND_TICK_MS. Channels that are not configured
+ * pass through unchanged.
+ */
+
+#ifndef SIGNAL_COND_H
+#define SIGNAL_COND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+#include "telemetry.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define SIGNAL_COND_MAX_THRESHOLDS 4
+#define SIGNAL_COND_TICK_MS        50
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    telem_channel_t ch;
+    bool median;            /* median of the last 3 samples before the average */
+    float tau_ms;           /* time constant of the average, 0 for none */
+    float deadband;         /* smallest change passed to the output */
+    float hysteresis;       /* margin on both sides of every threshold */
+    uint32_t hold_ms;       /* time a new level must persist */
+    uint32_t threshold_cnt;
+    float thresholds[SIGNAL_COND_MAX_THRESHOLDS]; /* ascending */
+} signal_cond_cfg_t;
+
+typedef struct {
+    uint32_t ticks;
+    uint32_t changes;           /* outputs that changed, each one a redraw */
+    uint32_t samples_absorbed;  /* new samples that left the output unchanged */
+    uint32_t flips_avoided;     /* raw threshold crossings that did not change the level */
+} signal_cond_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Configure the channels
+ * @param cfg one entry per conditioned channel, copied
+ * @param cnt number of entries
+ * @return 0 on success, -1 if an entry is invalid
+ */
+int signal_cond_init(const signal_cond_cfg_t * cfg, uint32_t cnt);
+
+/**
+ * Condition the channels if a tick is due, UI thread only
+ * @param dirty TELEM_MASK() of the channels with new samples
+ * @return the channels to redraw: the dirty ones that are not conditioned,
+ *         and the conditioned ones whose output or level changed
+ */
+uint32_t signal_cond_run(uint32_t dirty);
+
+/**
+ * Get the conditioned value of a channel
+ * @param ch the channel
+ * @return the output, or the latest sample of a channel that is not conditioned
+ */
+float signal_cond_get(telem_channel_t ch);
+
+/**
+ * Get the level of a channel
+ * @param ch the channel
+ * @return the number of thresholds the output is above
+ */
+uint32_t signal_cond_get_level(telem_channel_t ch);
+
+/**
+ * Get the time until the next tick is needed
+ * @return milliseconds while a filter settles or a level is held, LV_NO_TIMER_READY otherwise
+ */
+uint32_t signal_cond_next_ms(void);
+
+/**
+ * Get the counters
+ * @param stats filled with the counters
+ */
+void signal_cond_get_stats(signal_cond_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*SIGNAL_COND_H*/
@@ -0,0 +1,217 @@
+/**
+ * @file slogan_rotation.c
+ *
+ * Slogan rotation state journal
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "slogan_rotation.h"
+#include "dash_calc.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define RECORD_MAGIC 0x4A474C53u /* "SLGJ" */
+/* Whole words, so the record has no padding */
+#define BITMAP_BYTES ((SLOGAN_COUNT + 31) / 32 * 4)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t table_hash;
+    uint8_t used[BITMAP_BYTES];
+    uint32_t crc; /* CRC-32 of everything above */
+} journal_record_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static const char * journal_path(void);
+static void load_record(void);
+static void * commit_thread(void * arg);
+static int write_all(int fd, const void * buf, size_t len);
+static uint32_t crc32(const void * data, size_t len);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static char path_buf[256];
+static journal_record_t record;
+static off_t journal_size;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int slogan_rotation_pick(void)
+{
+    int i;
+
+    load_record();
+    i = dash_calc_pick_unused(record.used, SLOGAN_COUNT, rand());
+    if(i < 0) {
+        /* Every slogan was shown, start over */
+        memset(record.used, 0, sizeof(record.used));
+        i = dash_calc_pick_unused(record.used, SLOGAN_COUNT, rand());
+    }
+    return i;
+}
+
+void slogan_rotation_commit(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    record.magic = RECORD_MAGIC;
+    record.seq++;
+    record.table_hash = SLOGAN_TABLE_HASH;
+    record.crc = crc32(&record, offsetof(journal_record_t, crc));
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if(pthread_create(&thread, &attr, commit_thread, NULL) != 0) {
+        fprintf(stderr, "slogan: could not start the journal writer\n");
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static const char * journal_path(void)
+{
+    const char * env = getenv("SLOGAN_JOURNAL");
+    const char * dir;
+    size_t len;
+
+    if(env != NULL && env[0] != '\0') return env;
+
+    /* StateDirectory= may list several directories separated by colons */
+    dir = getenv("STATE_DIRECTORY");
+    if(dir == NULL || dir[0] == '\0') return SLOGAN_JOURNAL_DEFAULT;
+
+    len = strcspn(dir, ":");
+    snprintf(path_buf, sizeof(path_buf), "%.*s/slogan.journal", (int)len, dir);
+    return path_buf;
+}
+
+/**
+ * Read the journal in one go and keep its last valid record
+ */
+static void load_record(void)
+{
+    journal_record_t recs[SLOGAN_JOURNAL_MAX_RECORDS];
+    ssize_t len;
+    int fd;
+    int i;
+
+    memset(&record, 0, sizeof(record));
+
+    fd = open(journal_path(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return;
+    len = read(fd, recs, sizeof(recs));
+    close(fd);
+    if(len <= 0) return;
+
+    journal_size = len;
+    for(i = (int)(len / (ssize_t)sizeof(journal_record_t)) - 1; i >= 0; i--) {
+        const journal_record_t * r = &recs[i];
+        if(r->magic != RECORD_MAGIC || r->crc != crc32(r, offsetof(journal_record_t, crc))) continue;
+
+        /* A different table means different slogans, start the rotation over */
+        if(r->table_hash == SLOGAN_TABLE_HASH) memcpy(record.used, r->used, sizeof(record.used));
+        record.seq = r->seq;
+        return;
+    }
+}
+
+static void * commit_thread(void * arg)
+{
+    const char * path = journal_path();
+    char tmp_path[512];
+    journal_record_t rec = record;
+    off_t whole = journal_size - journal_size % (off_t)sizeof(rec);
+    int fd;
+
+    (void)arg;
+
+    if(whole + (off_t)sizeof(rec) <= (off_t)(SLOGAN_JOURNAL_MAX_RECORDS * sizeof(rec))) {
+        /* Common case: one small append */
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        /* Cut a record torn by a power loss, or every later one would be misaligned */
+        if(fd >= 0 && whole != journal_size && ftruncate(fd, whole) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        if(fd >= 0) {
+            if(write_all(fd, &rec, sizeof(rec)) != 0 || fdatasync(fd) != 0) {
+                fprintf(stderr, "slogan: could not append to %s\n", path);
+            }
+            close(fd);
+            return NULL;
+        }
+    }
+
+    /* Journal full, unreadable or not truncatable: replace it with a single record */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        fprintf(stderr, "slogan: could not create %s\n", tmp_path);
+        return NULL;
+    }
+    if(write_all(fd, &rec, sizeof(rec)) != 0 || fdatasync(fd) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "slogan: could not compact %s\n", path);
+        unlink(tmp_path);
+    }
+    close(fd);
+
+    return NULL;
+}
+
+static int write_all(int fd, const void * buf, size_t len)
+{
+    const uint8_t * p = buf;
+
+    while(len > 0) {
+        ssize_t n = write(fd, p, len);
+        if(n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static uint32_t crc32(const void * data, size_t len)
+{
+    const uint8_t * p = data;
+    uint32_t crc = 0xFFFFFFFFu;
+    int k;
+
+    while(len--) {
+        crc ^= *p++;
+        for(k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+
+    return ~crc;
+}
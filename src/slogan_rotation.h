@@ -0,0 +1,60 @@
+/**
+ * @file slogan_rotation.h
+ *
+ * Picks the slogan of the logo screen so that every slogan is shown once
+ * before any repeats.
+ *
+ * The slogans are a constant table generated at build time, see
+ * scripts/gen_slogans.py. The shown slogans are kept as a bitmap in a small
+ * append-only journal: every boot appends one checksummed record, and the
+ * file is compacted to a single record once it holds
+ * SLOGAN_JOURNAL_MAX_RECORDS. A torn last record is skipped on load.
+ *
+ * The journal is $SLOGAN_JOURNAL, or slogan.journal in $STATE_DIRECTORY
+ * (set by systemd's StateDirectory=), or SLOGAN_JOURNAL_DEFAULT.
+ */
+
+#ifndef SLOGAN_ROTATION_H
+#define SLOGAN_ROTATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "slogans_table.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define SLOGAN_JOURNAL_DEFAULT "/var/lib/oem-dashboard/slogan.journal"
+#define SLOGAN_JOURNAL_MAX_RECORDS 32
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Load the rotation state and pick a slogan that was not shown yet
+ * @return an index into slogan_table
+ */
+int slogan_rotation_pick(void);
+
+/**
+ * Save the rotation state with the picked slogan marked as shown, in the
+ * background. Call it once the dash is up, it never blocks the caller.
+ */
+void slogan_rotation_commit(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*SLOGAN_ROTATION_H*/
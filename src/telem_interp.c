@@ -0,0 +1,166 @@
+/**
+ * @file telem_interp.c
+ *
+ * Interpolation of telemetry channels at frame time
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "telem_interp.h"
+#include "view_lifecycle.h"
+#include "dash_clock.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    telem_channel_t ch;
+    telem_interp_quantize_cb_t quantize;
+    int view;
+    float value;    /* shown value */
+    int32_t drawn;  /* quantized shown value */
+    bool moving;    /* not at the latest sample yet */
+} interp_entry_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static float interpolate(interp_entry_t * e, uint32_t now);
+static bool is_visible(const interp_entry_t * e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static interp_entry_t entries[TELEM_CHANNEL_COUNT];
+static uint32_t entry_cnt;
+static interp_entry_t * entry_of[TELEM_CHANNEL_COUNT];
+static uint32_t interp_mask;
+static telem_interp_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int telem_interp_add(telem_channel_t ch, telem_interp_quantize_cb_t quantize, int view)
+{
+    interp_entry_t * e;
+
+    LV_ASSERT_NULL(quantize);
+
+    if(ch >= TELEM_CHANNEL_COUNT || entry_of[ch] != NULL) return -1;
+
+    e = &entries[entry_cnt++];
+    e->ch = ch;
+    e->quantize = quantize;
+    e->view = view;
+    e->value = telemetry_get(ch).value;
+    e->drawn = quantize(e->value);
+    e->moving = false;
+
+    entry_of[ch] = e;
+    interp_mask |= TELEM_MASK(ch);
+    return 0;
+}
+
+uint32_t telem_interp_run(uint32_t dirty)
+{
+    uint32_t changed = dirty & ~interp_mask;
+    uint32_t now = dash_clock_now_ms();
+    uint32_t i;
+    int32_t q;
+
+    for(i = 0; i < entry_cnt; i++) {
+        interp_entry_t * e = &entries[i];
+        bool fresh = (dirty & TELEM_MASK(e->ch)) != 0;
+
+        if(!fresh && !e->moving) continue;
+
+        if(!is_visible(e)) {
+            /* Nothing to animate, the widget is up to date when its view is shown */
+            if(fresh) {
+                e->value = telemetry_get(e->ch).value;
+                e->drawn = e->quantize(e->value);
+                changed |= TELEM_MASK(e->ch);
+            }
+            e->moving = false;
+            continue;
+        }
+
+        e->value = interpolate(e, now);
+        stats.evaluated++;
+
+        q = e->quantize(e->value);
+        if(q == e->drawn) continue;
+
+        e->drawn = q;
+        changed |= TELEM_MASK(e->ch);
+        stats.changed++;
+    }
+
+    return changed;
+}
+
+float telem_interp_get(telem_channel_t ch)
+{
+    if(ch < TELEM_CHANNEL_COUNT && entry_of[ch] != NULL) return entry_of[ch]->value;
+    return telemetry_get(ch).value;
+}
+
+uint32_t telem_interp_next_ms(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < entry_cnt; i++) {
+        if(entries[i].moving) return LV_DEF_REFR_PERIOD;
+    }
+
+    return LV_NO_TIMER_READY;
+}
+
+void telem_interp_get_stats(telem_interp_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Get the value of a channel at a time, one sample interval behind the stream:
+ * the previous sample when the latest one arrives, the latest one an interval later
+ * @param e the channel
+ * @param now the frame time, dash_clock.h ms like the sample timestamps
+ * @return the value
+ */
+static float interpolate(interp_entry_t * e, uint32_t now)
+{
+    telem_sample_t prev, last;
+    uint32_t interval;
+    uint32_t elapsed;
+
+    telemetry_get_history(e->ch, &prev, &last);
+
+    interval = last.timestamp_ms - prev.timestamp_ms;
+    elapsed = now - last.timestamp_ms;
+    /* Published by another thread after the frame time was taken */
+    if((int32_t)elapsed < 0) elapsed = 0;
+
+    if(prev.timestamp_ms == 0 || interval == 0 || interval > TELEM_INTERP_MAX_GAP_MS ||
+       elapsed >= interval || prev.value == last.value) {
+        e->moving = false;
+        return last.value;
+    }
+
+    e->moving = true;
+    return prev.value + (last.value - prev.value) * (float)elapsed / (float)interval;
+}
+
+static bool is_visible(const interp_entry_t * e)
+{
+    return e->view < 0 || view_lifecycle_is_visible(e->view);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file telem_interp.h
+ *
+ * Frame rate interpolation of low rate telemetry.
+ *
+ * Channels like the speed arrive at 10-20 Hz while the panel refreshes at
+ * 60 Hz. For a registered channel the value shown is interpolated between
+ * its two latest samples at the time of the frame, one sample interval
+ * behind the stream, so it moves continuously instead of stepping.
+ *
+ * The interpolated value is quantized the way its widget draws it, and the
+ * channel is only reported as changed when the quantized value changes.
+ * Only channels still moving towards their latest sample and belonging to
+ * a visible view are evaluated.
+ */
+
+#ifndef TELEM_INTERP_H
+#define TELEM_INTERP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+#include "telemetry.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Samples further apart than this are a gap in the stream, the new value is shown at once */
+#define TELEM_INTERP_MAX_GAP_MS 250
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Maps a value to what its widget draws, e.g. the integer of a label */
+typedef int32_t (*telem_interp_quantize_cb_t)(float value);
+
+typedef struct {
+    uint32_t evaluated;  /* channel interpolations */
+    uint32_t changed;    /* evaluations that changed the quantized value */
+} telem_interp_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Interpolate a channel
+ * @param ch the channel
+ * @param quantize maps the value to what is drawn
+ * @param view the view_lifecycle id of the widget, -1 if always visible
+ * @return 0 on success, -1 if the channel is already interpolated
+ */
+int telem_interp_add(telem_channel_t ch, telem_interp_quantize_cb_t quantize, int view);
+
+/**
+ * Interpolate the channels for the coming frame, UI thread only
+ * @param dirty TELEM_MASK() of the channels with new samples, from telemetry_take_dirty()
+ * @return the channels to redraw: the dirty ones that are not interpolated,
+ *         and the interpolated ones whose quantized value changed
+ */
+uint32_t telem_interp_run(uint32_t dirty);
+
+/**
+ * Get the value to show
+ * @param ch the channel
+ * @return the interpolated value, or the latest sample of a channel that is not interpolated
+ */
+float telem_interp_get(telem_channel_t ch);
+
+/**
+ * Get the time until the channels must be evaluated again
+ * @return a frame period while a channel is moving, LV_NO_TIMER_READY otherwise
+ */
+uint32_t telem_interp_next_ms(void);
+
+/**
+ * Get the counters
+ * @param stats filled with the counters
+ */
+void telem_interp_get_stats(telem_interp_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*TELEM_INTERP_H*/
@@ -0,0 +1,444 @@
+/**
+ * @file telem_synth.c
+ *
+ * Lap simulation feeding synthetic telemetry
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl/lvgl.h"
+#include "telem_synth.h"
+#include "dash_clock.h"
+#include "telemetry.h"
+#include "fault.h"
+#include "rt_threads.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Car */
+#define MASS_KG        290.0f
+#define MU             1.5f     /* tire grip */
+#define G              9.81f
+#define POWER_W        80000.0f
+#define V_TOP          33.0f    /* m/s */
+#define DRAG_N_PER_V2  0.6f     /* aero drag, N per (m/s)^2 */
+#define ROLL_N         120.0f
+#define DRIVE_EFF      0.90f
+#define REGEN_EFF      0.45f
+#define AUX_W          400.0f
+
+/* Pack */
+#define PACK_J         (7.0f * 3.6e6f)  /* 7 kWh */
+#define PACK_OCV_MIN   330.0f
+#define PACK_OCV_SPAN  70.0f
+#define PACK_R_OHM     0.15f
+#define PACK_HEAT_CAP  30000.0f         /* J/K */
+#define PACK_COOL_W_K  60.0f
+#define PACK_OVER_C    60.0f
+#define PACK_EMPTY     0.03f
+
+/* Tires */
+#define TIRE_SLIP      0.10f    /* share of the tire work that heats it */
+#define TIRE_HEAT_CAP  8000.0f  /* J/K */
+#define TIRE_COOL_W_K  10.0f
+#define AMBIENT_C      25.0f
+
+/* Random faults */
+#define FAULT_HOLD_MIN_MS 2000
+#define FAULT_HOLD_MAX_MS 5000
+
+/* Steps of the generator thread are batched to at least this period */
+#define MIN_PERIOD_NS 1000000L
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int load_track(const char * name);
+static int build_profile(void);
+static void * synth_main(void * arg);
+static void step(float dt, uint32_t t_ms);
+static float drive_force_max(float v);
+static float profile_at(float s);
+static float curvature_at(float s);
+static float frand(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const telem_synth_segment_t track_endurance[] = {
+    {180, 0}, {30, 12}, {60, 0}, {25, -9}, {25, 9}, {25, -9}, {120, 0}, {45, -20},
+    {90, 0}, {20, 6}, {40, 0}, {60, 35}, {150, 0}, {35, -15}, {50, 0}, {40, 10},
+};
+static const telem_synth_segment_t track_autocross[] = {
+    {60, 0}, {15, 8}, {15, -8}, {15, 8}, {15, -8}, {40, 0}, {28, 9}, {30, 0},
+    {22, -7}, {50, 0}, {20, 10}, {20, -10}, {35, 0}, {32, 12},
+};
+static const telem_synth_segment_t track_skidpad[] = {
+    {57.2f, 9.1f}, {57.2f, 9.1f}, {57.2f, -9.1f}, {57.2f, -9.1f},
+};
+
+static telem_synth_segment_t segments[TELEM_SYNTH_MAX_SEGMENTS];
+static uint32_t segment_cnt;
+
+/* Speed profile and curvature, one point per meter */
+static float * profile;
+static float * curvature;
+static uint32_t lap_m;
+
+static uint32_t rate_hz;
+static float fault_mean_s;
+static uint32_t rng_state;
+
+/* State of the car, generator thread only */
+static float pos_m;
+static float speed;
+static float pace;
+static float soc;
+static float pack_c;
+static float tire_c[4];
+static uint32_t lap_start_ms;
+static uint32_t fault_word;
+static uint32_t fault_until_ms;
+static uint32_t last_slow_ms;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static telem_synth_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int telem_synth_init(void)
+{
+    uint32_t i;
+
+    if(atoi(getenv_default("DASH_SYNTH", "0")) == 0) return 0;
+
+    rate_hz = (uint32_t)LV_CLAMP(1, atoi(getenv_default("DASH_SYNTH_RATE_HZ", "100")), TELEM_SYNTH_MAX_RATE_HZ);
+    fault_mean_s = (float)atof(getenv_default("DASH_SYNTH_FAULT_S", "120"));
+    rng_state = (uint32_t)strtoul(getenv_default("DASH_SYNTH_SEED", "1"), NULL, 10) | 1;
+
+    if(load_track(getenv_default("DASH_SYNTH_TRACK", "endurance")) != 0) return -1;
+    if(build_profile() != 0) return -1;
+
+    pace = 0.97f;
+    soc = 1.0f;
+    pack_c = AMBIENT_C;
+    for(i = 0; i < 4; i++) tire_c[i] = AMBIENT_C;
+
+    if(rt_threads_create(RT_THREAD_TELEMETRY, "dash-synth", synth_main, NULL) != 0) return -1;
+
+    LV_LOG_USER("telem_synth: %u m lap of %u segments, %u Hz per channel", (unsigned)lap_m,
+                (unsigned)segment_cnt, (unsigned)rate_hz);
+    return 0;
+}
+
+void telem_synth_get_stats(telem_synth_stats_t * out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Load a built-in track or a track file
+ * @param name the name or the path
+ * @return 0 on success, -1 if the file cannot be read or is empty
+ */
+static int load_track(const char * name)
+{
+    const telem_synth_segment_t * builtin = NULL;
+    uint32_t cnt = 0;
+    float length;
+    float radius;
+    FILE * f;
+
+    if(strcmp(name, "endurance") == 0) {
+        builtin = track_endurance;
+        cnt = sizeof(track_endurance) / sizeof(track_endurance[0]);
+    }
+    else if(strcmp(name, "autocross") == 0) {
+        builtin = track_autocross;
+        cnt = sizeof(track_autocross) / sizeof(track_autocross[0]);
+    }
+    else if(strcmp(name, "skidpad") == 0) {
+        builtin = track_skidpad;
+        cnt = sizeof(track_skidpad) / sizeof(track_skidpad[0]);
+    }
+
+    if(builtin) {
+        memcpy(segments, builtin, cnt * sizeof(segments[0]));
+        segment_cnt = cnt;
+        return 0;
+    }
+
+    f = fopen(name, "r");
+    if(f == NULL) {
+        fprintf(stderr, "telem_synth: no track %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    while(segment_cnt < TELEM_SYNTH_MAX_SEGMENTS && fscanf(f, "%f %f", &length, &radius) == 2) {
+        if(length < 1.0f) continue;
+        segments[segment_cnt].length_m = length;
+        segments[segment_cnt].radius_m = radius;
+        segment_cnt++;
+    }
+    fclose(f);
+
+    if(segment_cnt == 0) {
+        fprintf(stderr, "telem_synth: %s has no segments\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Compute the fastest speed at every meter of the lap
+ * @return 0 on success, -1 if out of memory
+ */
+static int build_profile(void)
+{
+    float len = 0;
+    float k;
+    float v;
+    float a;
+    uint32_t seg;
+    uint32_t i;
+    uint32_t m;
+    uint32_t pass;
+
+    for(seg = 0; seg < segment_cnt; seg++) len += segments[seg].length_m;
+    lap_m = (uint32_t)len;
+
+    profile = malloc(lap_m * sizeof(float));
+    curvature = malloc(lap_m * sizeof(float));
+    if(profile == NULL || curvature == NULL) return -1;
+
+    /* Corner speed, the grip is all lateral */
+    m = 0;
+    for(seg = 0; seg < segment_cnt; seg++) {
+        k = segments[seg].radius_m != 0.0f ? 1.0f / segments[seg].radius_m : 0.0f;
+        for(len = 0; len < segments[seg].length_m && m < lap_m; len += 1.0f, m++) {
+            curvature[m] = k;
+            profile[m] = k != 0.0f ? LV_MIN(sqrtf(MU * G / fabsf(k)), V_TOP) : V_TOP;
+        }
+    }
+    for(; m < lap_m; m++) {
+        curvature[m] = 0.0f;
+        profile[m] = V_TOP;
+    }
+
+    /* Twice around, so the lap closes on the speed it starts with */
+    v = profile[lap_m - 1];
+    for(pass = 0; pass < 2; pass++) {
+        for(i = 0; i < lap_m; i++) {
+            a = (drive_force_max(v) - DRAG_N_PER_V2 * v * v - ROLL_N) / MASS_KG;
+            v = LV_MIN(profile[i], sqrtf(v * v + 2.0f * LV_MAX(a, 0.0f)));
+            profile[i] = v;
+        }
+    }
+    v = profile[0];
+    for(pass = 0; pass < 2; pass++) {
+        for(i = lap_m; i-- > 0;) {
+            a = (MU * MASS_KG * G + DRAG_N_PER_V2 * v * v) / MASS_KG;
+            v = LV_MIN(profile[i], sqrtf(v * v + 2.0f * a));
+            profile[i] = v;
+        }
+    }
+
+    speed = profile[0];
+    return 0;
+}
+
+static void * synth_main(void * arg)
+{
+    uint64_t step_ns = 1000000000ull / rate_hz;
+    uint64_t period_ns = LV_MAX(step_ns, (uint64_t)MIN_PERIOD_NS);
+    uint64_t start = dash_clock_mono_us() * 1000;
+    uint64_t next = start;
+    uint64_t due;
+    uint64_t done = 0;
+    struct timespec ts;
+    float dt = 1.0f / (float)rate_hz;
+
+    (void)arg;
+
+    while(1) {
+        next += period_ns;
+        ts.tv_sec = (time_t)(next / 1000000000ull);
+        ts.tv_nsec = (long)(next % 1000000000ull);
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+        /* Every step that is due, several per wakeup at high rates */
+        due = (dash_clock_mono_us() * 1000 - start) / step_ns;
+        if(due > done + 2 * period_ns / step_ns) {
+            pthread_mutex_lock(&lock);
+            stats.late_steps += (uint32_t)(due - done);
+            pthread_mutex_unlock(&lock);
+        }
+        for(; done < due; done++) step(dt, (uint32_t)((done * step_ns) / 1000000u));
+    }
+
+    return NULL;
+}
+
+/**
+ * Advance the car by one step and publish its telemetry
+ * @param dt the step, s
+ * @param t_ms time since the start
+ */
+static void step(float dt, uint32_t t_ms)
+{
+    static const float front_share[2] = {0.35f, 0.65f};  /* accelerating, braking */
+    float target = profile_at(pos_m) * pace;
+    float k = curvature_at(pos_m);
+    float resist = DRAG_N_PER_V2 * speed * speed + ROLL_N;
+    float f_max = drive_force_max(speed);
+    float f_long;
+    float f_lat;
+    float throttle = 0.0f;
+    float brake = 0.0f;
+    float power;
+    float ocv;
+    float current;
+    float front;
+    float outer;
+    float share;
+    float heat;
+    uint32_t word;
+    uint32_t samples = 9;
+    uint32_t i;
+
+    /* The force that takes the car to the profile speed within this step */
+    f_long = MASS_KG * (target - speed) / LV_MAX(dt, 0.05f) + resist;
+    f_long = LV_CLAMP(-MU * MASS_KG * G, f_long, f_max);
+    if(f_long >= 0.0f) throttle = 100.0f * f_long / f_max;
+    else brake = 100.0f * -f_long / (MU * MASS_KG * G);
+
+    speed = LV_MAX(speed + (f_long - resist) / MASS_KG * dt, 0.5f);
+    pos_m += speed * dt;
+    if(pos_m >= (float)lap_m) {
+        pos_m -= (float)lap_m;
+        pace = 0.94f + 0.05f * frand();
+
+        pthread_mutex_lock(&lock);
+        stats.laps++;
+        stats.last_lap_ms = t_ms - lap_start_ms;
+        pthread_mutex_unlock(&lock);
+        LV_LOG_USER("telem_synth: lap %u in %u.%us, SOC %u%%", (unsigned)stats.laps,
+                    (unsigned)(stats.last_lap_ms / 1000), (unsigned)(stats.last_lap_ms % 1000 / 100),
+                    (unsigned)(soc * 100.0f));
+        lap_start_ms = t_ms;
+    }
+
+    /* Pack: the motor draws, regen returns part of the braking work */
+    power = (f_long > 0.0f ? f_long * speed / DRIVE_EFF : f_long * speed * REGEN_EFF) + AUX_W;
+    ocv = PACK_OCV_MIN + PACK_OCV_SPAN * soc;
+    current = power / ocv;
+    soc = LV_MIN(soc - power * dt / PACK_J, 1.0f);
+    pack_c += (current * current * PACK_R_OHM - PACK_COOL_W_K * (pack_c - AMBIENT_C)) * dt / PACK_HEAT_CAP;
+    if(soc < PACK_EMPTY) {
+        /* Pack swap, the soak test goes on */
+        soc = 1.0f;
+        pack_c = AMBIENT_C;
+    }
+
+    /* Tires: work on each tire heats it, the airflow cools it */
+    f_lat = MASS_KG * speed * speed * k;
+    front = f_long >= 0.0f ? front_share[0] : front_share[1];
+    for(i = 0; i < 4; i++) {
+        /* 0 FL, 1 FR, 2 RL, 3 RR, the outer side of a right-hander is the left one */
+        outer = (i % 2 == 0) == (k > 0.0f) ? 0.65f : 0.35f;
+        share = (i < 2 ? front : 1.0f - front) / 2.0f;
+        heat = TIRE_SLIP * speed * (share * fabsf(f_long) + outer / 2.0f * fabsf(f_lat));
+        tire_c[i] += (heat - TIRE_COOL_W_K * (tire_c[i] - AMBIENT_C) * (1.0f + speed / 10.0f)) * dt /
+                     TIRE_HEAT_CAP;
+    }
+
+    telemetry_publish(TELEM_SPEED, speed * 3.6f);
+    telemetry_publish(TELEM_THROTTLE, LV_CLAMP(0.0f, throttle + (frand() - 0.5f), 100.0f));
+    telemetry_publish(TELEM_BRAKE, brake);
+    telemetry_publish(TELEM_PACK_VOLT, ocv - current * PACK_R_OHM);
+    telemetry_publish(TELEM_BATT_TEMP, pack_c * 9.0f / 5.0f + 32.0f);
+    for(i = 0; i < 4; i++) telemetry_publish((telem_channel_t)(TELEM_TIRE_FL + i), tire_c[i]);
+
+    if(t_ms - last_slow_ms >= 1000 / TELEM_SYNTH_SLOW_HZ) {
+        last_slow_ms = t_ms;
+
+        /* A random fault now and then, held for a few seconds */
+        if(fault_word != 0 && (int32_t)(t_ms - fault_until_ms) >= 0) fault_word = 0;
+        if(fault_word == 0 && fault_mean_s > 0.0f && frand() < 1.0f / (fault_mean_s * TELEM_SYNTH_SLOW_HZ)) {
+            fault_word = FAULT_BIT((uint32_t)(frand() * FAULT_COUNT) % FAULT_COUNT);
+            fault_until_ms = t_ms + FAULT_HOLD_MIN_MS +
+                             (uint32_t)(frand() * (FAULT_HOLD_MAX_MS - FAULT_HOLD_MIN_MS));
+            pthread_mutex_lock(&lock);
+            stats.faults++;
+            pthread_mutex_unlock(&lock);
+        }
+        word = fault_word;
+        if(pack_c > PACK_OVER_C) word |= FAULT_BIT(FAULT_OVER_TEMP);
+        if(soc < 2.0f * PACK_EMPTY) word |= FAULT_BIT(FAULT_UNDER_VOLTAGE);
+        fault_report(word);
+
+        telemetry_publish(TELEM_BATT_SOC, soc * 100.0f);
+        telemetry_publish(TELEM_LV_OK, 1.0f);
+        telemetry_publish(TELEM_HV_ON, 1.0f);
+        telemetry_publish(TELEM_RTD, 1.0f);
+        samples += 4;
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.steps++;
+    stats.published += samples;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Largest drive force at a speed, traction limited at low speed, power limited above
+ * @param v speed, m/s
+ * @return the force, N
+ */
+static float drive_force_max(float v)
+{
+    return LV_MIN(MU * MASS_KG * G, POWER_W / LV_MAX(v, 1.0f));
+}
+
+static float profile_at(float s)
+{
+    uint32_t i = (uint32_t)s % lap_m;
+    float frac = s - floorf(s);
+
+    return profile[i] + (profile[(i + 1) % lap_m] - profile[i]) * frac;
+}
+
+static float curvature_at(float s)
+{
+    return curvature[(uint32_t)s % lap_m];
+}
+
+/* xorshift32, in [0, 1) */
+static float frand(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
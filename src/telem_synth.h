@@ -0,0 +1,100 @@
+/**
+ * @file telem_synth.h
+ *
+ * Synthetic telemetry of a car lapping a track, to load and soak test the
+ * dashboard without a car.
+ *
+ * At start the speed profile of the track is computed once, 1 m per
+ * point: the corner speed from the grip, then a forward pass limited by
+ * traction and motor power and a backward pass limited by braking. A
+ * thread with the telemetry role then drives the lap in real time, steps
+ * of 1 / DASH_SYNTH_RATE_HZ:
+ * - speed from the profile, scaled by a pace that changes every lap
+ * - throttle and brake from the force the profile asks for
+ * - tire temperatures heated by the load on each tire, cooled by airflow
+ * - SOC drained by the motor power and recovered by regen, voltage
+ *   sagging with the current, the pack heating with it
+ * - faults drawn at random, DASH_SYNTH_FAULT_S apart on average, held for
+ *   a few seconds, plus over-temperature and under-voltage from the pack
+ * An empty pack is swapped for a full one, so a soak test runs for hours.
+ *
+ * Speed, pedals, tires, pack voltage and temperature are published every
+ * step, SOC and the status flags at TELEM_SYNTH_SLOW_HZ.
+ *
+ * Environment:
+ * - DASH_SYNTH          1 to run the generator
+ * - DASH_SYNTH_TRACK    "endurance" (default), "autocross", "skidpad", or a
+ *                       file of "length_m radius_m" lines, radius 0 for a
+ *                       straight, negative for a left-hander
+ * - DASH_SYNTH_RATE_HZ  steps per second (default 100, up to 10000)
+ * - DASH_SYNTH_FAULT_S  mean seconds between random faults, 0 for none
+ *                       (default 120)
+ * - DASH_SYNTH_SEED     seed of the random pace and faults
+ */
+
+#ifndef TELEM_SYNTH_H
+#define TELEM_SYNTH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TELEM_SYNTH_MAX_RATE_HZ 10000
+#define TELEM_SYNTH_SLOW_HZ     10
+
+/* Segments of a track file at most */
+#define TELEM_SYNTH_MAX_SEGMENTS 128
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    float length_m;
+    float radius_m;         /* 0 for a straight, negative to the left */
+} telem_synth_segment_t;
+
+typedef struct {
+    uint64_t steps;
+    uint64_t published;     /* samples */
+    uint32_t laps;
+    uint32_t last_lap_ms;
+    uint32_t faults;        /* random faults raised */
+    uint32_t late_steps;    /* steps emitted after their time */
+} telem_synth_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Build the track and start the generator if DASH_SYNTH is set
+ * @return 0 if the generator runs or is not enabled, -1 on error
+ */
+int telem_synth_init(void);
+
+/**
+ * Get the statistics of the generator
+ * @param stats filled with the statistics
+ */
+void telem_synth_get_stats(telem_synth_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*TELEM_SYNTH_H*/
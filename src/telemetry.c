@@ -0,0 +1,133 @@
+/**
+ * @file telemetry.c
+ *
+ * Thread safe store of the latest telemetry samples
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "telemetry.h"
+#include "session_log.h"
+#include "dash_clock.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static telem_sample_t samples[TELEM_CHANNEL_COUNT];
+static telem_sample_t prev_samples[TELEM_CHANNEL_COUNT];
+static uint32_t dirty;
+static int wake_fd = -1;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int telemetry_init(void)
+{
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return wake_fd < 0 ? -1 : 0;
+}
+
+int telemetry_get_wake_fd(void)
+{
+    return wake_fd;
+}
+
+void telemetry_publish(telem_channel_t ch, float value)
+{
+    uint64_t one = 1;
+    uint32_t was_dirty;
+    uint32_t t_ms = dash_clock_now_ms();
+
+    if(ch >= TELEM_CHANNEL_COUNT) return;
+
+    pthread_mutex_lock(&lock);
+    prev_samples[ch] = samples[ch];
+    samples[ch].value = value;
+    samples[ch].timestamp_ms = t_ms;
+    was_dirty = dirty;
+    dirty |= TELEM_MASK(ch);
+    pthread_mutex_unlock(&lock);
+
+    session_log_push(ch, value, t_ms);
+
+    /* Only the first sample after a collection needs to wake the UI */
+    if(was_dirty == 0 && wake_fd >= 0) {
+        if(write(wake_fd, &one, sizeof(one)) < 0) {
+            /* Counter saturated, the UI is awake anyway */
+        }
+    }
+}
+
+uint32_t telemetry_take_dirty(void)
+{
+    uint64_t cnt;
+    uint32_t mask;
+
+    if(wake_fd >= 0) {
+        if(read(wake_fd, &cnt, sizeof(cnt)) < 0) {
+            /* Nothing pending, EAGAIN */
+        }
+    }
+
+    pthread_mutex_lock(&lock);
+    mask = dirty;
+    dirty = 0;
+    pthread_mutex_unlock(&lock);
+
+    return mask;
+}
+
+telem_sample_t telemetry_get(telem_channel_t ch)
+{
+    telem_sample_t s = {0};
+
+    if(ch >= TELEM_CHANNEL_COUNT) return s;
+
+    pthread_mutex_lock(&lock);
+    s = samples[ch];
+    pthread_mutex_unlock(&lock);
+
+    return s;
+}
+
+void telemetry_get_history(telem_channel_t ch, telem_sample_t * prev, telem_sample_t * last)
+{
+    telem_sample_t zero = {0};
+
+    if(ch >= TELEM_CHANNEL_COUNT) {
+        *prev = zero;
+        *last = zero;
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    *prev = prev_samples[ch];
+    *last = samples[ch];
+    pthread_mutex_unlock(&lock);
+}
+
+void telemetry_get_values(float * values)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < TELEM_CHANNEL_COUNT; i++) values[i] = samples[i].value;
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
@@ -0,0 +1,113 @@
+/**
+ * @file telemetry.h
+ *
+ * Latest value of every signal shown on the dash.
+ * Safety faults do not go through here, see fault.h.
+ *
+ * Sources publish samples from any thread, the UI thread collects the
+ * channels that changed since its last visit and redraws only those.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TELEM_MASK(ch) (1u << (ch))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    TELEM_SPEED,      /* km/h */
+    TELEM_THROTTLE,   /* pedal travel, 0..100 % */
+    TELEM_BRAKE,      /* pedal travel, 0..100 % */
+    TELEM_TIRE_FL,    /* tire temperatures, degC */
+    TELEM_TIRE_FR,
+    TELEM_TIRE_RL,
+    TELEM_TIRE_RR,
+    TELEM_BATT_SOC,   /* state of charge, 0..100 % */
+    TELEM_BATT_TEMP,  /* hottest cell, degF */
+    TELEM_PACK_VOLT,  /* accumulator voltage, V */
+    TELEM_LV_OK,      /* low voltage system healthy, 0/1 */
+    TELEM_HV_ON,      /* tractive system energized, 0/1 */
+    TELEM_RTD,        /* ready to drive, 0/1 */
+    TELEM_CHANNEL_COUNT
+} telem_channel_t;
+
+typedef struct {
+    float value;
+    uint32_t timestamp_ms;
+} telem_sample_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Initialize the model
+ * @return 0 on success, -1 if the wake-up fd could not be created
+ */
+int telemetry_init(void);
+
+/**
+ * Get the fd that becomes readable when new samples are waiting
+ * @return an eventfd, or -1 before telemetry_init()
+ */
+int telemetry_get_wake_fd(void);
+
+/**
+ * Publish a sample, can be called from any thread
+ * @param ch the channel
+ * @param value the new value
+ */
+void telemetry_publish(telem_channel_t ch, float value);
+
+/**
+ * Collect the channels updated since the previous call, UI thread only
+ * @return a mask of TELEM_MASK() bits
+ */
+uint32_t telemetry_take_dirty(void);
+
+/**
+ * Get the latest sample of a channel
+ * @param ch the channel
+ * @return the sample, zero if nothing was published yet
+ */
+telem_sample_t telemetry_get(telem_channel_t ch);
+
+/**
+ * Get the two latest samples of a channel, e.g. to interpolate between them
+ * @param ch the channel
+ * @param prev set to the sample before the latest one, zero if there is none
+ * @param last set to the latest sample
+ */
+void telemetry_get_history(telem_channel_t ch, telem_sample_t * prev, telem_sample_t * last);
+
+/**
+ * Get the latest value of every channel at once
+ * @param values array of TELEM_CHANNEL_COUNT elements, set to the values
+ */
+void telemetry_get_values(float * values);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*TELEMETRY_H*/
@@ -0,0 +1,329 @@
+/**
+ * @file udp_telem.c
+ *
+ * Batched UDP telemetry receiver
+ */
+
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE /* needed for recvmmsg() */
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "lvgl/lvgl.h"
+#include "udp_telem.h"
+#include "dash_clock.h"
+#include "rt_threads.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define CMSG_LEN_MAX CMSG_SPACE(sizeof(uint32_t))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    int fd;
+    bool seq_valid;
+    uint32_t next_seq;
+    uint32_t ovfl;          /* last SO_RXQ_OVFL counter */
+    uint64_t report_packets;
+    udp_telem_stats_t work;     /* receiver thread only */
+    udp_telem_stats_t stats;    /* copy of work under the lock */
+} udp_socket_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * receiver_main(void * arg);
+static void drain(udp_socket_t * s);
+static void handle_packet(udp_socket_t * s, const uint8_t * data, uint32_t len);
+static int open_socket(const char * spec, udp_socket_t * s);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static udp_socket_t sockets[UDP_TELEM_MAX_SOCKETS];
+static uint32_t socket_cnt;
+
+/* Receive batch, owned by the receiver thread */
+static udp_telem_packet_t pkts[UDP_TELEM_BATCH];
+static struct mmsghdr msgs[UDP_TELEM_BATCH];
+static struct iovec iovs[UDP_TELEM_BATCH];
+static uint8_t cmsgs[UDP_TELEM_BATCH][CMSG_LEN_MAX];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int udp_telem_init(void)
+{
+    char list[128];
+    char * save;
+    char * spec;
+
+    snprintf(list, sizeof(list), "%s", getenv_default("DASH_UDP", ""));
+    if(list[0] == '\0') return 0;
+
+    for(spec = strtok_r(list, ",", &save); spec != NULL; spec = strtok_r(NULL, ",", &save)) {
+        if(socket_cnt == UDP_TELEM_MAX_SOCKETS) {
+            fprintf(stderr, "udp_telem: more than %d sockets, %s ignored\n", UDP_TELEM_MAX_SOCKETS, spec);
+            continue;
+        }
+        if(open_socket(spec, &sockets[socket_cnt]) != 0) return -1;
+        socket_cnt++;
+    }
+
+    if(rt_threads_create(RT_THREAD_TELEMETRY, "dash-udp", receiver_main, NULL) != 0) return -1;
+    return 0;
+}
+
+bool udp_telem_get_stats(uint32_t idx, udp_telem_stats_t * out)
+{
+    if(idx >= socket_cnt) return false;
+
+    pthread_mutex_lock(&lock);
+    *out = sockets[idx].stats;
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * receiver_main(void * arg)
+{
+    struct pollfd pfds[UDP_TELEM_MAX_SOCKETS];
+    uint32_t last_report = (uint32_t)(dash_clock_mono_us() / 1000);
+    uint32_t elapsed;
+    uint32_t now;
+    uint32_t i;
+    udp_telem_stats_t * st;
+
+    (void)arg;
+
+    for(i = 0; i < UDP_TELEM_BATCH; i++) {
+        iovs[i].iov_base = &pkts[i];
+        iovs[i].iov_len = sizeof(pkts[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for(i = 0; i < socket_cnt; i++) {
+        pfds[i].fd = sockets[i].fd;
+        pfds[i].events = POLLIN;
+    }
+
+    while(1) {
+        if(poll(pfds, socket_cnt, UDP_TELEM_REPORT_MS) < 0 && errno != EINTR) {
+            fprintf(stderr, "udp_telem: poll failed: %s\n", strerror(errno));
+            return NULL;
+        }
+
+        for(i = 0; i < socket_cnt; i++) {
+            if(pfds[i].revents & POLLIN) drain(&sockets[i]);
+        }
+
+        now = (uint32_t)(dash_clock_mono_us() / 1000);
+        elapsed = now - last_report;
+        if(elapsed < UDP_TELEM_REPORT_MS) continue;
+        last_report = now;
+
+        for(i = 0; i < socket_cnt; i++) {
+            st = &sockets[i].work;
+            st->rate = (uint32_t)((st->packets - sockets[i].report_packets) * 1000 / elapsed);
+            sockets[i].report_packets = st->packets;
+            pthread_mutex_lock(&lock);
+            sockets[i].stats = *st;
+            pthread_mutex_unlock(&lock);
+
+            LV_LOG_USER("udp_telem: port %u: %u packets/s, %u lost, %u reordered, %u kernel drops, "
+                        "%u malformed, batch up to %u", (unsigned)st->port, (unsigned)st->rate,
+                        (unsigned)st->lost, (unsigned)st->reordered, (unsigned)st->kernel_drops,
+                        (unsigned)st->malformed, (unsigned)st->max_batch);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Receive and publish everything queued on a socket
+ * @param s the socket
+ */
+static void drain(udp_socket_t * s)
+{
+    struct cmsghdr * cm;
+    uint32_t ovfl;
+    int n;
+    int i;
+
+    do {
+        for(i = 0; i < UDP_TELEM_BATCH; i++) {
+            msgs[i].msg_hdr.msg_control = cmsgs[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+        }
+
+        n = recvmmsg(s->fd, msgs, UDP_TELEM_BATCH, MSG_DONTWAIT, NULL);
+        if(n < 0) {
+            if(errno != EAGAIN && errno != EINTR) fprintf(stderr, "udp_telem: receive failed: %s\n", strerror(errno));
+            return;
+        }
+
+        for(i = 0; i < n; i++) {
+            /* Longer than any valid packet */
+            if(msgs[i].msg_hdr.msg_flags & MSG_TRUNC) msgs[i].msg_len = 0;
+            handle_packet(s, (const uint8_t *)&pkts[i], msgs[i].msg_len);
+        }
+
+        /* The drop counter of the socket rides along with every datagram, the last one is the newest */
+        if(n > 0) {
+            for(cm = CMSG_FIRSTHDR(&msgs[n - 1].msg_hdr); cm != NULL; cm = CMSG_NXTHDR(&msgs[n - 1].msg_hdr, cm)) {
+                if(cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+                    memcpy(&ovfl, CMSG_DATA(cm), sizeof(ovfl));
+                    s->work.kernel_drops += ovfl - s->ovfl;
+                    s->ovfl = ovfl;
+                }
+            }
+        }
+
+        s->work.max_batch = LV_MAX(s->work.max_batch, (uint32_t)n);
+    } while(n == UDP_TELEM_BATCH);
+
+    pthread_mutex_lock(&lock);
+    s->stats = s->work;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Check the sequence number of a packet and publish its samples
+ * @param s the socket it came from
+ * @param data the datagram
+ * @param len its length
+ */
+static void handle_packet(udp_socket_t * s, const uint8_t * data, uint32_t len)
+{
+    const udp_telem_packet_t * pkt = (const udp_telem_packet_t *)data;
+    uint32_t lost = 0;
+    uint32_t values = 0;
+    uint32_t gap;
+    uint32_t ch;
+    bool restart = false;
+    bool reordered = false;
+    bool bad;
+
+    bad = len < UDP_TELEM_HEADER_SIZE || pkt->magic != UDP_TELEM_MAGIC || pkt->version != UDP_TELEM_VERSION ||
+          (pkt->mask >> TELEM_CHANNEL_COUNT) != 0;
+    if(!bad) {
+        for(ch = 0; ch < TELEM_CHANNEL_COUNT; ch++) values += (pkt->mask >> ch) & 1;
+        bad = len != UDP_TELEM_HEADER_SIZE + values * sizeof(float);
+    }
+
+    if(!bad && s->seq_valid && pkt->seq != s->next_seq) {
+        gap = pkt->seq - s->next_seq;
+        if(gap <= UDP_TELEM_REORDER_WINDOW) lost = gap;
+        else if(s->next_seq - pkt->seq <= UDP_TELEM_REORDER_WINDOW) reordered = true;
+        else restart = true;
+    }
+
+    if(bad) {
+        s->work.malformed++;
+    }
+    else {
+        s->work.packets++;
+        s->work.bytes += len;
+        s->work.lost += lost;
+        s->work.reordered += reordered;
+        /* It was counted as lost when the newer packet skipped over it */
+        if(reordered && s->work.lost > 0) s->work.lost--;
+        s->work.restarts += restart;
+    }
+
+    if(bad || reordered) return;
+
+    s->seq_valid = true;
+    s->next_seq = pkt->seq + 1;
+
+    values = 0;
+    for(ch = 0; ch < TELEM_CHANNEL_COUNT; ch++) {
+        if(pkt->mask & TELEM_MASK(ch)) telemetry_publish((telem_channel_t)ch, pkt->values[values++]);
+    }
+}
+
+/**
+ * Bind a socket to [address:]port and size its receive buffer
+ * @param spec the address
+ * @param s set up with the socket
+ * @return 0 on success, -1 on error
+ */
+static int open_socket(const char * spec, udp_socket_t * s)
+{
+    struct sockaddr_in addr;
+    const char * colon = strrchr(spec, ':');
+    char host[64] = "0.0.0.0";
+    int rcvbuf = atoi(getenv_default("DASH_UDP_RCVBUF", "4096")) * 1024;
+    int one = 1;
+    int actual = 0;
+    socklen_t optlen = sizeof(actual);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)atoi(colon ? colon + 1 : spec));
+    if(colon) snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+    if(inet_pton(AF_INET, host, &addr.sin_addr) != 1 || addr.sin_port == 0) {
+        fprintf(stderr, "udp_telem: bad address %s\n", spec);
+        return -1;
+    }
+
+    s->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(s->fd < 0) {
+        fprintf(stderr, "udp_telem: socket failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* SO_RCVBUFFORCE goes past rmem_max when we are allowed to */
+    if(setsockopt(s->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) {
+        setsockopt(s->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    getsockopt(s->fd, SOL_SOCKET, SO_RCVBUF, &actual, &optlen);
+    setsockopt(s->fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+
+    if(bind(s->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "udp_telem: could not bind %s: %s\n", spec, strerror(errno));
+        close(s->fd);
+        return -1;
+    }
+
+    s->work.port = ntohs(addr.sin_port);
+    s->stats = s->work;
+
+    /* The kernel reports twice the size it was asked for, bookkeeping included */
+    if(actual / 2 < rcvbuf) {
+        fprintf(stderr, "udp_telem: %s got a %d KiB receive buffer, raise net.core.rmem_max\n", spec,
+                actual / 2 / 1024);
+    }
+    LV_LOG_USER("udp_telem: listening on %s:%u, %d KiB receive buffer", host, (unsigned)s->work.port,
+                actual / 2 / 1024);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file udp_telem.h
+ *
+ * UDP telemetry from the driver-in-the-loop simulator and the test rig.
+ *
+ * One thread with the telemetry role owns every configured socket and
+ * drains each readable one with recvmmsg(), UDP_TELEM_BATCH datagrams
+ * per system call. The samples of a packet are published with
+ * telemetry_publish(), the same path the live and replayed telemetry
+ * take to the widgets.
+ *
+ * A packet is a udp_telem_packet_t header followed by one float per bit
+ * set in its mask, in channel order, host byte order. Its sequence
+ * number counts up by one per packet, one sender per port:
+ * - a jump forward within UDP_TELEM_REORDER_WINDOW counts the skipped
+ *   packets as lost
+ * - a packet older than the newest one, within the window, counts as
+ *   reordered instead of lost and is dropped, its values are stale
+ * - any other sequence number is a restarted sender: the count starts
+ *   over from it and nothing is counted as lost
+ * Datagrams the kernel dropped on a full receive buffer are counted from
+ * SO_RXQ_OVFL.
+ *
+ * Environment:
+ * - DASH_UDP         comma separated [address:]port list, no UDP if unset
+ * - DASH_UDP_RCVBUF  receive buffer per socket, KiB (default 4096)
+ */
+
+#ifndef UDP_TELEM_H
+#define UDP_TELEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "telemetry.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define UDP_TELEM_MAGIC   0xDA5B
+#define UDP_TELEM_VERSION 1
+
+#define UDP_TELEM_MAX_SOCKETS 4
+
+/* Datagrams received per recvmmsg() call */
+#define UDP_TELEM_BATCH 64
+
+/* Sequence numbers around the expected one taken as the same sender */
+#define UDP_TELEM_REORDER_WINDOW 64
+
+#define UDP_TELEM_REPORT_MS 10000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint32_t seq;
+    uint32_t mask;          /* TELEM_MASK() of the channels that follow */
+    float values[TELEM_CHANNEL_COUNT];
+} udp_telem_packet_t;
+
+#define UDP_TELEM_HEADER_SIZE 12
+
+typedef struct {
+    uint16_t port;
+    uint64_t packets;       /* valid packets */
+    uint64_t bytes;
+    uint32_t malformed;     /* wrong magic, version or length */
+    uint32_t lost;          /* skipped sequence numbers */
+    uint32_t reordered;     /* arrived after a newer packet */
+    uint32_t restarts;      /* sender started over */
+    uint32_t kernel_drops;  /* dropped on a full receive buffer */
+    uint32_t max_batch;     /* most datagrams from one recvmmsg() */
+    uint32_t rate;          /* packets/s over the last report period */
+} udp_telem_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Open the sockets of DASH_UDP and start the receiver thread
+ * @return 0 if the receiver runs or none is configured, -1 if a socket could not be set up
+ */
+int udp_telem_init(void);
+
+/**
+ * Get the statistics of a socket
+ * @param idx index of the socket in DASH_UDP
+ * @param stats filled with the statistics
+ * @return false if there is no such socket
+ */
+bool udp_telem_get_stats(uint32_t idx, udp_telem_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*UDP_TELEM_H*/
@@ -0,0 +1,122 @@
+/**
+ * @file ui_stages.c
+ *
+ * Staged view construction
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "ui_stages.h"
+#include "dash_clock.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void display_event_cb(lv_event_t * e);
+static void stage_timer_cb(lv_timer_t * timer);
+static void run_step(void);
+static void complete(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const ui_stage_t * steps;
+static uint32_t step_cnt;
+static uint32_t next_step;
+static void (*on_done)(void);
+static lv_timer_t * stage_timer;
+static ui_stages_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void ui_stages_start(lv_display_t * disp, const ui_stage_t * stages, uint32_t cnt, void (*done_cb)(void))
+{
+    LV_ASSERT_NULL(disp);
+    LV_ASSERT_NULL(stages);
+
+    steps = stages;
+    step_cnt = cnt;
+    next_step = 0;
+    on_done = done_cb;
+
+    /* Waits for the first frame, then also runs a step when a frame period passed without one */
+    stage_timer = lv_timer_create(stage_timer_cb, LV_DEF_REFR_PERIOD, NULL);
+    lv_timer_pause(stage_timer);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_RENDER_READY, NULL);
+}
+
+void ui_stages_finish(void)
+{
+    if(ui_stages_done()) return;
+
+    while(next_step < step_cnt) run_step();
+    complete();
+}
+
+bool ui_stages_done(void)
+{
+    return stage_timer == NULL;
+}
+
+void ui_stages_get_stats(ui_stages_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void display_event_cb(lv_event_t * e)
+{
+    LV_UNUSED(e);
+
+    /* The frame is out, the next step goes into the following one */
+    if(stage_timer == NULL) return;
+    lv_timer_resume(stage_timer);
+    lv_timer_ready(stage_timer);
+}
+
+static void stage_timer_cb(lv_timer_t * timer)
+{
+    (void)timer;
+    stats.ticks++;
+
+    run_step();
+    if(next_step >= step_cnt) complete();
+}
+
+static void run_step(void)
+{
+    const ui_stage_t * step = &steps[next_step++];
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    uint32_t elapsed;
+
+    step->build();
+
+    elapsed = (uint32_t)dash_clock_mono_us() - start;
+    stats.steps_run++;
+    stats.total_us += elapsed;
+    if(elapsed > stats.longest_us) {
+        stats.longest_us = elapsed;
+        stats.longest = step->name;
+    }
+}
+
+static void complete(void)
+{
+    lv_timer_delete(stage_timer);
+    stage_timer = NULL;
+
+    LV_LOG_USER("stages: %u steps in %u ticks, %uus total, longest %s %uus",
+                (unsigned)stats.steps_run, (unsigned)stats.ticks, (unsigned)stats.total_us,
+                stats.longest ? stats.longest : "-", (unsigned)stats.longest_us);
+
+    if(on_done) on_done();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file ui_stages.h
+ *
+ * Staged construction of the views that are not visible at boot.
+ *
+ * The views are split into build steps. The first step runs once the boot
+ * screen was rendered, then one step follows each rendered frame, so the
+ * boot screen is up before anything else is built and no frame waits for
+ * more than one step. A step that renders nothing is followed by the next
+ * one after a frame period. ui_stages_finish() runs the remaining steps at
+ * once, for events that need a view before its turn, e.g. a fault.
+ */
+
+#ifndef UI_STAGES_H
+#define UI_STAGES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char * name;
+    void (*build)(void);
+} ui_stage_t;
+
+typedef struct {
+    uint32_t steps_run;     /* steps completed */
+    uint32_t ticks;         /* frames used */
+    uint32_t longest_us;    /* slowest step */
+    const char * longest;   /* name of the slowest step */
+    uint32_t total_us;      /* sum of all steps */
+} ui_stages_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Build the steps in order, starting after the next frame of a display
+ * @param disp the display showing the boot screen
+ * @param stages the steps, must stay valid until done
+ * @param cnt number of steps
+ * @param done_cb called once after the last step, may be NULL
+ */
+void ui_stages_start(lv_display_t * disp, const ui_stage_t * stages, uint32_t cnt, void (*done_cb)(void));
+
+/**
+ * Run every remaining step now
+ */
+void ui_stages_finish(void);
+
+/**
+ * Tell whether every step was built
+ * @return true when done
+ */
+bool ui_stages_done(void);
+
+/**
+ * Get the build statistics
+ * @param stats filled with the statistics
+ */
+void ui_stages_get_stats(ui_stages_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*UI_STAGES_H*/
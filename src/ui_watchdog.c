@@ -0,0 +1,280 @@
+/**
+ * @file ui_watchdog.c
+ *
+ * Heartbeat of the UI loop, deadline misses and the hardware watchdog
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/watchdog.h>
+
+#include "lvgl/lvgl.h"
+#include "ui_watchdog.h"
+#include "dash_clock.h"
+#include "rt_threads.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define REPORT_PERIOD_MS 10000
+
+/* Frames printed by the backtrace of a stall */
+#define BACKTRACE_DEPTH 32
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void * watchdog_main(void * arg);
+static void open_device(void);
+static void close_device(void);
+static void dump_stall(uint32_t stalled_ms, const uint32_t * trace_ms, uint32_t oldest, uint32_t cnt);
+static void backtrace_signal_handler(int sig);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t ui_thread;
+
+static uint32_t deadline_ms;
+static uint32_t stall_ms;
+static uint32_t test_stall_at;
+static int wdog_fd = -1;
+static uint32_t pet_period_ms;
+
+/* Shared with the watchdog thread, under the lock */
+static bool busy;
+static uint32_t frame_start;
+static uint32_t trace[UI_WATCHDOG_TRACE_LEN];
+static uint32_t trace_pos;
+static bool stall_reported;
+static ui_watchdog_stats_t stats;
+
+static uint32_t last_report;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int ui_watchdog_init(void)
+{
+    void * warmup[1];
+    struct sigaction sa;
+    uint32_t test_s;
+
+    deadline_ms = (uint32_t)atoi(getenv_default("DASH_FRAME_DEADLINE_MS", "0"));
+    if(deadline_ms == 0) deadline_ms = 2 * LV_DEF_REFR_PERIOD;
+    stall_ms = (uint32_t)atoi(getenv_default("DASH_STALL_MS", "1000"));
+    test_s = (uint32_t)atoi(getenv_default("DASH_WDOG_TEST_STALL_S", "0"));
+    test_stall_at = test_s > 0 ? (uint32_t)(dash_clock_mono_us() / 1000) + test_s * 1000 : 0;
+
+    /* backtrace() loads libgcc on its first call, not in a signal handler */
+    backtrace(warmup, 1);
+    ui_thread = pthread_self();
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = backtrace_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    /* The UI thread may be stuck in a syscall, let it carry on afterwards */
+    sa.sa_flags = SA_RESTART;
+    if(sigaction(SIGUSR2, &sa, NULL) != 0) {
+        fprintf(stderr, "ui_watchdog: sigaction failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    open_device();
+
+    last_report = (uint32_t)(dash_clock_mono_us() / 1000);
+    if(rt_threads_create(RT_THREAD_WATCHDOG, "dash-watchdog", watchdog_main, NULL) != 0) {
+        /* Nobody would pet it, don't let it reset the board */
+        close_device();
+        return -1;
+    }
+
+    LV_LOG_USER("ui_watchdog: deadline %ums, stall %ums, %s", (unsigned)deadline_ms, (unsigned)stall_ms,
+                wdog_fd >= 0 ? "petting the hardware watchdog" : "no hardware watchdog");
+    return 0;
+}
+
+void ui_watchdog_frame_start(void)
+{
+    uint32_t now = (uint32_t)(dash_clock_mono_us() / 1000);
+
+    pthread_mutex_lock(&lock);
+    busy = true;
+    frame_start = now;
+    pthread_mutex_unlock(&lock);
+
+    if(test_stall_at != 0 && (int32_t)(now - test_stall_at) >= 0) {
+        fprintf(stderr, "ui_watchdog: DASH_WDOG_TEST_STALL_S reached, freezing the UI loop\n");
+        while(1) usleep(1000000);
+    }
+}
+
+void ui_watchdog_frame_end(void)
+{
+    uint32_t now = (uint32_t)(dash_clock_mono_us() / 1000);
+    uint32_t elapsed;
+    bool recovered;
+
+    pthread_mutex_lock(&lock);
+    elapsed = now - frame_start;
+    busy = false;
+    trace[trace_pos] = elapsed;
+    trace_pos = (trace_pos + 1) % UI_WATCHDOG_TRACE_LEN;
+    stats.frames++;
+    if(elapsed > deadline_ms) stats.deadline_misses++;
+    if(elapsed > stats.worst_ms) stats.worst_ms = elapsed;
+    recovered = stall_reported;
+    stall_reported = false;
+    pthread_mutex_unlock(&lock);
+
+    if(recovered) fprintf(stderr, "ui_watchdog: UI loop recovered after %ums\n", (unsigned)elapsed);
+
+    if(now - last_report >= REPORT_PERIOD_MS) {
+        last_report = now;
+        LV_LOG_USER("ui_watchdog: %u frames, %u over %ums, worst %ums, %u stalls",
+                    (unsigned)stats.frames, (unsigned)stats.deadline_misses, (unsigned)deadline_ms,
+                    (unsigned)stats.worst_ms, (unsigned)stats.stalls);
+    }
+}
+
+void ui_watchdog_get_stats(ui_watchdog_stats_t * out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void * watchdog_main(void * arg)
+{
+    struct timespec period = {0, UI_WATCHDOG_CHECK_MS * 1000000L};
+    uint32_t snapshot[UI_WATCHDOG_TRACE_LEN];
+    uint32_t snapshot_pos = 0;
+    uint32_t snapshot_cnt = 0;
+    uint32_t last_pet = 0;
+    uint32_t stalled_ms;
+    uint32_t now;
+    bool new_stall;
+
+    (void)arg;
+
+    while(1) {
+        nanosleep(&period, NULL);
+        now = (uint32_t)(dash_clock_mono_us() / 1000);
+
+        pthread_mutex_lock(&lock);
+        stalled_ms = busy ? now - frame_start : 0;
+        new_stall = stalled_ms >= stall_ms && !stall_reported;
+        if(new_stall) {
+            stall_reported = true;
+            stats.stalls++;
+            memcpy(snapshot, trace, sizeof(snapshot));
+            snapshot_pos = trace_pos;
+            snapshot_cnt = stats.frames;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if(new_stall) dump_stall(stalled_ms, snapshot, snapshot_pos, snapshot_cnt);
+
+        /* A stalled UI is left to the hardware watchdog */
+        if(wdog_fd >= 0 && stalled_ms < stall_ms && now - last_pet >= pet_period_ms) {
+            if(ioctl(wdog_fd, WDIOC_KEEPALIVE, 0) == 0) {
+                pthread_mutex_lock(&lock);
+                stats.pets++;
+                pthread_mutex_unlock(&lock);
+            }
+            last_pet = now;
+        }
+    }
+
+    return NULL;
+}
+
+static void open_device(void)
+{
+    const char * dev = getenv_default("DASH_WATCHDOG_DEV", "/dev/watchdog");
+    int timeout = atoi(getenv_default("DASH_WATCHDOG_TIMEOUT_S", "5"));
+
+    if(dev[0] == '\0') return;
+
+    wdog_fd = open(dev, O_WRONLY | O_CLOEXEC);
+    if(wdog_fd < 0) {
+        fprintf(stderr, "ui_watchdog: could not open %s: %s\n", dev, strerror(errno));
+        return;
+    }
+
+    if(timeout > 0 && ioctl(wdog_fd, WDIOC_SETTIMEOUT, &timeout) != 0) {
+        fprintf(stderr, "ui_watchdog: %s keeps its timeout: %s\n", dev, strerror(errno));
+        ioctl(wdog_fd, WDIOC_GETTIMEOUT, &timeout);
+    }
+
+    /* Petted four times per timeout */
+    pet_period_ms = LV_MAX((uint32_t)LV_MAX(timeout, 1) * 1000 / 4, UI_WATCHDOG_CHECK_MS);
+}
+
+/**
+ * Close the device with the magic close, so the watchdog is disarmed
+ */
+static void close_device(void)
+{
+    if(wdog_fd < 0) return;
+
+    if(write(wdog_fd, "V", 1) != 1) {
+        fprintf(stderr, "ui_watchdog: magic close failed, the watchdog stays armed: %s\n", strerror(errno));
+    }
+    close(wdog_fd);
+    wdog_fd = -1;
+}
+
+/**
+ * Log a stall and make the UI thread print where it is stuck
+ * @param stalled_ms time since the stalled iteration started
+ * @param trace_ms the durations of the iterations before it
+ * @param oldest index of the oldest duration
+ * @param cnt number of durations recorded so far
+ */
+static void dump_stall(uint32_t stalled_ms, const uint32_t * trace_ms, uint32_t oldest, uint32_t cnt)
+{
+    uint32_t i;
+
+    fprintf(stderr, "ui_watchdog: UI loop stalled for %ums, last iterations (ms):", (unsigned)stalled_ms);
+    for(i = UI_WATCHDOG_TRACE_LEN - LV_MIN(cnt, UI_WATCHDOG_TRACE_LEN); i < UI_WATCHDOG_TRACE_LEN; i++) {
+        fprintf(stderr, " %u", (unsigned)trace_ms[(oldest + i) % UI_WATCHDOG_TRACE_LEN]);
+    }
+    fprintf(stderr, "\n");
+
+    pthread_kill(ui_thread, SIGUSR2);
+}
+
+static void backtrace_signal_handler(int sig)
+{
+    static const char header[] = "ui_watchdog: backtrace of the UI thread:\n";
+    void * frames[BACKTRACE_DEPTH];
+    int cnt;
+
+    (void)sig;
+
+    cnt = backtrace(frames, BACKTRACE_DEPTH);
+    if(write(STDERR_FILENO, header, sizeof(header) - 1) < 0) return;
+    backtrace_symbols_fd(frames, cnt, STDERR_FILENO);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file ui_watchdog.h
+ *
+ * Stall detection of the UI loop.
+ *
+ * The UI loop marks the start and the end of the work of every
+ * iteration, the wait for the next event in between does not count.
+ * Iterations longer than the frame deadline are counted as misses.
+ *
+ * A watchdog thread checks the loop every UI_WATCHDOG_CHECK_MS. When one
+ * iteration has been running for longer than the stall time, it logs the
+ * recent iteration times and makes the UI thread print its backtrace.
+ * The hardware watchdog is only petted while the UI is not stalled, so a
+ * frozen dash resets the module instead of showing stale values.
+ *
+ * Environment:
+ * - DASH_FRAME_DEADLINE_MS  frame deadline (default twice LV_DEF_REFR_PERIOD)
+ * - DASH_STALL_MS           stall time (default 1000)
+ * - DASH_WATCHDOG_DEV       watchdog device (default /dev/watchdog, empty for none)
+ * - DASH_WATCHDOG_TIMEOUT_S timeout programmed into the device (default 5)
+ * - DASH_WDOG_TEST_STALL_S  freeze the UI loop after this many seconds,
+ *                           to check the watchdog, e.g. with softdog
+ */
+
+#ifndef UI_WATCHDOG_H
+#define UI_WATCHDOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define UI_WATCHDOG_CHECK_MS 100
+
+/* Iteration times kept for the dump of a stall */
+#define UI_WATCHDOG_TRACE_LEN 32
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t frames;
+    uint32_t deadline_misses;
+    uint32_t worst_ms;
+    uint32_t stalls;
+    uint32_t pets;
+} ui_watchdog_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Start the watchdog thread, to be called from the UI thread
+ * @return 0 on success, -1 if the thread could not be started
+ */
+int ui_watchdog_init(void);
+
+/**
+ * Mark the start of the work of a loop iteration, UI thread only
+ */
+void ui_watchdog_frame_start(void);
+
+/**
+ * Mark the end of the work of a loop iteration, before waiting, UI thread only
+ */
+void ui_watchdog_frame_end(void);
+
+/**
+ * Get the counters
+ * @param stats filled with the counters
+ */
+void ui_watchdog_get_stats(ui_watchdog_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*UI_WATCHDOG_H*/
@@ -0,0 +1,212 @@
+/**
+ * @file update_sched.c
+ *
+ * Priority aware widget update scheduler
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+
+#include "update_sched.h"
+#include "telemetry.h"
+#include "telem_interp.h"
+#include "signal_cond.h"
+#include "refresh_governor.h"
+#include "dash_alloc.h"
+#include "dash_clock.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Time available for applying updates and rendering them */
+#define FRAME_BUDGET_US (LV_DEF_REFR_PERIOD * 1000)
+
+/* Updates are forced through after being deferred this many frames */
+#define MAX_DEFER_FRAMES_NORMAL 5
+#define MAX_DEFER_FRAMES_LOW    30
+
+#define REPORT_PERIOD_MS 5000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const update_widget_t * desc;
+    uint32_t alloc_site;
+    uint32_t period_ms;
+    uint32_t last_apply;
+    uint32_t defer_frames;
+    bool pending;
+} sched_entry_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void display_event_cb(lv_event_t * e);
+static bool run_entry(sched_entry_t * entry, uint32_t spent_us);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static sched_entry_t entries[UPDATE_SCHED_MAX_WIDGETS];
+static uint32_t entry_cnt;
+
+static update_sched_stats_t stats;
+static uint32_t render_start_us;
+static uint32_t last_report;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void update_sched_init(lv_display_t * disp)
+{
+    LV_ASSERT_NULL(disp);
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_RENDER_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_RENDER_READY, NULL);
+    last_report = lv_tick_get();
+}
+
+int update_sched_register(const update_widget_t * widget)
+{
+    sched_entry_t * entry;
+
+    LV_ASSERT_NULL(widget);
+    LV_ASSERT_NULL(widget->apply);
+
+    if(entry_cnt >= UPDATE_SCHED_MAX_WIDGETS) {
+        LV_LOG_WARN("Too many widgets, %s not scheduled", widget->name);
+        return -1;
+    }
+
+    entry = &entries[entry_cnt++];
+    entry->desc = widget;
+    entry->alloc_site = dash_alloc_site(widget->name);
+    entry->period_ms = refresh_governor_class_period(widget->cls);
+    entry->last_apply = lv_tick_get() - entry->period_ms;
+    entry->defer_frames = 0;
+    entry->pending = false;
+
+    return 0;
+}
+
+void update_sched_run(void)
+{
+    /* Interpolated channels are only dirty when what they draw changes */
+    uint32_t dirty = signal_cond_run(telem_interp_run(telemetry_take_dirty()));
+    uint32_t start = (uint32_t)dash_clock_mono_us();
+    uint32_t i;
+    int prio;
+
+    if(dirty) {
+        refresh_governor_note_activity();
+
+        for(i = 0; i < entry_cnt; i++) {
+            if((entries[i].desc->channels & dirty) == 0) continue;
+            /* A value that was never drawn is replaced by the newer one */
+            if(entries[i].pending) stats.dropped++;
+            entries[i].pending = true;
+        }
+    }
+
+    for(prio = UPDATE_PRIO_HIGH; prio < UPDATE_PRIO_COUNT; prio++) {
+        for(i = 0; i < entry_cnt; i++) {
+            if(entries[i].desc->prio != (update_prio_t)prio || !entries[i].pending) continue;
+            run_entry(&entries[i], (uint32_t)dash_clock_mono_us() - start);
+        }
+    }
+
+    if(lv_tick_elaps(last_report) >= REPORT_PERIOD_MS) {
+        last_report = lv_tick_get();
+        LV_LOG_USER("sched: applied=%u deferred=%u dropped=%u render=%uus",
+                    (unsigned)stats.applied, (unsigned)stats.deferred,
+                    (unsigned)stats.dropped, (unsigned)stats.render_us);
+    }
+}
+
+uint32_t update_sched_next_ms(void)
+{
+    uint32_t next = LV_NO_TIMER_READY;
+    uint32_t elapsed;
+    uint32_t i;
+
+    for(i = 0; i < entry_cnt; i++) {
+        if(!entries[i].pending) continue;
+        elapsed = lv_tick_elaps(entries[i].last_apply);
+        if(elapsed < entries[i].period_ms) {
+            next = LV_MIN(next, entries[i].period_ms - elapsed);
+        }
+        else {
+            /* Deferred by the budget, it gets another try in the next frame */
+            next = LV_MIN(next, entries[i].defer_frames > 0 ? LV_DEF_REFR_PERIOD : 0);
+        }
+    }
+
+    return next;
+}
+
+void update_sched_get_stats(update_sched_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Apply a pending update unless its rate or the frame budget forbids it
+ * @param entry the widget
+ * @param spent_us time already used by this frame's updates
+ * @return true if the widget was applied
+ */
+static bool run_entry(sched_entry_t * entry, uint32_t spent_us)
+{
+    uint32_t max_defer;
+    uint32_t prev_site;
+
+    /* Over its rate: stays pending and takes the newest value once allowed */
+    if(lv_tick_elaps(entry->last_apply) < entry->period_ms) return false;
+
+    /* The budget depends on the machine, a virtual clock run must draw the same frames on any */
+    if(entry->desc->prio != UPDATE_PRIO_HIGH && !dash_clock_is_virtual() &&
+       stats.render_us + spent_us > FRAME_BUDGET_US) {
+        max_defer = entry->desc->prio == UPDATE_PRIO_NORMAL ? MAX_DEFER_FRAMES_NORMAL : MAX_DEFER_FRAMES_LOW;
+        if(entry->defer_frames < max_defer) {
+            entry->defer_frames++;
+            stats.deferred++;
+            return false;
+        }
+    }
+
+    prev_site = dash_alloc_enter(entry->alloc_site);
+    entry->desc->apply();
+    dash_alloc_leave(prev_site);
+    entry->pending = false;
+    entry->defer_frames = 0;
+    entry->last_apply = lv_tick_get();
+    stats.applied++;
+
+    return true;
+}
+
+static void display_event_cb(lv_event_t * e)
+{
+    uint32_t elapsed;
+
+    if(lv_event_get_code(e) == LV_EVENT_RENDER_START) {
+        render_start_us = (uint32_t)dash_clock_mono_us();
+    }
+    else {
+        /* Smooth over 8 frames so a single slow frame does not starve everyone */
+        elapsed = (uint32_t)dash_clock_mono_us() - render_start_us;
+        stats.render_us = (stats.render_us * 7 + elapsed) / 8;
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file update_sched.h
+ *
+ * Decides which widgets get redrawn in the coming frame.
+ *
+ * Every widget declares the telemetry channels it shows, a priority and a
+ * refresh class that caps its update rate, see refresh_governor.h. High
+ * priority widgets are applied in the first frame after their data changed.
+ * Normal and low priority widgets are deferred, and their samples coalesced,
+ * while the frame budget is exhausted.
+ */
+
+#ifndef UPDATE_SCHED_H
+#define UPDATE_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+#include "refresh_governor.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define UPDATE_SCHED_MAX_WIDGETS 32
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    UPDATE_PRIO_HIGH,   /* never deferred */
+    UPDATE_PRIO_NORMAL,
+    UPDATE_PRIO_LOW,
+    UPDATE_PRIO_COUNT
+} update_prio_t;
+
+/* Reads the telemetry model and updates the LVGL objects of a widget */
+typedef void (*update_apply_cb_t)(void);
+
+typedef struct {
+    const char * name;
+    update_prio_t prio;
+    refresh_class_t cls;   /* caps the update rate */
+    uint32_t channels;     /* TELEM_MASK() of the channels shown */
+    update_apply_cb_t apply;
+} update_widget_t;
+
+typedef struct {
+    uint32_t applied;   /* widget updates rendered */
+    uint32_t deferred;  /* frames a pending update was pushed back by the budget */
+    uint32_t dropped;   /* samples replaced by a newer one before being drawn */
+    uint32_t render_us; /* smoothed render time of a frame */
+} update_sched_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Initialize the scheduler
+ * @param disp the display whose render time is tracked against the budget
+ */
+void update_sched_init(lv_display_t * disp);
+
+/**
+ * Register a widget, the descriptor must stay valid
+ * @param widget the widget descriptor
+ * @return 0 on success, -1 if the table is full
+ */
+int update_sched_register(const update_widget_t * widget);
+
+/**
+ * Collect new telemetry and apply the widget updates that fit in this frame,
+ * call it once per main loop iteration before lv_timer_handler()
+ */
+void update_sched_run(void);
+
+/**
+ * Get the time until a pending widget update may be applied, a sample held
+ * back by the rate of its widget must not wait for an unrelated wakeup
+ * @return milliseconds, LV_NO_TIMER_READY if no update is pending
+ */
+uint32_t update_sched_next_ms(void);
+
+/**
+ * Get the counters accumulated since boot
+ * @param stats filled with the counters
+ */
+void update_sched_get_stats(update_sched_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*UPDATE_SCHED_H*/
@@ -0,0 +1,381 @@
+/**
+ * @file vcu_uart.c
+ *
+ * COBS framed VCU link over a UART
+ */
+
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE /* needed for memfd_create() */
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "lvgl/lvgl.h"
+#include "vcu_uart.h"
+#include "dash_clock.h"
+#include "telemetry.h"
+#include "fault.h"
+#include "simulator_util.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define RING_MASK (VCU_UART_RING_SIZE - 1)
+
+/* Type, sequence number and CRC */
+#define FRAME_OVERHEAD 4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t baud;
+    speed_t speed;
+} baud_rate_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int map_ring(void);
+static int setup_tty(const char * path, uint32_t baud);
+static void parse(void);
+static void handle_frame(uint8_t * p, uint32_t len);
+static int32_t cobs_decode(uint8_t * p, uint32_t len);
+static uint16_t crc16(const uint8_t * p, uint32_t len);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const baud_rate_t baud_rates[] = {
+    {115200, B115200}, {230400, B230400}, {460800, B460800}, {500000, B500000},
+    {576000, B576000}, {921600, B921600}, {1000000, B1000000}, {1152000, B1152000},
+    {1500000, B1500000}, {2000000, B2000000}, {2500000, B2500000}, {3000000, B3000000},
+    {3500000, B3500000}, {4000000, B4000000},
+};
+
+static int tty_fd = -1;
+
+/* The ring is mapped twice, ring[i] and ring[i + VCU_UART_RING_SIZE] are the same byte */
+static uint8_t * ring;
+static uint32_t head;       /* bytes read, free running */
+static uint32_t tail;       /* bytes parsed, free running */
+static uint32_t scanned;    /* bytes after tail searched for a delimiter */
+static bool resync;         /* skip up to the next delimiter */
+
+static bool seq_valid;
+static uint8_t next_seq;
+
+static vcu_uart_stats_t stats;
+static uint32_t last_report;
+static uint32_t report_frames;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int vcu_uart_init(void)
+{
+    const char * path = getenv_default("DASH_VCU_UART", "");
+    uint32_t baud = (uint32_t)strtoul(getenv_default("DASH_VCU_BAUD", "921600"), NULL, 10);
+
+    if(path[0] == '\0') return 0;
+
+    if(map_ring() != 0) return -1;
+    if(setup_tty(path, baud) != 0) return -1;
+
+    last_report = (uint32_t)(dash_clock_mono_us() / 1000);
+    LV_LOG_USER("vcu_uart: %s at %u baud", path, (unsigned)baud);
+    return 0;
+}
+
+int vcu_uart_get_fd(void)
+{
+    return tty_fd;
+}
+
+void vcu_uart_poll(void)
+{
+    uint32_t budget = VCU_UART_POLL_BUDGET;
+    uint32_t now;
+    uint32_t space;
+    ssize_t n;
+
+    if(tty_fd < 0) return;
+
+    while(budget > 0) {
+        space = VCU_UART_RING_SIZE - (head - tail);
+        if(space == 0) {
+            /* No delimiter in a whole ring, parse() normally prevents this */
+            stats.overruns++;
+            tail = head;
+            scanned = 0;
+            resync = true;
+            space = VCU_UART_RING_SIZE;
+        }
+
+        /* The second mapping makes the free space contiguous */
+        n = read(tty_fd, ring + (head & RING_MASK), LV_MIN(space, budget));
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) {
+            if(n < 0 && errno != EAGAIN) fprintf(stderr, "vcu_uart: read failed: %s\n", strerror(errno));
+            break;
+        }
+
+        head += (uint32_t)n;
+        budget -= (uint32_t)n;
+        stats.bytes += (uint64_t)n;
+        parse();
+    }
+
+    now = (uint32_t)(dash_clock_mono_us() / 1000);
+    if(now - last_report >= VCU_UART_REPORT_MS) {
+        stats.rate = (stats.frames - report_frames) * 1000 / (now - last_report);
+        report_frames = stats.frames;
+        last_report = now;
+        LV_LOG_USER("vcu_uart: %u frames/s, %u CRC errors, %u framing errors, %u lost, %u overruns",
+                    (unsigned)stats.rate, (unsigned)stats.crc_errors, (unsigned)stats.framing_errors,
+                    (unsigned)stats.lost, (unsigned)stats.overruns);
+    }
+}
+
+void vcu_uart_get_stats(vcu_uart_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Map the ring twice back to back
+ * @return 0 on success, -1 on error
+ */
+static int map_ring(void)
+{
+    uint8_t * base;
+    int fd;
+
+    fd = memfd_create("vcu-uart-ring", MFD_CLOEXEC);
+    if(fd < 0 || ftruncate(fd, VCU_UART_RING_SIZE) != 0) {
+        fprintf(stderr, "vcu_uart: cannot create the ring: %s\n", strerror(errno));
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    /* Reserve both halves, then put the same pages into each */
+    base = mmap(NULL, 2 * VCU_UART_RING_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED ||
+       mmap(base, VCU_UART_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+       mmap(base + VCU_UART_RING_SIZE, VCU_UART_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+            0) == MAP_FAILED) {
+        fprintf(stderr, "vcu_uart: cannot map the ring: %s\n", strerror(errno));
+        if(base != MAP_FAILED) munmap(base, 2 * VCU_UART_RING_SIZE);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    ring = base;
+    return 0;
+}
+
+/**
+ * Open a tty and put it into raw mode
+ * @param path the tty
+ * @param baud the baud rate
+ * @return 0 on success, -1 on error
+ */
+static int setup_tty(const char * path, uint32_t baud)
+{
+    struct termios tio;
+    speed_t speed = 0;
+    uint32_t i;
+
+    for(i = 0; i < sizeof(baud_rates) / sizeof(baud_rates[0]); i++) {
+        if(baud_rates[i].baud == baud) speed = baud_rates[i].speed;
+    }
+    if(speed == 0) {
+        fprintf(stderr, "vcu_uart: unsupported baud rate %u\n", (unsigned)baud);
+        return -1;
+    }
+
+    tty_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(tty_fd < 0) {
+        fprintf(stderr, "vcu_uart: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if(tcgetattr(tty_fd, &tio) != 0) {
+        fprintf(stderr, "vcu_uart: %s is not a tty: %s\n", path, strerror(errno));
+        close(tty_fd);
+        tty_fd = -1;
+        return -1;
+    }
+
+    /* 8N1, no flow control, nothing interpreted */
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if(tcsetattr(tty_fd, TCSANOW, &tio) != 0) {
+        fprintf(stderr, "vcu_uart: cannot set up %s: %s\n", path, strerror(errno));
+        close(tty_fd);
+        tty_fd = -1;
+        return -1;
+    }
+
+    /* Whatever arrived before we listened is a partial frame */
+    tcflush(tty_fd, TCIFLUSH);
+    resync = true;
+    return 0;
+}
+
+/**
+ * Decode and publish the complete frames between tail and head
+ */
+static void parse(void)
+{
+    uint8_t * start;
+    uint8_t * end;
+    uint32_t len;
+
+    while(head - tail > scanned) {
+        start = ring + (tail & RING_MASK);
+        end = memchr(start + scanned, 0, head - tail - scanned);
+        if(end == NULL) {
+            scanned = head - tail;
+            if(scanned > VCU_UART_MAX_FRAME && !resync) {
+                /* Noise or a lost delimiter, wait for the next one */
+                stats.framing_errors++;
+                resync = true;
+            }
+            if(resync) {
+                tail = head;
+                scanned = 0;
+            }
+            return;
+        }
+
+        len = (uint32_t)(end - start);
+        if(resync) resync = false;
+        else if(len > VCU_UART_MAX_FRAME) stats.framing_errors++;
+        else if(len > 0) handle_frame(start, len);
+
+        tail += len + 1;
+        scanned = 0;
+    }
+}
+
+/**
+ * Check and publish one frame, decoded in place
+ * @param p the encoded frame in the ring
+ * @param len its length without the delimiter
+ */
+static void handle_frame(uint8_t * p, uint32_t len)
+{
+    int32_t n = cobs_decode(p, len);
+    const uint8_t * body;
+    uint32_t body_len;
+    uint32_t word;
+    uint16_t crc;
+    float value;
+    uint32_t i;
+
+    if(n < FRAME_OVERHEAD) {
+        stats.framing_errors++;
+        return;
+    }
+
+    crc = (uint16_t)(p[n - 2] | p[n - 1] << 8);
+    if(crc != crc16(p, (uint32_t)n - 2)) {
+        stats.crc_errors++;
+        return;
+    }
+
+    if(seq_valid && p[1] != next_seq) stats.lost += (uint8_t)(p[1] - next_seq);
+    seq_valid = true;
+    next_seq = (uint8_t)(p[1] + 1);
+
+    body = p + 2;
+    body_len = (uint32_t)n - FRAME_OVERHEAD;
+    switch(p[0]) {
+        case VCU_UART_SAMPLES:
+            if(body_len % 5 != 0) {
+                stats.framing_errors++;
+                return;
+            }
+            for(i = 0; i < body_len; i += 5) {
+                memcpy(&value, body + i + 1, sizeof(value));
+                telemetry_publish((telem_channel_t)body[i], value);
+            }
+            break;
+        case VCU_UART_FAULT:
+            if(body_len != sizeof(word)) {
+                stats.framing_errors++;
+                return;
+            }
+            memcpy(&word, body, sizeof(word));
+            fault_report(word);
+            break;
+        default:
+            stats.framing_errors++;
+            return;
+    }
+
+    stats.frames++;
+}
+
+/**
+ * Decode COBS in place, the output is never longer than the input
+ * @param p the encoded bytes, replaced by the decoded ones
+ * @param len number of encoded bytes
+ * @return number of decoded bytes, -1 if the encoding is broken
+ */
+static int32_t cobs_decode(uint8_t * p, uint32_t len)
+{
+    uint32_t src = 0;
+    uint32_t dst = 0;
+    uint8_t code;
+    uint8_t i;
+
+    while(src < len) {
+        code = p[src++];
+        if(code == 0 || src + code - 1 > len) return -1;
+        for(i = 1; i < code; i++) p[dst++] = p[src++];
+        /* A full block of 254 bytes has no implied zero */
+        if(code != 0xFF && src < len) p[dst++] = 0;
+    }
+
+    return (int32_t)dst;
+}
+
+static uint16_t crc16(const uint8_t * p, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint32_t i;
+    uint8_t b;
+
+    for(i = 0; i < len; i++) {
+        crc ^= (uint16_t)(p[i] << 8);
+        for(b = 0; b < 8; b++) crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
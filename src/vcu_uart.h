@@ -0,0 +1,112 @@
+/**
+ * @file vcu_uart.h
+ *
+ * Telemetry from the VCU over a UART.
+ *
+ * The tty is set to raw mode at DASH_VCU_BAUD and read without blocking.
+ * Its fd wakes the UI loop, which calls vcu_uart_poll() to read what
+ * arrived and publish the decoded samples.
+ *
+ * Bytes are read straight into a ring of VCU_UART_RING_SIZE bytes that
+ * is mapped twice back to back, so every frame in it is contiguous even
+ * where it wraps. Frames are COBS encoded and delimited by 0x00. They are
+ * decoded in place in the ring and never copied.
+ *
+ * Decoded frame, little endian:
+ * - type, 1 byte, a vcu_uart_frame_type_t
+ * - sequence number, 1 byte, one more than the previous frame
+ * - body
+ * - CRC-16/CCITT-FALSE of the bytes before it, 2 bytes
+ *
+ * Bodies:
+ * - VCU_UART_SAMPLES: channel (1 byte) and float value, repeated
+ * - VCU_UART_FAULT: fault word, 4 bytes
+ *
+ * Environment:
+ * - DASH_VCU_UART  tty of the VCU link, e.g. /dev/ttyS1, none if unset
+ * - DASH_VCU_BAUD  baud rate (default 921600)
+ */
+
+#ifndef VCU_UART_H
+#define VCU_UART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* A multiple of the page size */
+#define VCU_UART_RING_SIZE (64 * 1024)
+
+/* Longest encoded frame, delimiter excluded */
+#define VCU_UART_MAX_FRAME 256
+
+/* Bytes read per vcu_uart_poll() at most, the rest waits for the next iteration */
+#define VCU_UART_POLL_BUDGET (4 * VCU_UART_RING_SIZE)
+
+#define VCU_UART_REPORT_MS 10000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    VCU_UART_SAMPLES = 1,
+    VCU_UART_FAULT = 2,
+} vcu_uart_frame_type_t;
+
+typedef struct {
+    uint64_t bytes;
+    uint32_t frames;        /* valid frames */
+    uint32_t crc_errors;
+    uint32_t framing_errors;/* bad COBS, too long or unknown content */
+    uint32_t lost;          /* skipped sequence numbers */
+    uint32_t overruns;      /* ring full, bytes discarded */
+    uint32_t rate;          /* frames/s over the last report period */
+} vcu_uart_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Open and set up the tty of DASH_VCU_UART
+ * @return 0 if the link is open or none is configured, -1 on error
+ */
+int vcu_uart_init(void);
+
+/**
+ * Get the fd that becomes readable when bytes arrive
+ * @return the fd, -1 without a link
+ */
+int vcu_uart_get_fd(void);
+
+/**
+ * Read the pending bytes and publish the frames in them, UI thread only
+ */
+void vcu_uart_poll(void);
+
+/**
+ * Get the statistics of the link
+ * @param stats filled with the statistics
+ */
+void vcu_uart_get_stats(vcu_uart_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*VCU_UART_H*/
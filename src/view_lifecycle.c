@@ -0,0 +1,272 @@
+/**
+ * @file view_lifecycle.c
+ *
+ * Pauses the timers and animations of hidden views
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "view_lifecycle.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    lv_timer_t * timer;
+    bool run;            /* the owner's wish, applied while the view is visible */
+} view_timer_t;
+
+typedef struct {
+    const char * name;
+    bool visible;
+    view_timer_t timers[VIEW_LIFECYCLE_MAX_TIMERS];
+    uint32_t timer_cnt;
+    lv_anim_t anims[VIEW_LIFECYCLE_MAX_ANIMS];
+    uint32_t anim_cnt;
+} view_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static view_t * get_view(int id);
+static view_timer_t * find_timer(lv_timer_t * timer, view_t ** owner);
+static int32_t find_anim(const view_t * v, void * var, lv_anim_exec_xcb_t exec_cb);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static view_t views[VIEW_LIFECYCLE_MAX_VIEWS];
+static uint32_t view_cnt;
+static view_lifecycle_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int view_lifecycle_add(const char * name)
+{
+    if(view_cnt >= VIEW_LIFECYCLE_MAX_VIEWS) {
+        LV_LOG_WARN("Too many views, %s not added", name);
+        return -1;
+    }
+
+    views[view_cnt].name = name;
+    views[view_cnt].visible = false;
+    return (int)view_cnt++;
+}
+
+int view_lifecycle_attach_timer(int view, lv_timer_t * timer, bool run)
+{
+    view_t * v = get_view(view);
+
+    LV_ASSERT_NULL(timer);
+
+    if(v == NULL || v->timer_cnt >= VIEW_LIFECYCLE_MAX_TIMERS) {
+        LV_LOG_WARN("Timer not attached to view %d", view);
+        return -1;
+    }
+
+    v->timers[v->timer_cnt].timer = timer;
+    v->timers[v->timer_cnt].run = run;
+    v->timer_cnt++;
+
+    if(v->visible && run) lv_timer_resume(timer);
+    else lv_timer_pause(timer);
+
+    return 0;
+}
+
+void view_lifecycle_timer_run(lv_timer_t * timer, bool run)
+{
+    view_t * v;
+    view_timer_t * t = find_timer(timer, &v);
+
+    if(t == NULL) {
+        LV_LOG_WARN("Timer is not attached to a view");
+        return;
+    }
+
+    t->run = run;
+    if(!v->visible) return;
+
+    if(run) {
+        lv_timer_resume(timer);
+        lv_timer_ready(timer);
+    }
+    else {
+        lv_timer_pause(timer);
+    }
+}
+
+void view_lifecycle_detach_timer(lv_timer_t * timer)
+{
+    view_t * v;
+    view_timer_t * t = find_timer(timer, &v);
+
+    if(t == NULL) return;
+
+    *t = v->timers[--v->timer_cnt];
+}
+
+int view_lifecycle_attach_anim(int view, const lv_anim_t * a)
+{
+    view_t * v = get_view(view);
+    int32_t i;
+
+    LV_ASSERT_NULL(a);
+
+    if(v == NULL) {
+        LV_LOG_WARN("Animation not attached to view %d", view);
+        return -1;
+    }
+
+    i = find_anim(v, a->var, a->exec_cb);
+    if(i >= 0) {
+        lv_anim_delete(a->var, a->exec_cb);
+    }
+    else {
+        if(v->anim_cnt >= VIEW_LIFECYCLE_MAX_ANIMS) {
+            LV_LOG_WARN("Too many animations in view %s", v->name);
+            return -1;
+        }
+        i = (int32_t)v->anim_cnt++;
+    }
+
+    v->anims[i] = *a;
+    if(v->visible) lv_anim_start(&v->anims[i]);
+
+    return 0;
+}
+
+void view_lifecycle_detach_anim(int view, void * var, lv_anim_exec_xcb_t exec_cb)
+{
+    view_t * v = get_view(view);
+    int32_t i;
+
+    if(v == NULL) return;
+
+    i = find_anim(v, var, exec_cb);
+    if(i < 0) return;
+
+    lv_anim_delete(var, exec_cb);
+    v->anims[i] = v->anims[--v->anim_cnt];
+}
+
+void view_lifecycle_show(int view)
+{
+    view_t * v = get_view(view);
+    uint32_t i;
+
+    if(v == NULL || v->visible) return;
+    v->visible = true;
+
+    /* Fire on the next handler call so a clock shows the current time in the first frame */
+    for(i = 0; i < v->timer_cnt; i++) {
+        if(!v->timers[i].run) continue;
+        lv_timer_resume(v->timers[i].timer);
+        lv_timer_ready(v->timers[i].timer);
+    }
+
+    /* Restarted from their first value */
+    for(i = 0; i < v->anim_cnt; i++) lv_anim_start(&v->anims[i]);
+}
+
+void view_lifecycle_hide(int view)
+{
+    view_t * v = get_view(view);
+    uint32_t i;
+
+    if(v == NULL || !v->visible) return;
+    v->visible = false;
+    stats.hides++;
+
+    for(i = 0; i < v->timer_cnt; i++) {
+        if(lv_timer_get_paused(v->timers[i].timer)) continue;
+        lv_timer_pause(v->timers[i].timer);
+        stats.timer_pauses++;
+    }
+
+    for(i = 0; i < v->anim_cnt; i++) {
+        if(lv_anim_delete(v->anims[i].var, v->anims[i].exec_cb)) stats.anim_stops++;
+    }
+}
+
+bool view_lifecycle_is_visible(int view)
+{
+    view_t * v = get_view(view);
+    return v != NULL && v->visible;
+}
+
+uint32_t view_lifecycle_audit(void)
+{
+    uint32_t found = 0;
+    uint32_t i, j;
+
+    for(i = 0; i < view_cnt; i++) {
+        view_t * v = &views[i];
+        if(v->visible) continue;
+
+        for(j = 0; j < v->timer_cnt; j++) {
+            if(lv_timer_get_paused(v->timers[j].timer)) continue;
+            LV_LOG_WARN("Timer %u of hidden view %s is running, paused", (unsigned)j, v->name);
+            lv_timer_pause(v->timers[j].timer);
+            found++;
+        }
+
+        for(j = 0; j < v->anim_cnt; j++) {
+            if(lv_anim_get(v->anims[j].var, v->anims[j].exec_cb) == NULL) continue;
+            LV_LOG_WARN("Animation %u of hidden view %s is running, stopped", (unsigned)j, v->name);
+            lv_anim_delete(v->anims[j].var, v->anims[j].exec_cb);
+            found++;
+        }
+    }
+
+    /* Counted for the tests, the dash keeps running */
+    stats.violations += found;
+    return found;
+}
+
+void view_lifecycle_get_stats(view_lifecycle_stats_t * out)
+{
+    *out = stats;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static view_t * get_view(int id)
+{
+    if(id < 0 || (uint32_t)id >= view_cnt) return NULL;
+    return &views[id];
+}
+
+static view_timer_t * find_timer(lv_timer_t * timer, view_t ** owner)
+{
+    uint32_t i, j;
+
+    for(i = 0; i < view_cnt; i++) {
+        for(j = 0; j < views[i].timer_cnt; j++) {
+            if(views[i].timers[j].timer != timer) continue;
+            *owner = &views[i];
+            return &views[i].timers[j];
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t find_anim(const view_t * v, void * var, lv_anim_exec_xcb_t exec_cb)
+{
+    uint32_t i;
+
+    for(i = 0; i < v->anim_cnt; i++) {
+        if(v->anims[i].var == var && v->anims[i].exec_cb == exec_cb) return (int32_t)i;
+    }
+
+    return -1;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file view_lifecycle.h
+ *
+ * Timers and animations owned by a view.
+ *
+ * A view is a set of widgets shown and hidden together, e.g. the dash or
+ * the error screen. The timers and animations attached to a view only run
+ * while it is visible: hiding the view pauses its timers and stops its
+ * animations, showing it resumes the timers its owner wants running and
+ * restarts the animations from their first value.
+ *
+ * Timers are not caught up after a pause, a resumed timer fires once on the
+ * next lv_timer_handler() and then keeps its period. Callbacks that show a
+ * duration, like the lap clock, must compute it from a clock and not by
+ * counting their own calls.
+ *
+ * view_lifecycle_audit() checks that nothing attached to a hidden view is
+ * running. Anything found is logged, counted as a violation and released:
+ * a timer is paused, an animation stopped. test_view_lifecycle fails on
+ * the first violation.
+ */
+
+#ifndef VIEW_LIFECYCLE_H
+#define VIEW_LIFECYCLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define VIEW_LIFECYCLE_MAX_VIEWS  4
+#define VIEW_LIFECYCLE_MAX_TIMERS 8
+#define VIEW_LIFECYCLE_MAX_ANIMS  4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t hides;         /* visible to hidden transitions */
+    uint32_t timer_pauses;  /* timers paused by a hide */
+    uint32_t anim_stops;    /* animations stopped by a hide */
+    uint32_t violations;    /* timers or animations found running in a hidden view */
+} view_lifecycle_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Add a view, it starts hidden
+ * @param name a string that stays valid, used in the logs
+ * @return the view id, -1 if the table is full
+ */
+int view_lifecycle_add(const char * name);
+
+/**
+ * Make a timer follow a view
+ * @param view the view id
+ * @param timer the timer, paused right away if the view or its owner does not run it
+ * @param run whether the owner wants the timer running while the view is visible
+ * @return 0 on success, -1 if the view does not exist or has too many timers
+ */
+int view_lifecycle_attach_timer(int view, lv_timer_t * timer, bool run);
+
+/**
+ * Start or stop an attached timer on behalf of its owner,
+ * use it instead of lv_timer_resume() and lv_timer_pause()
+ * @param timer an attached timer
+ * @param run whether the timer runs while its view is visible
+ */
+void view_lifecycle_timer_run(lv_timer_t * timer, bool run);
+
+/**
+ * Remove a timer from its view before it is deleted
+ * @param timer an attached timer, it is left as it is
+ */
+void view_lifecycle_detach_timer(lv_timer_t * timer);
+
+/**
+ * Make an animation follow a view, it runs whenever the view is visible.
+ * An animation with the same variable and exec_cb is replaced and restarted.
+ * @param view the view id
+ * @param a the animation, copied, use it instead of lv_anim_start()
+ * @return 0 on success, -1 if the view does not exist or has too many animations
+ */
+int view_lifecycle_attach_anim(int view, const lv_anim_t * a);
+
+/**
+ * Stop an animation and remove it from its view
+ * @param view the view id
+ * @param var the variable of the animation
+ * @param exec_cb the exec_cb of the animation
+ */
+void view_lifecycle_detach_anim(int view, void * var, lv_anim_exec_xcb_t exec_cb);
+
+/**
+ * Resume the timers and restart the animations of a view
+ * @param view the view id
+ */
+void view_lifecycle_show(int view);
+
+/**
+ * Pause the timers and stop the animations of a view
+ * @param view the view id
+ */
+void view_lifecycle_hide(int view);
+
+/**
+ * Tell whether a view is visible
+ * @param view the view id
+ * @return true between view_lifecycle_show() and view_lifecycle_hide()
+ */
+bool view_lifecycle_is_visible(int view);
+
+/**
+ * Check that no timer or animation of a hidden view is running,
+ * pause or stop the ones that are
+ * @return the number of violations found by this call
+ */
+uint32_t view_lifecycle_audit(void);
+
+/**
+ * Get the counters
+ * @param stats filled with the counters
+ */
+void view_lifecycle_get_stats(view_lifecycle_stats_t * stats);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*VIEW_LIFECYCLE_H*/
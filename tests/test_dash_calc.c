@@ -0,0 +1,101 @@
+/**
+ * @file test_dash_calc.c
+ *
+ * Picking unused entries, see dash_calc_pick_unused() in dash_calc.h
+ *
+ * For a few bitmap sizes, random numbers included, every entry is picked
+ * exactly once and the next pick of a full bitmap returns -1 without
+ * touching it. An empty set returns -1 too.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dash_calc.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TEST_MAX_COUNT 70
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int check_count(int count);
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(void)
+{
+    static const int counts[] = {1, 7, 8, 9, 64, TEST_MAX_COUNT};
+    uint8_t used[1] = {0};
+    int failed = 0;
+    size_t i;
+
+    srand(1);
+
+    if(dash_calc_pick_unused(used, 0, rand()) != -1 || used[0] != 0) {
+        printf("FAIL: a pick from no entries did not return -1\n");
+        failed = 1;
+    }
+
+    for(i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) failed |= check_count(counts[i]);
+
+    if(failed) return 1;
+    printf("PASS: every entry picked once, -1 when none is left\n");
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Pick every entry of a bitmap, then once more
+ * @param count number of entries
+ * @return 0 on success, 1 on failure
+ */
+static int check_count(int count)
+{
+    uint8_t used[(TEST_MAX_COUNT + 7) / 8];
+    uint8_t full[sizeof(used)];
+    int picks[TEST_MAX_COUNT] = {0};
+    int picked;
+    int i;
+
+    memset(used, 0, sizeof(used));
+
+    for(i = 0; i < count; i++) {
+        /* Negative numbers too, rand() only gives positive ones */
+        picked = dash_calc_pick_unused(used, count, i % 3 ? rand() : -rand());
+        if(picked < 0 || picked >= count) {
+            printf("FAIL: pick %d of %d returned %d\n", i, count, picked);
+            return 1;
+        }
+        if(picks[picked]++ != 0) {
+            printf("FAIL: entry %d of %d picked twice\n", picked, count);
+            return 1;
+        }
+    }
+
+    memcpy(full, used, sizeof(used));
+    picked = dash_calc_pick_unused(used, count, rand());
+    if(picked != -1) {
+        printf("FAIL: pick from %d used entries returned %d\n", count, picked);
+        return 1;
+    }
+    if(memcmp(full, used, sizeof(used)) != 0) {
+        printf("FAIL: pick from %d used entries changed the bitmap\n", count);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file test_fault_latency.c
+ *
+ * Fault path latency, see fault.h and error_view.h
+ *
+ * The UI loop runs headless on the virtual clock of dash_clock.h, as in
+ * main.c: error_view_poll() first, then lv_timer_handler() and
+ * refresh_governor_wait(). The error view is the first of the staged
+ * build steps and a label is updated every frame, so the loop is never
+ * idle. Fault word changes are reported from the first frame on, during
+ * the warm-up too, at varying phases: from a timer while a frame is being
+ * prepared, and while the loop waits.
+ *
+ * Passes when every change was drawn, each at most one frame after it was
+ * reported: the frame in flight may go out without it, the next one must
+ * show it, within one frame period of virtual time. A fault during the
+ * warm-up must not finish the remaining build steps.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lvgl/lvgl.h"
+#include "fault.h"
+#include "error_view.h"
+#include "ui_stages.h"
+#include "refresh_governor.h"
+#include "dash_clock.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TEST_HOR_RES 800
+#define TEST_VER_RES 480
+
+#define REPORT_CNT    40
+#define REPORT_GAP_MS 45
+
+/* Labels of a filler build step, so the warm-up lasts a few frames */
+#define FILLER_LABELS 50
+
+/* Virtual time after which the loop gives up taking faults */
+#define TEST_TIMEOUT_MS (REPORT_CNT * (REPORT_GAP_MS + LV_DEF_REFR_PERIOD) * 4)
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void maybe_report(void);
+static int check_drawn(void);
+static void takeover(void);
+static void build_error(void);
+static void build_filler(void);
+static void report_timer_cb(lv_timer_t * t);
+static void busy_timer_cb(lv_timer_t * t);
+static void flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const ui_stage_t test_steps[] = {
+    {"error", build_error},
+    {"filler_1", build_filler},
+    {"filler_2", build_filler},
+    {"filler_3", build_filler},
+    {"filler_4", build_filler},
+    {"filler_5", build_filler},
+    {"filler_6", build_filler},
+    {"filler_7", build_filler},
+    {"filler_8", build_filler},
+};
+
+static lv_obj_t * dash_label;
+static uint32_t frames;
+
+static uint32_t reported;
+static uint32_t next_report_ms;
+static bool pending;
+static uint32_t pending_frames;
+static uint32_t pending_ms;
+static uint32_t warmup_takeovers;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(void)
+{
+    lv_display_t * disp;
+    lv_draw_buf_t * buf;
+    fault_stats_t stats;
+    uint32_t start;
+    uint32_t idle_ms;
+    int failed = 0;
+
+    setenv("DASH_CLOCK", "virtual", 1);
+    lv_init();
+    dash_clock_init();
+    srand(1);
+
+    disp = lv_display_create(TEST_HOR_RES, TEST_VER_RES);
+    buf = lv_draw_buf_create(TEST_HOR_RES, TEST_VER_RES, lv_display_get_color_format(disp), LV_STRIDE_AUTO);
+    LV_ASSERT_MALLOC(buf);
+    lv_display_set_draw_buffers(disp, buf, NULL);
+    lv_display_set_render_mode(disp, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, flush_cb);
+    refresh_governor_init(disp);
+
+    if(fault_init() != 0) {
+        fprintf(stderr, "fault_init failed\n");
+        return 1;
+    }
+    refresh_governor_add_wake_fd(fault_get_wake_fd());
+
+    dash_label = lv_label_create(lv_screen_active());
+    lv_obj_align(dash_label, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_timer_create(busy_timer_cb, LV_DEF_REFR_PERIOD, NULL);
+    lv_timer_create(report_timer_cb, 7, NULL);
+
+    ui_stages_start(disp, test_steps, sizeof(test_steps) / sizeof(test_steps[0]), NULL);
+
+    start = dash_clock_now_ms();
+    while((reported < REPORT_CNT || pending) && dash_clock_now_ms() - start < TEST_TIMEOUT_MS) {
+        /* As the loop of main.c */
+        if(error_view_poll(disp, takeover)) failed |= check_drawn();
+        idle_ms = lv_timer_handler();
+        refresh_governor_wait(idle_ms);
+
+        /* Arrived while the loop was waiting */
+        maybe_report();
+    }
+
+    fault_dump(stdout);
+    fault_get_stats(&stats);
+
+    if(stats.changes != REPORT_CNT || pending) {
+        printf("FAIL: %u of %u fault changes drawn\n", (unsigned)stats.changes, (unsigned)REPORT_CNT);
+        failed = 1;
+    }
+    if(warmup_takeovers == 0) {
+        printf("FAIL: no fault was reported during the warm-up\n");
+        failed = 1;
+    }
+
+    if(failed) return 1;
+    printf("PASS: %u fault changes, each in the next frame, %u during the warm-up\n", (unsigned)stats.changes,
+           (unsigned)warmup_takeovers);
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Toggle a fault once it is due, like the VCU does. Only after the first
+ * frame: before it the boot screen is all there is.
+ */
+static void maybe_report(void)
+{
+    uint32_t now = dash_clock_now_ms();
+
+    if(frames == 0 || pending || reported == REPORT_CNT) return;
+    if((int32_t)(now - next_report_ms) < 0) return;
+
+    pending = true;
+    pending_frames = frames;
+    pending_ms = now;
+    fault_report(reported % 2 ? 0 : FAULT_BIT(FAULT_OVER_TEMP) | FAULT_BIT(FAULT_ISOLATION));
+    reported++;
+
+    next_report_ms = now + REPORT_GAP_MS + (uint32_t)(rand() % LV_DEF_REFR_PERIOD);
+}
+
+/**
+ * Check the frame error_view_poll() just flushed against the last report
+ * @return 0 on success, 1 if the change came too late
+ */
+static int check_drawn(void)
+{
+    uint32_t late_frames = frames - pending_frames;
+    uint32_t late_ms = dash_clock_now_ms() - pending_ms;
+    int failed = 0;
+
+    if(!pending) {
+        printf("FAIL: a fault frame without a report\n");
+        return 1;
+    }
+    pending = false;
+
+    /* The frame in flight at the report and the one drawing it */
+    if(late_frames == 0 || late_frames > 2) {
+        printf("FAIL: change %u drawn %u frames after its report\n", (unsigned)reported, (unsigned)late_frames);
+        failed = 1;
+    }
+    if(late_ms > LV_DEF_REFR_PERIOD) {
+        printf("FAIL: change %u drawn %ums after its report, over one frame of %ums\n", (unsigned)reported,
+               (unsigned)late_ms, (unsigned)LV_DEF_REFR_PERIOD);
+        failed = 1;
+    }
+
+    return failed;
+}
+
+/**
+ * As the fault takeover of main.c, the build steps are left running
+ */
+static void takeover(void)
+{
+    if(!ui_stages_done()) warmup_takeovers++;
+    lv_obj_add_flag(dash_label, LV_OBJ_FLAG_HIDDEN);
+    error_view_set_visible(true);
+}
+
+static void build_error(void)
+{
+    error_view_create(lv_screen_active(), LV_FONT_DEFAULT, LV_FONT_DEFAULT);
+}
+
+static void build_filler(void)
+{
+    lv_obj_t * label;
+    int i;
+
+    for(i = 0; i < FILLER_LABELS; i++) {
+        label = lv_label_create(lv_screen_active());
+        lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+        lv_label_set_text_fmt(label, "filler %d", i);
+    }
+}
+
+/**
+ * Arrived while a frame is being prepared
+ */
+static void report_timer_cb(lv_timer_t * t)
+{
+    LV_UNUSED(t);
+    maybe_report();
+}
+
+static void busy_timer_cb(lv_timer_t * t)
+{
+    static uint32_t cnt;
+
+    LV_UNUSED(t);
+    lv_label_set_text_fmt(dash_label, "%u", (unsigned)cnt++);
+}
+
+static void flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map)
+{
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+    if(lv_display_flush_is_last(disp)) frames++;
+    lv_display_flush_ready(disp);
+}
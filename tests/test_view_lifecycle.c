@@ -0,0 +1,182 @@
+/**
+ * @file test_view_lifecycle.c
+ *
+ * Nothing of a hidden view runs, see view_lifecycle.h
+ *
+ * Every view gets two timers, one of them started by its owner while the
+ * view is hidden, and an endless animation. Each view in turn is the only
+ * visible one for a second of LVGL time. The test fails when a callback of
+ * a hidden view fires, when one of the visible view does not, or when
+ * view_lifecycle_audit() finds something running.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+
+#include "lvgl/lvgl.h"
+#include "view_lifecycle.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TEST_VIEWS 3
+
+/* LVGL time each view is shown, stepped like a 200 Hz loop */
+#define RUN_MS  1000
+#define STEP_MS 5
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    int id;
+    lv_timer_t * timers[2];
+    int32_t anim_var;
+    uint32_t timer_calls;
+    uint32_t anim_calls;
+} test_view_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int check_round(int shown);
+static void timer_cb(lv_timer_t * t);
+static void anim_cb(void * var, int32_t v);
+static uint32_t tick_cb(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const char * const view_names[TEST_VIEWS] = {"logo", "dash", "error"};
+static test_view_t views[TEST_VIEWS];
+static uint32_t fake_ms;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(void)
+{
+    view_lifecycle_stats_t stats;
+    lv_anim_t a;
+    int failed = 0;
+    int i;
+
+    lv_init();
+    lv_tick_set_cb(tick_cb);
+
+    for(i = 0; i < TEST_VIEWS; i++) {
+        test_view_t * v = &views[i];
+
+        v->id = view_lifecycle_add(view_names[i]);
+        v->timers[0] = lv_timer_create(timer_cb, 10, v);
+        v->timers[1] = lv_timer_create(timer_cb, 100, v);
+        view_lifecycle_attach_timer(v->id, v->timers[0], true);
+        view_lifecycle_attach_timer(v->id, v->timers[1], false);
+
+        lv_anim_init(&a);
+        lv_anim_set_var(&a, &v->anim_var);
+        lv_anim_set_exec_cb(&a, anim_cb);
+        lv_anim_set_values(&a, 0, 100);
+        lv_anim_set_duration(&a, 200);
+        lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+        view_lifecycle_attach_anim(v->id, &a);
+
+        /* The owner starts it while the view is hidden, it must wait for a show */
+        view_lifecycle_timer_run(v->timers[1], true);
+    }
+
+    for(i = 0; i < TEST_VIEWS; i++) failed |= check_round(i);
+    /* And back to the first one, after it was hidden once */
+    failed |= check_round(0);
+
+    view_lifecycle_get_stats(&stats);
+    if(stats.violations != 0) {
+        printf("FAIL: %u violations found by the audit\n", (unsigned)stats.violations);
+        failed = 1;
+    }
+
+    if(failed) return 1;
+    printf("PASS: %u hides, %u timer pauses, %u animation stops\n", (unsigned)stats.hides,
+           (unsigned)stats.timer_pauses, (unsigned)stats.anim_stops);
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Show one view, hide the others and run the timers for RUN_MS
+ * @param shown the index of the visible view
+ * @return 0 on success, 1 if a callback fired in a hidden view or none in the visible one
+ */
+static int check_round(int shown)
+{
+    int failed = 0;
+    uint32_t t;
+    int i;
+
+    for(i = 0; i < TEST_VIEWS; i++) {
+        if(i != shown) view_lifecycle_hide(views[i].id);
+    }
+    view_lifecycle_show(views[shown].id);
+
+    for(i = 0; i < TEST_VIEWS; i++) {
+        views[i].timer_calls = 0;
+        views[i].anim_calls = 0;
+    }
+
+    for(t = 0; t < RUN_MS; t += STEP_MS) {
+        fake_ms += STEP_MS;
+        lv_timer_handler();
+        /* The product logs and releases a leak, here it is fatal */
+        LV_ASSERT_MSG(view_lifecycle_audit() == 0, "timer or animation running in a hidden view");
+    }
+
+    for(i = 0; i < TEST_VIEWS; i++) {
+        const test_view_t * v = &views[i];
+        bool fired = v->timer_calls > 0 || v->anim_calls > 0;
+        bool all_fired = v->timer_calls > 0 && v->anim_calls > 0;
+
+        if(i != shown && fired) {
+            printf("FAIL: %s shown, hidden %s ran %u timer and %u animation callbacks\n", view_names[shown],
+                   view_names[i], (unsigned)v->timer_calls, (unsigned)v->anim_calls);
+            failed = 1;
+        }
+        if(i == shown && !all_fired) {
+            printf("FAIL: visible %s ran %u timer and %u animation callbacks\n", view_names[i],
+                   (unsigned)v->timer_calls, (unsigned)v->anim_calls);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
+
+static void timer_cb(lv_timer_t * t)
+{
+    test_view_t * v = lv_timer_get_user_data(t);
+    v->timer_calls++;
+}
+
+static void anim_cb(void * var, int32_t v)
+{
+    int i;
+
+    LV_UNUSED(v);
+    for(i = 0; i < TEST_VIEWS; i++) {
+        if(var == &views[i].anim_var) views[i].anim_calls++;
+    }
+}
+
+static uint32_t tick_cb(void)
+{
+    return fake_ms;
+}